@@ -0,0 +1,17 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TARGET = GalaxyBenchmark
+
+include(../Engine.pri)
+
+SOURCES += main.cpp \
+    benchmark.cpp
+
+HEADERS += \
+    benchmark.h
+
+DISTFILES += \
+    sponza.bench
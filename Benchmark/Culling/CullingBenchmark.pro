@@ -0,0 +1,10 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TARGET = GalaxyCullingBenchmark
+
+include(../../Engine.pri)
+
+SOURCES += main.cpp
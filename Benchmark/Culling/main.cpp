@@ -0,0 +1,183 @@
+/*!
+ * \file main.cpp
+ * \brief Compare the frustrum test box by box with the batched one and the BoundingVolumeHierarchy
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#include "include/include.h"
+#include "Camera/camera.h"
+#include "SceneManager/boundingvolumehierarchy.h"
+
+using namespace std;
+using namespace glm;
+using namespace GXY;
+
+/**
+ * @brief Run one test several times
+ * @param[in] repetitions : Number of runs
+ * @param[in] test : The test
+ * @return Median time in milliseconds
+ */
+template<typename Test>
+double measure(u32 repetitions, Test const &test)
+{
+    vector<double> times;
+
+    for(u32 i = 0; i < repetitions; ++i)
+    {
+        auto start = chrono::steady_clock::now();
+        test();
+        times.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+
+    sort(times.begin(), times.end());
+
+    return times[times.size() / 2];
+}
+
+int main(int argc, char *argv[])
+{
+    u32 numBoxes = 100000;
+    u32 repetitions = 50;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+
+        if((arg == "-n" || arg == "--boxes") && i + 1 < argc)
+            numBoxes = atoi(argv[++i]);
+
+        else if((arg == "-r" || arg == "--repetitions") && i + 1 < argc)
+            repetitions = std::max(atoi(argv[++i]), 1);
+
+        else
+        {
+            cerr << "Usage : " << argv[0] << " [-n boxes] [-r repetitions]" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Same frustrum as the camera of the SceneManager, boxes all around it
+    Frustrum frustrum;
+    frustrum.extractPlane(radians(45.0f), 16.0f / 9.0f, 1.0f, 10000.0f, vec3(0.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 1.0f, 0.0f));
+
+    mt19937 random(42);
+    uniform_real_distribution<float> position(-5000.0f, 5000.0f), size(1.0f, 50.0f);
+
+    vector<AABB3D> boxes(numBoxes);
+    BoundsBatch batch;
+
+    for(u32 i = 0; i < numBoxes; ++i)
+    {
+        vec3 center(position(random), position(random), position(random));
+        vec3 extent(size(random), size(random), size(random));
+
+        boxes[i] = makeAABB3D(center - extent, center + extent);
+        batch.push(center, extent);
+    }
+
+    vector<u8> perBox(numBoxes);
+    vector<u32> batched, culled;
+    BoundingVolumeHierarchy hierarchy;
+
+    double timePerBox = measure(repetitions, [&]()
+    {
+        for(u32 i = 0; i < numBoxes; ++i)
+            perBox[i] = frustrum.boxInside(boxes[i]);
+    });
+
+    double timeBatched = measure(repetitions, [&]()
+    {
+        frustrum.boxesInside(batch, batched);
+    });
+
+    // The first cull builds the tree
+    double timeBuild = measure(1, [&]()
+    {
+        for(u32 i = 0; i < numBoxes; ++i)
+            hierarchy.setBounds(i, boxes[i]);
+
+        hierarchy.cull(frustrum, culled);
+    });
+
+    double timeHierarchy = measure(repetitions, [&]()
+    {
+        hierarchy.cull(frustrum, culled);
+    });
+
+    // 1% of boxes move at each frame : only their ancestors are refitted
+    uniform_int_distribution<u32> moved(0, numBoxes - 1);
+    uniform_real_distribution<float> offset(-10.0f, 10.0f);
+
+    double timeRefit = measure(repetitions, [&]()
+    {
+        for(u32 i = 0; i < numBoxes / 100; ++i)
+        {
+            u32 index = moved(random);
+            vec3 translation(offset(random), offset(random), offset(random));
+
+            boxes[index].center += vec4(translation, 0.0f);
+            hierarchy.setBounds(index, boxes[index]);
+        }
+
+        hierarchy.cull(frustrum, culled);
+    });
+
+    // Compare the three tests on the boxes moved
+    batch.clear();
+
+    for(u32 i = 0; i < numBoxes; ++i)
+    {
+        perBox[i] = frustrum.boxInside(boxes[i]);
+        batch.push(boxes[i].center.xyz(), boxes[i].extent.xyz());
+    }
+
+    frustrum.boxesInside(batch, batched);
+
+    // Same test, only the rounding of the SIMD kernel can differ
+    u32 visible = 0, mismatches = 0;
+
+    for(u32 i = 0; i < numBoxes; ++i)
+    {
+        bool isVisible = (batched[i / 32] >> (i % 32)) & 1;
+
+        visible += isVisible;
+        mismatches += (isVisible != (perBox[i] != 0));
+    }
+
+    // The tree tests the same planes, it has to find exactly the same boxes
+    vector<u8> inHierarchy(numBoxes, 0);
+    u32 hierarchyMismatches = 0;
+
+    for(auto index : culled)
+        inHierarchy[index] = 1;
+
+    for(u32 i = 0; i < numBoxes; ++i)
+        hierarchyMismatches += (inHierarchy[i] != perBox[i]);
+
+#if defined(__AVX__)
+    char const *kernel = "avx";
+#elif defined(__SSE__)
+    char const *kernel = "sse";
+#else
+    char const *kernel = "scalar";
+#endif
+
+    cout << "{" << endl;
+    cout << "    \"boxes\": " << numBoxes << "," << endl;
+    cout << "    \"repetitions\": " << repetitions << "," << endl;
+    cout << "    \"kernel\": \"" << kernel << "\"," << endl;
+    cout << "    \"visible\": " << visible << "," << endl;
+    cout << "    \"mismatches\": " << mismatches << "," << endl;
+    cout << "    \"perBoxMs\": " << timePerBox << "," << endl;
+    cout << "    \"batchedMs\": " << timeBatched << "," << endl;
+    cout << "    \"speedup\": " << timePerBox / std::max(timeBatched, 1e-9) << "," << endl;
+    cout << "    \"bvhBuildMs\": " << timeBuild << "," << endl;
+    cout << "    \"bvhMs\": " << timeHierarchy << "," << endl;
+    cout << "    \"bvhRefitMs\": " << timeRefit << "," << endl;
+    cout << "    \"bvhMismatches\": " << hierarchyMismatches << endl;
+    cout << "}" << endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,486 @@
+/*!
+ * \file benchmark.cpp
+ * \brief Replay a scripted flythrough and measure frame times
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#include "benchmark.h"
+#include "SceneManager/modelnode.h"
+#include "SceneManager/pointlightnode.h"
+
+using namespace std;
+using namespace glm;
+
+namespace GXY
+{
+    /**
+     * @brief Minimal reader for reports : objects, arrays, strings and numbers
+     *
+     * Numbers inside objects are flattened as "cpu.p95"
+     */
+    class ReportReader
+    {
+    public:
+        /**
+         * @brief ReportReader Constructor
+         * @param[in] text : JSON
+         */
+        ReportReader(string const &text) : mText(text), mPos(0){}
+
+        /**
+         * @brief Read all numbers
+         * @return Associative table between flattened name and value
+         */
+        map<string, double> read(void)
+        {
+            map<string, double> values;
+            mValue("", values);
+            return values;
+        }
+
+    private:
+        string const &mText; //!< JSON
+        size_t mPos; //!< Current position
+
+        void mSkip(void)
+        {
+            while(mPos < mText.size() && isspace((unsigned char)mText[mPos]))
+                ++mPos;
+        }
+
+        char mPeek(void)
+        {
+            mSkip();
+
+            if(mPos >= mText.size())
+                throw Except("Benchmark : unexpected end of report");
+
+            return mText[mPos];
+        }
+
+        void mExpect(char c)
+        {
+            if(mPeek() != c)
+                throw Except(string("Benchmark : '") + c + "' expected in report");
+            ++mPos;
+        }
+
+        string mString(void)
+        {
+            mExpect('"');
+            size_t end = mText.find('"', mPos);
+
+            if(end == string::npos)
+                throw Except("Benchmark : unterminated string in report");
+
+            string str = mText.substr(mPos, end - mPos);
+            mPos = end + 1;
+            return str;
+        }
+
+        void mValue(string const &name, map<string, double> &values)
+        {
+            char c = mPeek();
+
+            if(c == '{')
+            {
+                ++mPos;
+
+                while(mPeek() != '}')
+                {
+                    string key = mString();
+                    mExpect(':');
+                    mValue(name.empty() ? key : name + "." + key, values);
+
+                    if(mPeek() == ',')
+                        ++mPos;
+                }
+
+                ++mPos;
+            }
+
+            else if(c == '[')
+            {
+                ++mPos;
+
+                while(mPeek() != ']')
+                {
+                    mValue(name + "[]", values);
+
+                    if(mPeek() == ',')
+                        ++mPos;
+                }
+
+                ++mPos;
+            }
+
+            else if(c == '"')
+                mString();
+
+            else
+            {
+                char const *begin = mText.c_str() + mPos;
+                char *end;
+                double value = strtod(begin, &end);
+
+                if(end == begin)
+                    throw Except("Benchmark : invalid value in report");
+
+                mPos += end - begin;
+
+                if(name.find("[]") == string::npos)
+                    values[name] = value;
+            }
+        }
+    };
+
+    /**
+     * @brief Push one time in the serie of one pass, the serie is created if needed
+     * @param[out] passes : series of all passes
+     * @param[in] name : name of the pass
+     * @param[in] time : time in milliseconds
+     */
+    static void pushTime(vector<pair<string, vector<double>>> &passes, string const &name, double time)
+    {
+        auto it = find_if(passes.begin(), passes.end(),
+                          [&name](pair<string, vector<double>> const &p){return p.first == name;});
+
+        if(it == passes.end())
+            it = passes.emplace(passes.end(), name, vector<double>());
+
+        it->second.push_back(time);
+    }
+
+    BenchmarkStatistics computeStatistics(vector<double> times)
+    {
+        BenchmarkStatistics statistics = {0.0, 0.0, 0.0, 0.0};
+
+        if(times.empty())
+            return statistics;
+
+        sort(times.begin(), times.end());
+
+        for(auto time : times)
+            statistics.mean += time;
+
+        statistics.mean /= times.size();
+
+        auto percentile = [&times](double p)
+        {
+            size_t rank = (size_t)ceil(p / 100.0 * times.size());
+            return times[std::min(std::max(rank, (size_t)1), times.size()) - 1];
+        };
+
+        statistics.p50 = percentile(50.0);
+        statistics.p95 = percentile(95.0);
+        statistics.p99 = percentile(99.0);
+
+        return statistics;
+    }
+
+    Benchmark::Benchmark(string const &path) : mWidth(800), mHeight(600), mWarmUp(30), mFrames(600)
+    {
+        ifstream file(path);
+
+        if(!file)
+            throw Except("Impossible to open : " + path);
+
+        string line;
+
+        while(getline(file, line))
+        {
+            line = line.substr(0, line.find('#'));
+
+            istringstream stream(line);
+            string command;
+
+            if(!(stream >> command))
+                continue;
+
+            if(command == "resolution")
+                stream >> mWidth >> mHeight;
+
+            else if(command == "warmup")
+                stream >> mWarmUp;
+
+            else if(command == "frames")
+                stream >> mFrames;
+
+            else if(command == "key")
+            {
+                BenchmarkKey key;
+                stream >> key.position.x >> key.position.y >> key.position.z
+                       >> key.look.x >> key.look.y >> key.look.z;
+                mKeys.push_back(key);
+            }
+
+            else if(command == "model" || command == "light" || command == "shadow" || command == "vpl" ||
+                    command == "occlusion" || command == "smallfeature" || command == "backface" ||
+                    command == "lodbias" || command == "shadowlodbias")
+                mScene.push_back(line);
+
+            else
+                throw Except("Benchmark : unknown command " + command + " in " + path);
+
+            if(stream.fail())
+                throw Except("Benchmark : invalid line \"" + line + "\" in " + path);
+        }
+
+        if(mKeys.empty())
+            throw Except("Benchmark : the script " + path + " has no camera key");
+    }
+
+    void Benchmark::mBuildScene(SceneManager &sceneManager)
+    {
+        shared_ptr<Node> rootNode = sceneManager.getRootNode();
+        shared_ptr<PointLightNode> light;
+
+        for(auto const &line : mScene)
+        {
+            istringstream stream(line);
+            string command;
+            stream >> command;
+
+            if(command == "model")
+            {
+                string path;
+                stream >> path;
+                addModel(rootNode, path);
+            }
+
+            else if(command == "light")
+            {
+                vec3 position;
+                float radius, intensity;
+                stream >> position.x >> position.y >> position.z >> radius >> intensity;
+
+                light = addPointLight(rootNode);
+                light->setColor(vec3(1.0, 1.0, 1.0));
+                light->setPosition(position);
+                light->setRadius(radius);
+                light->setIntensity(intensity);
+            }
+
+            else if(command == "occlusion")
+            {
+                s32 enable;
+                stream >> enable;
+                sceneManager.setOcclusionCulling(enable != 0);
+            }
+
+            else if(command == "smallfeature")
+            {
+                float minPixelSize;
+                stream >> minPixelSize;
+                sceneManager.setSmallFeatureCulling(minPixelSize);
+            }
+
+            else if(command == "backface")
+            {
+                s32 enable;
+                stream >> enable;
+                sceneManager.setBackfaceCulling(enable != 0);
+            }
+
+            else if(command == "lodbias")
+            {
+                float lodBias;
+                stream >> lodBias;
+                sceneManager.setLodBias(lodBias);
+            }
+
+            else if(command == "shadowlodbias")
+            {
+                float lodBias;
+                stream >> lodBias;
+                sceneManager.setShadowLodBias(lodBias);
+            }
+
+            else if(light == nullptr)
+                throw Except("Benchmark : " + command + " needs a light before");
+
+            else if(command == "shadow")
+            {
+                s32 index;
+                stream >> index;
+                light->enableShadowMaps(index);
+            }
+
+            else
+                light->enableVirtualLight();
+        }
+
+        // Models are loaded in background : frames are measured on the whole scene
+        global->ressourceManager->finish();
+    }
+
+    BenchmarkKey Benchmark::mKey(u32 frame) const
+    {
+        u32 total = mWarmUp + mFrames;
+
+        if(mKeys.size() == 1 || total <= 1)
+            return mKeys[0];
+
+        float t = (float)frame / (total - 1) * (mKeys.size() - 1);
+        u32 index = std::min((u32)t, (u32)mKeys.size() - 2);
+        float alpha = t - index;
+
+        BenchmarkKey key;
+        key.position = mKeys[index].position * (1.0f - alpha) + mKeys[index + 1].position * alpha;
+        key.look = mKeys[index].look * (1.0f - alpha) + mKeys[index + 1].look * alpha;
+        return key;
+    }
+
+    void Benchmark::run(Device &device)
+    {
+        SceneManager sceneManager;
+
+        mBuildScene(sceneManager);
+
+        BenchmarkKey key = mKey(0);
+        shared_ptr<CameraStatic> camera = make_shared<CameraStatic>(key.position, key.look, CAM_UP_Y, radians(45.0f),
+                                                                    (float)device.width() / device.height(), 1.0f, 10000.0f);
+        sceneManager.setCamera(camera);
+
+        mCPUTimes.clear();
+        mGPUTimes.clear();
+        mPassTimes.clear();
+        mGPUPassTimes.clear();
+
+        u32 firstFrame = device.frameIndex() + mWarmUp;
+
+        // GPU timings are read some frames later, keep all of them
+        global->gpuProfiler->setCapture(true);
+        global->cpuProfiler->setCapture(true);
+
+        for(u32 frame = 0; frame < mWarmUp + mFrames && device.run(); ++frame)
+        {
+            key = mKey(frame);
+            camera->set(key.position, key.look, CAM_UP_Y, radians(45.0f),
+                        (float)device.width() / device.height(), 1.0f, 10000.0f);
+
+            auto start = chrono::steady_clock::now();
+
+            device.begin();
+                sceneManager.render();
+            device.end();
+
+            double cpuTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+            if(frame < mWarmUp)
+                continue;
+
+            mCPUTimes.push_back(cpuTime);
+
+            for(auto const &pass : sceneManager.passTimings())
+                pushTime(mPassTimes, pass.first, pass.second);
+        }
+
+        global->gpuProfiler->flush();
+        global->gpuProfiler->setCapture(false);
+        global->cpuProfiler->setCapture(false);
+
+        for(auto const &timing : global->gpuProfiler->captured())
+        {
+            if(timing.frame < firstFrame)
+                continue;
+
+            if(timing.depth == 0)
+                mGPUTimes.push_back(timing.duration);
+
+            else
+                pushTime(mGPUPassTimes, timing.name, timing.duration);
+        }
+    }
+
+    vector<pair<string, double>> Benchmark::mMetrics(void) const
+    {
+        vector<pair<string, double>> metrics;
+
+        auto push = [&metrics](string const &name, BenchmarkStatistics const &statistics)
+        {
+            metrics.emplace_back(name + ".mean", statistics.mean);
+            metrics.emplace_back(name + ".p50", statistics.p50);
+            metrics.emplace_back(name + ".p95", statistics.p95);
+            metrics.emplace_back(name + ".p99", statistics.p99);
+        };
+
+        push("cpu", computeStatistics(mCPUTimes));
+        push("gpu", computeStatistics(mGPUTimes));
+
+        for(auto const &pass : mPassTimes)
+            push("cpuPasses." + pass.first, computeStatistics(pass.second));
+
+        for(auto const &pass : mGPUPassTimes)
+            push("gpuPasses." + pass.first, computeStatistics(pass.second));
+
+        return metrics;
+    }
+
+    void Benchmark::writeJSON(ostream &stream) const
+    {
+        auto write = [&stream](BenchmarkStatistics const &statistics)
+        {
+            stream << "{\"mean\": " << statistics.mean << ", \"p50\": " << statistics.p50
+                   << ", \"p95\": " << statistics.p95 << ", \"p99\": " << statistics.p99 << "}";
+        };
+
+        stream << "{" << endl;
+        stream << "    \"frames\": " << mCPUTimes.size() << "," << endl;
+        stream << "    \"resolution\": [" << mWidth << ", " << mHeight << "]," << endl;
+        stream << "    \"cpu\": ";
+        write(computeStatistics(mCPUTimes));
+        stream << "," << endl << "    \"gpu\": ";
+        write(computeStatistics(mGPUTimes));
+        auto writePasses = [&stream, &write](vector<pair<string, vector<double>>> const &passes)
+        {
+            stream << "{";
+
+            for(u32 i = 0; i < passes.size(); ++i)
+            {
+                stream << (i == 0 ? "" : ",") << endl << "        \"" << passes[i].first << "\": ";
+                write(computeStatistics(passes[i].second));
+            }
+
+            stream << endl << "    }";
+        };
+
+        stream << "," << endl << "    \"cpuPasses\": ";
+        writePasses(mPassTimes);
+        stream << "," << endl << "    \"gpuPasses\": ";
+        writePasses(mGPUPassTimes);
+        stream << endl << "}" << endl;
+    }
+
+    bool Benchmark::compare(string const &path, double tolerance, ostream &stream) const
+    {
+        ifstream file(path);
+
+        if(!file)
+            throw Except("Impossible to open : " + path);
+
+        string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        map<string, double> baseline = ReportReader(text).read();
+        bool ok = true;
+
+        for(auto const &metric : mMetrics())
+        {
+            auto it = baseline.find(metric.first);
+
+            if(it == baseline.end() || it->second <= 0.0)
+                continue;
+
+            double ratio = metric.second / it->second - 1.0;
+            bool regression = ratio > tolerance;
+
+            stream << (regression ? "REGRESSION " : "           ") << metric.first << " : "
+                   << it->second << " ms -> " << metric.second << " ms ("
+                   << (ratio >= 0.0 ? "+" : "") << ratio * 100.0 << "%)" << endl;
+
+            ok = ok && !regression;
+        }
+
+        return ok;
+    }
+}
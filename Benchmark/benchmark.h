@@ -0,0 +1,147 @@
+/*!
+ * \file benchmark.h
+ * \brief Replay a scripted flythrough and measure frame times
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "include/include.h"
+#include "SceneManager/scenemanager.h"
+#include "Debug/gpuprofiler.h"
+#include "Debug/cpuprofiler.h"
+
+namespace GXY
+{
+    /**
+      * @example Benchmark sponza.bench
+      * @code
+      * resolution 800 600
+      * warmup 30
+      * frames 600
+      * occlusion 1
+      * smallfeature 2.0
+      * backface 0
+      * lodbias 0.0
+      * shadowlodbias 1.0
+      * model models/OBJ/crytek-sponza/sponza.obj
+      * light 0.0 100.0 0.0 1000.0 1.0
+      * shadow 0
+      * vpl
+      * key -1000.0 150.0 0.0 0.0 150.0 0.0
+      * key 1000.0 150.0 0.0 0.0 150.0 0.0
+      * @endcode
+      */
+
+    /**
+     * @brief One key of the Camera path
+     */
+    struct BenchmarkKey
+    {
+        glm::vec3 position; //!< Position of the Camera
+        glm::vec3 look; //!< Point looked by the Camera
+    };
+
+    /**
+     * @brief Percentiles of one serie of times, in milliseconds
+     */
+    struct BenchmarkStatistics
+    {
+        double mean; //!< Mean
+        double p50; //!< Median
+        double p95; //!< 95th percentile
+        double p99; //!< 99th percentile
+    };
+
+    /**
+     * @brief The Benchmark class
+     *
+     * Load a scene from a script, replay a Camera path with a fixed timestep,
+     * measure CPU and GPU time of each frame, and compare them with a baseline
+     */
+    class Benchmark
+    {
+    public:
+        /**
+         * @brief Benchmark Constructor
+         * @param[in] path : Path of the script
+         */
+        Benchmark(std::string const &path);
+
+        /**
+         * @brief Get the width asked by the script
+         * @return width
+         */
+        inline s32 width(void) const {return mWidth;}
+
+        /**
+         * @brief Get the height asked by the script
+         * @return height
+         */
+        inline s32 height(void) const {return mHeight;}
+
+        /**
+         * @brief Build the scene and render all frames
+         * @param[in] device : Device already created
+         */
+        void run(Device &device);
+
+        /**
+         * @brief Write the report
+         * @param[in] stream : where JSON is written
+         */
+        void writeJSON(std::ostream &stream) const;
+
+        /**
+         * @brief Compare this run with a report written before
+         * @param[in] path : Path of the baseline report
+         * @param[in] tolerance : Relative increase allowed (0.05 = 5%)
+         * @param[in] stream : where the comparison of each metric is written
+         * @return true if no metric is slower than the baseline more than tolerance
+         */
+        bool compare(std::string const &path, double tolerance, std::ostream &stream) const;
+
+    private:
+        s32 mWidth, mHeight; //!< Resolution
+        u32 mWarmUp; //!< Number of frames which are not measured
+        u32 mFrames; //!< Number of frames measured
+
+        std::vector<std::string> mScene; //!< Lines of the script describing the scene
+        std::vector<BenchmarkKey> mKeys; //!< Camera path
+
+        std::vector<double> mCPUTimes; //!< CPU time of each frame
+        std::vector<double> mGPUTimes; //!< GPU time of each frame
+        std::vector<std::pair<std::string, std::vector<double>>> mPassTimes; //!< CPU time of each pass for each frame
+        std::vector<std::pair<std::string, std::vector<double>>> mGPUPassTimes; //!< GPU time of each pass for each frame
+
+        /**
+         * @brief Create Nodes described by the script
+         * @param[in] sceneManager
+         */
+        void mBuildScene(SceneManager &sceneManager);
+
+        /**
+         * @brief Interpolate the Camera path
+         * @param[in] frame : index of frame
+         * @return The key for this frame
+         */
+        BenchmarkKey mKey(u32 frame) const;
+
+        /**
+         * @brief Get all metrics with their name, like "cpu.p95" or "gpuPasses.depth.p50"
+         * @return pairs name, value in milliseconds
+         */
+        std::vector<std::pair<std::string, double>> mMetrics(void) const;
+    };
+
+    /**
+     * @brief Compute mean and percentiles (nearest rank)
+     * @param[in] times : serie of times
+     * @return statistics
+     */
+    BenchmarkStatistics computeStatistics(std::vector<double> times);
+}
+
+#endif // BENCHMARK_H
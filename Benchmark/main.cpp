@@ -0,0 +1,80 @@
+#include "include/include.h"
+#include "Debug/debug.h"
+#include "benchmark.h"
+
+using namespace std;
+using namespace GXY;
+
+int main(int argc, char *argv[])
+{
+    string pathScript, pathReport, pathBaseline, pathTrace;
+    double tolerance = 0.05;
+    bool window = false;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+
+        if((arg == "-o" || arg == "--output") && i + 1 < argc)
+            pathReport = argv[++i];
+
+        else if((arg == "-b" || arg == "--baseline") && i + 1 < argc)
+            pathBaseline = argv[++i];
+
+        else if((arg == "-t" || arg == "--tolerance") && i + 1 < argc)
+            tolerance = atof(argv[++i]);
+
+        else if(arg == "--trace" && i + 1 < argc)
+            pathTrace = argv[++i];
+
+        else if(arg == "--window")
+            window = true;
+
+        else
+            pathScript = arg;
+    }
+
+    if(pathScript.empty())
+    {
+        cerr << "Usage : " << argv[0] << " script.bench [-o report.json] [-b baseline.json] [-t tolerance] [--trace trace.json] [--window]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        Benchmark benchmark(pathScript);
+
+        // Shaders and models are found from the root of the repository
+        shared_ptr<Device> device = window ? make_shared<Device>(benchmark.width(), benchmark.height()) :
+                                             make_shared<Device>(benchmark.width(), benchmark.height(), HEADLESS);
+
+        benchmark.run(*device);
+
+        if(!pathTrace.empty())
+        {
+            ofstream trace(pathTrace);
+            writeChromeTrace(trace);
+        }
+
+        if(pathReport.empty())
+            benchmark.writeJSON(cout);
+
+        else
+        {
+            ofstream report(pathReport);
+            benchmark.writeJSON(report);
+        }
+
+        // The report can be on the standard output : it stays valid JSON
+        if(!pathBaseline.empty() && !benchmark.compare(pathBaseline, tolerance, cerr))
+            return EXIT_FAILURE;
+    }
+
+    catch(Except &exc)
+    {
+        std::cerr << exc.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -7,6 +7,12 @@
 
 #include "camera.h"
 
+#if defined(__AVX__)
+    #include <immintrin.h>
+#elif defined(__SSE__)
+    #include <xmmintrin.h>
+#endif
+
 using namespace glm;
 
 namespace GXY
@@ -57,24 +63,105 @@ namespace GXY
 
     bool Frustrum::boxInside(const AABB3D &box) const
     {
+        return boxInside(box.center.xyz(), box.extent.xyz());
+    }
+
+    bool Frustrum::boxInside(vec3 const &center, vec3 const &extent) const
+    {
+        // Distance of the corner the most in front of the plane
         for(u32 i = 0; i < 6; ++i)
+            if(distancePlane(mPlanes[i], center) + dot(abs(mPlanes[i].plane.xyz()), extent) <= 0.0f)
+                return false;
+
+        return true;
+    }
+
+    void Frustrum::boxesInside(BoundsBatch const &boxes, std::vector<u32> &visible) const
+    {
+        u32 size = boxes.size();
+        u32 i = 0;
+
+        visible.assign((size + 31) / 32, 0);
+
+        for(; i + 8 <= size; i += 8)
+            visible[i / 32] |= mBoxesInside8(boxes, i) << (i % 32);
+
+        for(; i < size; ++i)
         {
-            bool in = false;
+            vec3 center(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+            vec3 extent(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+
+            if(boxInside(center, extent))
+                visible[i / 32] |= 1u << (i % 32);
+        }
+    }
+
+#if defined(__AVX__)
+    u32 Frustrum::mBoxesInside8(BoundsBatch const &boxes, u32 first) const
+    {
+        __m256 cx = _mm256_loadu_ps(&boxes.centerX[first]), cy = _mm256_loadu_ps(&boxes.centerY[first]), cz = _mm256_loadu_ps(&boxes.centerZ[first]);
+        __m256 ex = _mm256_loadu_ps(&boxes.extentX[first]), ey = _mm256_loadu_ps(&boxes.extentY[first]), ez = _mm256_loadu_ps(&boxes.extentZ[first]);
+        __m256 zero = _mm256_setzero_ps();
+        __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
 
-            for(u32 j = 0; j < 8 && !in; ++j)
+        for(u32 i = 0; i < 6; ++i)
+        {
+            vec4 const &plane = mPlanes[i].plane;
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)), _mm256_mul_ps(cy, _mm256_set1_ps(plane.y))),
+                                            _mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+            __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(std::abs(plane.x))), _mm256_mul_ps(ey, _mm256_set1_ps(std::abs(plane.y)))),
+                                          _mm256_mul_ps(ez, _mm256_set1_ps(std::abs(plane.z))));
+
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GT_OQ));
+        }
+
+        return _mm256_movemask_ps(inside);
+    }
+#elif defined(__SSE__)
+    u32 Frustrum::mBoxesInside8(BoundsBatch const &boxes, u32 first) const
+    {
+        u32 mask = 0;
+
+        for(u32 j = 0; j < 8; j += 4)
+        {
+            __m128 cx = _mm_loadu_ps(&boxes.centerX[first + j]), cy = _mm_loadu_ps(&boxes.centerY[first + j]), cz = _mm_loadu_ps(&boxes.centerZ[first + j]);
+            __m128 ex = _mm_loadu_ps(&boxes.extentX[first + j]), ey = _mm_loadu_ps(&boxes.extentY[first + j]), ez = _mm_loadu_ps(&boxes.extentZ[first + j]);
+            __m128 zero = _mm_setzero_ps();
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+            for(u32 i = 0; i < 6; ++i)
             {
-                if(distancePlane(mPlanes[i], box.coord[j].xyz()) > 0.0)
-                {
-                    in = true;
-                    break;
-                }
+                vec4 const &plane = mPlanes[i].plane;
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+                                             _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::abs(plane.x))), _mm_mul_ps(ey, _mm_set1_ps(std::abs(plane.y)))),
+                                           _mm_mul_ps(ez, _mm_set1_ps(std::abs(plane.z))));
+
+                inside = _mm_and_ps(inside, _mm_cmpgt_ps(_mm_add_ps(distance, radius), zero));
             }
 
-            if(!in)
-                return false;
+            mask |= _mm_movemask_ps(inside) << j;
         }
-        return true;
+
+        return mask;
+    }
+#else
+    u32 Frustrum::mBoxesInside8(BoundsBatch const &boxes, u32 first) const
+    {
+        u32 mask = 0;
+
+        for(u32 j = 0; j < 8; ++j)
+        {
+            u32 i = first + j;
+
+            if(boxInside(vec3(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]),
+                         vec3(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i])))
+                mask |= 1u << j;
+        }
+
+        return mask;
     }
+#endif
 
     bool Frustrum::sphereInside(const Sphere &sphere) const
     {
@@ -14,6 +14,41 @@
 
 namespace GXY
 {
+    /**
+     * @brief Boxes in center / extent form, stored component by component for the batched culling
+     */
+    struct BoundsBatch
+    {
+        std::vector<float> centerX, centerY, centerZ; //!< Centers of boxes
+        std::vector<float> extentX, extentY, extentZ; //!< Half sizes of boxes
+
+        /**
+         * @brief Add one box
+         * @param[in] center : Center of the box
+         * @param[in] extent : Half size of the box
+         */
+        inline void push(glm::vec3 const &center, glm::vec3 const &extent)
+        {
+            centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+            extentX.push_back(extent.x); extentY.push_back(extent.y); extentZ.push_back(extent.z);
+        }
+
+        /**
+         * @brief Remove all boxes
+         */
+        inline void clear(void)
+        {
+            centerX.clear(); centerY.clear(); centerZ.clear();
+            extentX.clear(); extentY.clear(); extentZ.clear();
+        }
+
+        /**
+         * @brief Get the number of boxes
+         * @return number of boxes
+         */
+        inline u32 size(void) const {return centerX.size();}
+    };
+
     /**
      * @brief The Frustrum class
      *
@@ -34,6 +69,21 @@ namespace GXY
          */
         bool boxInside(AABB3D const &box) const;
 
+        /**
+         * @brief To know if a box given by its center and its half size is inside the frustrum or not
+         * @param[in] center : Center of the box
+         * @param[in] extent : Half size of the box
+         * @return true if it is inside and false else
+         */
+        bool boxInside(glm::vec3 const &center, glm::vec3 const &extent) const;
+
+        /**
+         * @brief Test many boxes, 8 (AVX) or 4 (SSE) at once
+         * @param[in] boxes : The boxes
+         * @param[out] visible : bit (i % 32) of visible[i / 32] is set if the box i is inside
+         */
+        void boxesInside(BoundsBatch const &boxes, std::vector<u32> &visible) const;
+
         /**
          * @brief To know if a sphere is inside the frustrum or not
          * @param[in][in] sphere : The sphere
@@ -56,6 +106,15 @@ namespace GXY
 
     public :
         Plane mPlanes[6]; //!< TOP, BOTTOM, RIGHT, LEFT, NEAR, PLANE
+
+    private:
+        /**
+         * @brief Test 8 boxes
+         * @param[in] boxes : The boxes
+         * @param[in] first : Index of the first box, boxes has to own first + 8 boxes
+         * @return bit i is set if the box first + i is inside
+         */
+        u32 mBoxesInside8(BoundsBatch const &boxes, u32 first) const;
 };
 
     /**
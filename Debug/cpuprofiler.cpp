@@ -0,0 +1,226 @@
+/*!
+ * \file cpuprofiler.cpp
+ * \brief Measure CPU time of zones on all threads
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#include "cpuprofiler.h"
+#include "gpuprofiler.h"
+#include "../System/device.h"
+
+using namespace std;
+
+namespace GXY
+{
+    static u64 const EVENTS_PER_THREAD = 1 << 14; //!< Size of the ring of each thread, a power of 2
+
+    static atomic<u64> profilerId(0); //!< Identifier of the next CPUProfiler
+
+    /**
+     * @brief State of the calling thread
+     */
+    struct ThreadState
+    {
+        u64 id; //!< Identifier of the profiler of buffer
+        void *buffer; //!< Ring of the thread in this profiler
+        CPUZone *current; //!< Innermost zone recorded
+    };
+
+    static thread_local ThreadState threadState = {0, nullptr, nullptr};
+
+    CPUProfiler::CPUProfiler(void) :
+        mEnabled(true), mId(++profilerId), mCaptureBegin(0.0), mCaptureEnd(DBL_MAX)
+    {
+
+    }
+
+    CPUProfiler::ThreadBuffer *CPUProfiler::mThreadBuffer(void)
+    {
+        if(threadState.id == mId)
+            return static_cast<ThreadBuffer*>(threadState.buffer);
+
+        lock_guard<mutex> lock(mMutex);
+
+        unique_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+        buffer->thread = mBuffers.size();
+        buffer->name = nullptr;
+        buffer->events.resize(EVENTS_PER_THREAD);
+        buffer->head.store(0, memory_order_relaxed);
+
+        threadState.id = mId;
+        threadState.buffer = buffer.get();
+        threadState.current = nullptr;
+
+        mBuffers.push_back(move(buffer));
+
+        return mBuffers.back().get();
+    }
+
+    void CPUProfiler::setCapture(bool capture)
+    {
+        if(capture)
+        {
+            mCaptureEnd.store(DBL_MAX);
+            mCaptureBegin.store(profilerTime());
+        }
+
+        else
+            mCaptureEnd.store(profilerTime());
+    }
+
+    void CPUProfiler::setThreadName(char const *name)
+    {
+        mThreadBuffer()->name = name;
+    }
+
+    vector<CPUTiming> CPUProfiler::captured(void) const
+    {
+        vector<CPUTiming> timings;
+        double begin = mCaptureBegin.load(), end = mCaptureEnd.load();
+
+        lock_guard<mutex> lock(mMutex);
+
+        for(auto const &buffer : mBuffers)
+        {
+            u64 head = buffer->head.load(memory_order_acquire);
+            u64 first = (head > EVENTS_PER_THREAD) ? head - EVENTS_PER_THREAD : 0;
+
+            for(u64 i = first; i < head; ++i)
+            {
+                CPUTiming const &timing = buffer->events[i & (EVENTS_PER_THREAD - 1)];
+
+                if(timing.start >= begin && timing.start <= end)
+                    timings.push_back(timing);
+            }
+        }
+
+        sort(timings.begin(), timings.end(), [](CPUTiming const &a, CPUTiming const &b){return a.start < b.start;});
+
+        return timings;
+    }
+
+    u64 CPUProfiler::droppedZones(void) const
+    {
+        u64 dropped = 0;
+
+        lock_guard<mutex> lock(mMutex);
+
+        for(auto const &buffer : mBuffers)
+        {
+            u64 head = buffer->head.load(memory_order_relaxed);
+
+            if(head > EVENTS_PER_THREAD)
+                dropped += head - EVENTS_PER_THREAD;
+        }
+
+        return dropped;
+    }
+
+    void CPUProfiler::writeChromeEvents(ostream &stream) const
+    {
+        auto flags = stream.flags();
+
+        {
+            lock_guard<mutex> lock(mMutex);
+
+            // GPU is on the thread 0
+            for(auto const &buffer : mBuffers)
+            {
+                stream << "," << endl << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << buffer->thread + 1 << ", \"args\": {\"name\": \"";
+
+                if(buffer->name != nullptr)
+                    stream << buffer->name << "\"}}";
+
+                else
+                    stream << "CPU " << buffer->thread << "\"}}";
+            }
+        }
+
+        for(auto const &timing : captured())
+        {
+            stream << "," << endl << "{\"name\": \"" << timing.name << "\", \"cat\": \"cpu\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << timing.thread + 1 << ", "
+                   << "\"ts\": " << fixed << timing.start * 1000.0 << ", \"dur\": " << timing.duration * 1000.0 << ", \"args\": {";
+
+            for(u32 i = 0; i < timing.numCounters; ++i)
+                stream << (i == 0 ? "" : ", ") << "\"" << timing.counters[i].name << "\": " << timing.counters[i].value;
+
+            stream << "}}";
+        }
+
+        stream.flags(flags);
+    }
+
+    CPUProfiler::~CPUProfiler(void)
+    {
+
+    }
+
+    CPUZone::CPUZone(char const *name) :
+        mBuffer(nullptr), mParent(nullptr)
+    {
+        if(global == nullptr || global->cpuProfiler == nullptr || !global->cpuProfiler->isEnabled())
+            return;
+
+        mBuffer = global->cpuProfiler->mThreadBuffer();
+        mParent = threadState.current;
+        threadState.current = this;
+
+        mTiming.name = name;
+        mTiming.thread = mBuffer->thread;
+        mTiming.depth = (mParent == nullptr) ? 0 : mParent->mTiming.depth + 1;
+        mTiming.numCounters = 0;
+        mTiming.start = profilerTime();
+    }
+
+    void CPUZone::counter(char const *name, s64 value)
+    {
+        CPUZone *zone = threadState.current;
+
+        if(zone == nullptr)
+            return;
+
+        CPUTiming &timing = zone->mTiming;
+
+        for(u32 i = 0; i < timing.numCounters; ++i)
+        {
+            // Names are literals, the same literal has the same address
+            if(timing.counters[i].name == name || strcmp(timing.counters[i].name, name) == 0)
+            {
+                timing.counters[i].value += value;
+                return;
+            }
+        }
+
+        if(timing.numCounters < MAX_ZONE_COUNTERS)
+            timing.counters[timing.numCounters++] = {name, value};
+    }
+
+    CPUZone::~CPUZone(void)
+    {
+        if(mBuffer == nullptr)
+            return;
+
+        mTiming.duration = profilerTime() - mTiming.start;
+        threadState.current = mParent;
+
+        // Only this thread writes in its ring, the atomic publishes the event to the readers
+        u64 head = mBuffer->head.load(memory_order_relaxed);
+        mBuffer->events[head & (EVENTS_PER_THREAD - 1)] = mTiming;
+        mBuffer->head.store(head + 1, memory_order_release);
+    }
+
+    void writeChromeTrace(ostream &stream)
+    {
+        stream << "{\"traceEvents\": [" << endl;
+        stream << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"Galaxy\"}}";
+
+        if(global != nullptr && global->gpuProfiler != nullptr)
+            global->gpuProfiler->writeChromeEvents(stream);
+
+        if(global != nullptr && global->cpuProfiler != nullptr)
+            global->cpuProfiler->writeChromeEvents(stream);
+
+        stream << endl << "]}" << endl;
+    }
+}
@@ -0,0 +1,217 @@
+/*!
+ * \file cpuprofiler.h
+ * \brief Measure CPU time of zones on all threads
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#ifndef CPUPROFILER_H
+#define CPUPROFILER_H
+
+#include "../include/include.h"
+#include "../include/constant.h"
+
+/**
+ * Zones and counters are compiled only with GXY_PROFILE (see Engine.pri),
+ * without it, GXY_ZONE and GXY_COUNTER expand to nothing
+ */
+#ifdef GXY_PROFILE
+    #define GXY_ZONE_CONCAT2(a, b) a ## b
+    #define GXY_ZONE_CONCAT(a, b) GXY_ZONE_CONCAT2(a, b)
+    #define GXY_ZONE(name) GXY::CPUZone GXY_ZONE_CONCAT(gxyZone, __LINE__)(name)
+    #define GXY_COUNTER(name, value) GXY::CPUZone::counter(name, (GXY::s64)(value))
+#else
+    #define GXY_ZONE(name) ((void)0)
+    #define GXY_COUNTER(name, value) ((void)0)
+#endif
+
+namespace GXY
+{
+    /**
+      * @example CPUProfiler cpuProfilerExample.cpp
+      * @code{.cpp}
+      * void Node::pushModelsInPipeline(void)
+      * {
+      *     GXY_ZONE("Node::pushModelsInPipeline");
+      *     GXY_COUNTER("models", mModels.size()); // Shown in the args of the zone
+      *     ...
+      * }
+      *
+      * std::ofstream trace("trace.json");
+      * GXY::writeChromeTrace(trace); // CPU zones of all threads and GPU scopes
+      * @endcode
+      */
+
+    u32 const MAX_ZONE_COUNTERS = 4; //!< Number of different counters in one zone
+
+    /**
+     * @brief One counter of a zone
+     */
+    struct CPUCounter
+    {
+        char const *name; //!< Name of the counter
+        s64 value; //!< Sum of all values given during the zone
+    };
+
+    /**
+     * @brief Time taken by one zone on one thread
+     */
+    struct CPUTiming
+    {
+        char const *name; //!< Name of the zone
+        u32 thread; //!< Index of the thread in the profiler
+        u32 depth; //!< Number of zones opened around it on the same thread
+        double start; //!< Start in milliseconds, on std::chrono::steady_clock
+        double duration; //!< Duration in milliseconds
+        u32 numCounters; //!< Number of counters used
+        CPUCounter counters[MAX_ZONE_COUNTERS]; //!< Counters
+    };
+
+    /**
+     * @brief The CPUProfiler class
+     *
+     * Each thread writes its zones in its own ring of events, without lock :
+     * the thread is the only writer, and it publishes the position of the last
+     * event with an atomic. The mutex is only taken the first time a thread
+     * writes a zone, to register its ring.
+     */
+    class CPUProfiler
+    {
+    public:
+        /**
+         * @brief CPUProfiler Constructor
+         */
+        CPUProfiler(void);
+
+        CPUProfiler(CPUProfiler const &profiler) = delete;
+        CPUProfiler &operator=(CPUProfiler const &profiler) = delete;
+
+        /**
+         * @brief Enable or disable all zones
+         * @param[in] enable
+         */
+        inline void setEnabled(bool enable) {mEnabled.store(enable, std::memory_order_relaxed);}
+
+        /**
+         * @brief Know if zones are recorded
+         * @return true if enabled
+         */
+        inline bool isEnabled(void) const {return mEnabled.load(std::memory_order_relaxed);}
+
+        /**
+         * @brief Keep only zones which begin after setCapture(true) and before setCapture(false)
+         * @param[in] capture : start (true) or stop (false) the capture
+         */
+        void setCapture(bool capture);
+
+        /**
+         * @brief Give a name to the calling thread in the trace
+         * @param[in] name : a literal
+         */
+        void setThreadName(char const *name);
+
+        /**
+         * @brief Get all zones captured, of all threads
+         *
+         * Zones still written by other threads at this moment may be wrong,
+         * call it when the work to measure is finished
+         * @return Zones sorted by start
+         */
+        std::vector<CPUTiming> captured(void) const;
+
+        /**
+         * @brief Write zones captured as Chrome Trace Event, without the array around them
+         * @param[in] stream : where JSON is written, each event begins by a comma
+         */
+        void writeChromeEvents(std::ostream &stream) const;
+
+        /**
+         * @brief Get the number of zones overwritten because their ring was full
+         * @return number of zones
+         */
+        u64 droppedZones(void) const;
+
+        /**
+         * @brief CPUProfiler Destructor
+         */
+        ~CPUProfiler(void);
+
+    private:
+        friend class CPUZone;
+
+        /**
+         * @brief Ring of events of one thread
+         */
+        struct ThreadBuffer
+        {
+            u32 thread; //!< Index of the thread
+            char const *name; //!< Name of the thread
+            std::vector<CPUTiming> events; //!< Ring of events
+            std::atomic<u64> head; //!< Number of events written since the beginning
+        };
+
+        std::vector<std::unique_ptr<ThreadBuffer>> mBuffers; //!< Rings of all threads
+        mutable std::mutex mMutex; //!< Protect mBuffers
+        std::atomic<bool> mEnabled; //!< Zones are enabled
+        u64 mId; //!< Unique identifier, to know if a thread is registered in this profiler
+
+        std::atomic<double> mCaptureBegin; //!< Zones beginning before are ignored
+        std::atomic<double> mCaptureEnd; //!< Zones beginning after are ignored
+
+        /**
+         * @brief Get the ring of the calling thread, register it if needed
+         * @return The ring
+         */
+        ThreadBuffer *mThreadBuffer(void);
+    };
+
+    /**
+     * @brief Record one zone of the CPUProfiler while it is alive, use GXY_ZONE
+     */
+    class CPUZone
+    {
+    public:
+        /**
+         * @brief CPUZone Constructor
+         * @param[in] name : Name of the zone, a literal
+         */
+        CPUZone(char const *name);
+
+        CPUZone(CPUZone const &zone) = delete;
+        CPUZone &operator=(CPUZone const &zone) = delete;
+
+        /**
+         * @brief Add value to the counter name of the innermost zone of the calling thread, use GXY_COUNTER
+         * @param[in] name : Name of the counter, a literal
+         * @param[in] value : value to add
+         */
+        static void counter(char const *name, s64 value);
+
+        /**
+         * @brief CPUZone Destructor : write the zone in the ring of its thread
+         */
+        ~CPUZone(void);
+
+    private:
+        CPUProfiler::ThreadBuffer *mBuffer; //!< Ring of the thread, nullptr if the zone is not recorded
+        CPUZone *mParent; //!< Zone opened before on the same thread
+        CPUTiming mTiming; //!< Zone being recorded
+    };
+
+    /**
+     * @brief Get the current time on the clock of profilers
+     * @return time in milliseconds
+     */
+    inline double profilerTime(void)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Write CPU zones and GPU scopes captured in the same Chrome Trace (chrome://tracing)
+     * @param[in] stream : where JSON is written
+     */
+    void writeChromeTrace(std::ostream &stream);
+}
+
+#endif // CPUPROFILER_H
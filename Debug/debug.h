@@ -52,6 +52,8 @@ namespace GXY
     template<typename func, typename ...Args>
     /**
      * @brief function which return time taken by function
+     *
+     * It waits for the result, so use it outside the render loop, GPUMarker is better inside
      * @param[in] function : the function send to "time"
      * @param[in] args : argument for function
      */
@@ -63,14 +65,11 @@ namespace GXY
         glGenQueries(1, &query);
         glBeginQuery(GL_TIME_ELAPSED, query);
             function(std::forward<Args>(args)...);
-            GXY::synchronize();
-
         glEndQuery(GL_TIME_ELAPSED);
 
-        while(!resultQuery)
-            glGetQueryObjectui64v(query, GL_QUERY_RESULT_AVAILABLE, &resultQuery);
-
+        // GL_QUERY_RESULT waits by itself, without polling and without changing the measure
         glGetQueryObjectui64v(query, GL_QUERY_RESULT, &resultQuery);
+        glDeleteQueries(1, &query);
 
         std::cout << "This function take : " << (double)resultQuery / 1000000 << " ms to be executed." << std::endl;
     }
@@ -0,0 +1,207 @@
+/*!
+ * \file gpuprofiler.cpp
+ * \brief Measure GPU time of passes without stall
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#include "gpuprofiler.h"
+#include "cpuprofiler.h"
+#include "../System/device.h"
+
+using namespace std;
+
+namespace GXY
+{
+    static u32 const NO_QUERY = 0xFFFFFFFF; //!< Scope without query : outside a frame or disabled
+
+    GPUProfiler::GPUProfiler(void) :
+        mFrames(FRAMES_IN_FLIGHT + 1), mCurrent(nullptr), mFrameIndex(0),
+        mEnabled(true), mCapture(false), mDroppedFrames(0)
+    {
+        for(auto &frame : mFrames)
+        {
+            frame.index = 0;
+            frame.pending = false;
+            frame.numQueries = 0;
+        }
+
+        // Put GPU timestamps on the CPU clock, so both timelines can be merged
+        s64 gpuTime;
+        glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+        mOffset = profilerTime() - (double)gpuTime / 1000000.0;
+    }
+
+    u32 GPUProfiler::mTimestamp(void)
+    {
+        if(mCurrent->numQueries == mCurrent->queries.size())
+        {
+            u32 query;
+            glGenQueries(1, &query);
+            mCurrent->queries.push_back(query);
+        }
+
+        glQueryCounter(mCurrent->queries[mCurrent->numQueries], GL_TIMESTAMP);
+
+        return mCurrent->numQueries++;
+    }
+
+    void GPUProfiler::beginFrame(void)
+    {
+        Frame &frame = mFrames[mFrameIndex % mFrames.size()];
+
+        // This frame is FRAMES_IN_FLIGHT frames old, the GPU should have finished it
+        mRead(frame, false);
+
+        frame.index = mFrameIndex++;
+        frame.pending = mEnabled;
+        frame.numQueries = 0;
+        frame.scopes.clear();
+
+        mCurrent = &frame;
+        mStack.clear();
+
+        push("frame");
+    }
+
+    void GPUProfiler::endFrame(void)
+    {
+        while(!mStack.empty())
+            pop();
+
+        mCurrent = nullptr;
+    }
+
+    void GPUProfiler::push(char const *name)
+    {
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+
+        if(!mEnabled || mCurrent == nullptr || !mCurrent->pending)
+        {
+            mStack.push_back(NO_QUERY);
+            return;
+        }
+
+        Scope scope;
+        scope.name = name;
+        scope.depth = mStack.size();
+        scope.begin = mTimestamp();
+        scope.end = NO_QUERY;
+
+        mStack.push_back(mCurrent->scopes.size());
+        mCurrent->scopes.push_back(scope);
+    }
+
+    void GPUProfiler::pop(void)
+    {
+        if(mStack.empty())
+            return;
+
+        u32 scope = mStack.back();
+        mStack.pop_back();
+
+        if(scope != NO_QUERY && mCurrent != nullptr)
+            mCurrent->scopes[scope].end = mTimestamp();
+
+        glPopDebugGroup();
+    }
+
+    void GPUProfiler::mRead(Frame &frame, bool wait)
+    {
+        if(!frame.pending)
+            return;
+
+        frame.pending = false;
+
+        if(frame.numQueries == 0)
+            return;
+
+        // Timestamps are written in order, if the last one is available, all are available
+        if(!wait)
+        {
+            s32 available = 0;
+            glGetQueryObjectiv(frame.queries[frame.numQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if(!available)
+            {
+                ++mDroppedFrames;
+                return;
+            }
+        }
+
+        vector<u64> times(frame.numQueries);
+
+        for(u32 i = 0; i < frame.numQueries; ++i)
+            glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &times[i]);
+
+        mLastFrame.clear();
+
+        for(auto const &scope : frame.scopes)
+        {
+            if(scope.end == NO_QUERY)
+                continue;
+
+            GPUTiming timing;
+            timing.name = scope.name;
+            timing.depth = scope.depth;
+            timing.frame = frame.index;
+            timing.start = (double)times[scope.begin] / 1000000.0 + mOffset;
+            timing.duration = (double)(times[scope.end] - times[scope.begin]) / 1000000.0;
+
+            mLastFrame.push_back(timing);
+        }
+
+        if(mCapture)
+            mCaptured.insert(mCaptured.end(), mLastFrame.begin(), mLastFrame.end());
+    }
+
+    void GPUProfiler::flush(void)
+    {
+        // From the oldest to the newest
+        for(u64 i = 0; i < mFrames.size(); ++i)
+            mRead(mFrames[(mFrameIndex + i) % mFrames.size()], true);
+    }
+
+    void GPUProfiler::setCapture(bool capture)
+    {
+        if(capture && !mCapture)
+            mCaptured.clear();
+
+        mCapture = capture;
+    }
+
+    void GPUProfiler::writeChromeEvents(ostream &stream) const
+    {
+        auto flags = stream.flags();
+
+        stream << "," << endl << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, \"args\": {\"name\": \"GPU\"}}";
+
+        for(auto const &timing : mCaptured)
+        {
+            stream << "," << endl << "{\"name\": \"" << timing.name << "\", \"cat\": \"gpu\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0, "
+                   << "\"ts\": " << fixed << timing.start * 1000.0 << ", \"dur\": " << timing.duration * 1000.0
+                   << ", \"args\": {\"frame\": " << timing.frame << "}}";
+        }
+
+        stream.flags(flags);
+    }
+
+    GPUProfiler::~GPUProfiler(void)
+    {
+        for(auto &frame : mFrames)
+            if(!frame.queries.empty())
+                glDeleteQueries(frame.queries.size(), &frame.queries[0]);
+    }
+
+    GPUMarker::GPUMarker(char const *name)
+    {
+        if(global != nullptr && global->gpuProfiler != nullptr)
+            global->gpuProfiler->push(name);
+    }
+
+    GPUMarker::~GPUMarker(void)
+    {
+        if(global != nullptr && global->gpuProfiler != nullptr)
+            global->gpuProfiler->pop();
+    }
+}
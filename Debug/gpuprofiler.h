@@ -0,0 +1,207 @@
+/*!
+ * \file gpuprofiler.h
+ * \brief Measure GPU time of passes without stall
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+#include "../include/include.h"
+#include "../include/constant.h"
+
+namespace GXY
+{
+    /**
+      * @example GPUProfiler profilerExample.cpp
+      * @code{.cpp}
+      * {
+      *     GXY::GPUMarker marker("depth"); // Debug group and timestamps around the pass
+      *     renderDepthPass();
+      * }
+      *
+      * // Some frames later
+      * for(auto const &timing : GXY::global->gpuProfiler->lastFrame())
+      *     std::cout << timing.name << " : " << timing.duration << " ms" << std::endl;
+      * @endcode
+      */
+
+    /**
+     * @brief Time taken by one scope on the GPU
+     */
+    struct GPUTiming
+    {
+        char const *name; //!< Name of the scope
+        u32 depth; //!< 0 for the whole frame, 1 for a pass, ...
+        u64 frame; //!< Index of frame
+        double start; //!< Start in milliseconds, on the same clock as profilerTime()
+        double duration; //!< Duration in milliseconds
+    };
+
+    /**
+     * @brief The GPUProfiler class
+     *
+     * Each scope writes two GL_TIMESTAMP queries. Queries of one frame are read
+     * FRAMES_IN_FLIGHT frames later, when the GPU has already finished it, so
+     * the measure never waits for the GPU and does not change the cost of passes.
+     */
+    class GPUProfiler
+    {
+    public:
+        /**
+         * @brief GPUProfiler Constructor, the OpenGL Context has to be current
+         */
+        GPUProfiler(void);
+
+        GPUProfiler(GPUProfiler const &profiler) = delete;
+        GPUProfiler &operator=(GPUProfiler const &profiler) = delete;
+
+        /**
+         * @brief Begin a new frame, and read the frame which used the same queries before
+         */
+        void beginFrame(void);
+
+        /**
+         * @brief End the current frame
+         */
+        void endFrame(void);
+
+        /**
+         * @brief Open one scope, and one debug group with the same name
+         * @param[in] name : Name of the scope, it has to live as long as the profiler (a literal)
+         */
+        void push(char const *name);
+
+        /**
+         * @brief Close the last opened scope
+         */
+        void pop(void);
+
+        /**
+         * @brief Wait and read all frames not yet read, used at the end of a capture
+         */
+        void flush(void);
+
+        /**
+         * @brief Enable or disable all measures. Debug groups stay
+         * @param[in] enable
+         */
+        inline void setEnabled(bool enable) {mEnabled = enable;}
+
+        /**
+         * @brief Keep all timings to write them later in a trace
+         * @param[in] capture : start (true) or stop (false) the capture
+         */
+        void setCapture(bool capture);
+
+        /**
+         * @brief Get timings of the last frame read
+         * @return Scopes in order of opening, the first one is the whole frame
+         */
+        inline std::vector<GPUTiming> const &lastFrame(void) const {return mLastFrame;}
+
+        /**
+         * @brief Get the GPU time of the last frame read
+         * @return time in milliseconds, 0 if no frame is read
+         */
+        inline double frameTime(void) const {return mLastFrame.empty() ? 0.0 : mLastFrame[0].duration;}
+
+        /**
+         * @brief Get all timings captured
+         * @return Scopes of all frames since setCapture(true)
+         */
+        inline std::vector<GPUTiming> const &captured(void) const {return mCaptured;}
+
+        /**
+         * @brief Get the number of frames lost because their queries were not available in time
+         * @return number of frames
+         */
+        inline u64 droppedFrames(void) const {return mDroppedFrames;}
+
+        /**
+         * @brief Write timings captured as Chrome Trace Event, without the array around them, see writeChromeTrace
+         * @param[in] stream : where JSON is written, each event begins by a comma
+         */
+        void writeChromeEvents(std::ostream &stream) const;
+
+        /**
+         * @brief GPUProfiler Destructor
+         */
+        ~GPUProfiler(void);
+
+    private:
+        /**
+         * @brief A scope opened during one frame
+         */
+        struct Scope
+        {
+            char const *name; //!< Name
+            u32 depth; //!< Depth
+            u32 begin; //!< Index of the query at the opening
+            u32 end; //!< Index of the query at the closing
+        };
+
+        /**
+         * @brief All queries of one frame
+         */
+        struct Frame
+        {
+            u64 index; //!< Index of frame
+            bool pending; //!< Queries have to be read
+            u32 numQueries; //!< Number of queries used
+            std::vector<u32> queries; //!< Pool of queries
+            std::vector<Scope> scopes; //!< Scopes opened
+        };
+
+        std::vector<Frame> mFrames; //!< Ring of frames
+        Frame *mCurrent; //!< Frame being recorded, nullptr outside beginFrame / endFrame
+        std::vector<u32> mStack; //!< Opened scopes
+        u64 mFrameIndex; //!< Index of the next frame
+
+        bool mEnabled; //!< Measures are enabled
+        bool mCapture; //!< Timings are kept
+        u64 mDroppedFrames; //!< Frames not read
+
+        double mOffset; //!< CPU time - GPU time in milliseconds
+
+        std::vector<GPUTiming> mLastFrame; //!< Timings of the last frame read
+        std::vector<GPUTiming> mCaptured; //!< All timings captured
+
+        /**
+         * @brief Write one timestamp in the current frame
+         * @return Index of the query
+         */
+        u32 mTimestamp(void);
+
+        /**
+         * @brief Read the queries of one frame
+         * @param[in] frame : the frame
+         * @param[in] wait : wait for the GPU or drop the frame if it is not available
+         */
+        void mRead(Frame &frame, bool wait);
+    };
+
+    /**
+     * @brief Open a scope of the GPUProfiler while it is alive
+     */
+    class GPUMarker
+    {
+    public:
+        /**
+         * @brief GPUMarker Constructor
+         * @param[in] name : Name of the scope, a literal
+         */
+        GPUMarker(char const *name);
+
+        GPUMarker(GPUMarker const &marker) = delete;
+        GPUMarker &operator=(GPUMarker const &marker) = delete;
+
+        /**
+         * @brief GPUMarker Destructor
+         */
+        ~GPUMarker(void);
+    };
+}
+
+#endif // GPUPROFILER_H
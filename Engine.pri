@@ -0,0 +1,97 @@
+CONFIG += c++14
+
+QMAKE_CXXFLAGS += -std=c++1y
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+# Frustrum::boxesInside tests 8 boxes at once with AVX, 2 x 4 with SSE else
+# QMAKE_CXXFLAGS += -mavx
+
+LIBS += -lSDL2
+LIBS += -lSDL2_image
+LIBS += -lGLEW
+LIBS += -lGL
+LIBS += -lEGL
+LIBS += -lassimp
+LIBS += -lpthread
+
+INCLUDEPATH += $$PWD
+
+# CPU zones (GXY_ZONE, GXY_COUNTER), remove it to compile them out
+DEFINES += GXY_PROFILE
+
+# Vertices of 16 bytes : octahedral normal and tangent, half texture coordinates, 16 bits material
+# index, positions shared with the depth pass. The MeshCache is rebuilt when it changes
+# DEFINES += GXY_COMPACT_VERTEX
+
+SOURCES += $$PWD/System/device.cpp \
+    $$PWD/System/framebuffer.cpp \
+    $$PWD/System/shader.cpp \
+    $$PWD/System/texture.cpp \
+    $$PWD/System/vertexarray.cpp \
+    $$PWD/System/ressourcemanager.cpp \
+    $$PWD/Camera/camera.cpp \
+    $$PWD/SceneManager/scenemanager.cpp \
+    $$PWD/SceneManager/node.cpp \
+    $$PWD/SceneManager/transformhierarchy.cpp \
+    $$PWD/SceneManager/boundingvolumehierarchy.cpp \
+    $$PWD/System/model.cpp \
+    $$PWD/System/meshcache.cpp \
+    $$PWD/System/meshoptimizer.cpp \
+    $$PWD/System/meshsimplifier.cpp \
+    $$PWD/System/texturecache.cpp \
+    $$PWD/System/jobsystem.cpp \
+    $$PWD/SceneManager/modelnode.cpp \
+    $$PWD/SceneManager/hlodproxy.cpp \
+    $$PWD/SceneManager/pointlightnode.cpp \
+    $$PWD/Debug/gpuprofiler.cpp \
+    $$PWD/Debug/cpuprofiler.cpp
+
+HEADERS += \
+    $$PWD/System/buffer.h \
+    $$PWD/System/device.h \
+    $$PWD/System/framebuffer.h \
+    $$PWD/System/shader.h \
+    $$PWD/System/texture.h \
+    $$PWD/System/vertexarray.h \
+    $$PWD/include/constant.h \
+    $$PWD/include/include.h \
+    $$PWD/Debug/debug.h \
+    $$PWD/Debug/gpuprofiler.h \
+    $$PWD/Debug/cpuprofiler.h \
+    $$PWD/System/ressourcemanager.h \
+    $$PWD/Camera/camera.h \
+    $$PWD/SceneManager/scenemanager.h \
+    $$PWD/SceneManager/node.h \
+    $$PWD/SceneManager/transformhierarchy.h \
+    $$PWD/SceneManager/boundingvolumehierarchy.h \
+    $$PWD/System/model.h \
+    $$PWD/System/meshcache.h \
+    $$PWD/System/meshoptimizer.h \
+    $$PWD/System/meshsimplifier.h \
+    $$PWD/System/texturecache.h \
+    $$PWD/System/jobsystem.h \
+    $$PWD/SceneManager/modelnode.h \
+    $$PWD/SceneManager/hlodproxy.h \
+    $$PWD/SceneManager/pointlightnode.h
+
+DISTFILES += \
+    $$PWD/Shaders/final.frag \
+    $$PWD/Shaders/final.vert \
+    $$PWD/Shaders/model.vert \
+    $$PWD/Shaders/model.frag \
+    $$PWD/Shaders/matrixculling.glsl \
+    $$PWD/Shaders/compactcommands.glsl \
+    $$PWD/Shaders/scattertransforms.glsl \
+    $$PWD/Shaders/hiz.glsl \
+    $$PWD/Shaders/depth.vert \
+    $$PWD/Shaders/ambientocclusion.glsl \
+    $$PWD/Shaders/blurV.glsl \
+    $$PWD/Shaders/blurH.glsl \
+    $$PWD/Shaders/projectpointlight.glsl \
+    $$PWD/Shaders/computepointlight.vert \
+    $$PWD/Shaders/computepointlight.frag \
+    $$PWD/Shaders/pointlightdepth.vert \
+    $$PWD/Shaders/pointlightdepth.frag \
+    $$PWD/Shaders/createvplpoint.vert \
+    $$PWD/Shaders/createvplpoint.frag \
+    $$PWD/Shaders/injectindirect.frag
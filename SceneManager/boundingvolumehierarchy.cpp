@@ -0,0 +1,291 @@
+/*!
+ * \file boundingvolumehierarchy.cpp
+ * \brief Tree of bounding boxes to cull many objects at once
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#include "boundingvolumehierarchy.h"
+
+using namespace std;
+using namespace glm;
+
+namespace GXY
+{
+    u32 const BoundingVolumeHierarchy::NO_ITEM;
+    u32 const BoundingVolumeHierarchy::MAX_LEAF_ITEMS;
+
+    /**
+     * @brief Half of the area of a box, enough to compare trees
+     * @param[in] extent : Half size of the box
+     * @return the area
+     */
+    static inline float area(vec3 const &extent)
+    {
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    BoundingVolumeHierarchy::BoundingVolumeHierarchy(void) :
+        mBuiltCost(0.0f), mCost(0.0f), mRebuild(false), mRefit(false)
+    {
+
+    }
+
+    void BoundingVolumeHierarchy::setBounds(u32 item, AABB3D const &bounds)
+    {
+        if(item >= mPosition.size())
+            mPosition.resize(item + 1, NO_ITEM);
+
+        u32 position = mPosition[item];
+
+        if(position == NO_ITEM)
+        {
+            mPosition[item] = mItems.size();
+            mItems.push_back(item);
+            mItemCenter.push_back(bounds.center.xyz());
+            mItemExtent.push_back(bounds.extent.xyz());
+            mItemLeaf.push_back(0);
+            mRebuild = true;
+            return;
+        }
+
+        mItemCenter[position] = bounds.center.xyz();
+        mItemExtent[position] = bounds.extent.xyz();
+
+        if(!mRebuild)
+        {
+            mNodeDirty[mItemLeaf[position]] = 1;
+            mRefit = true;
+        }
+    }
+
+    void BoundingVolumeHierarchy::mBuild(void)
+    {
+        GXY_ZONE("BoundingVolumeHierarchy::mBuild");
+
+        u32 size = mItems.size();
+        vector<u32> order(size);
+
+        for(u32 i = 0; i < size; ++i)
+            order[i] = i;
+
+        mNodes.clear();
+        mBuiltCost = 0.0f;
+
+        if(size > 0)
+        {
+            mNodes.resize(1);
+            mBuildNode(order, 0, 0, size);
+        }
+
+        // Sort items by leaf : the items of one subtree become contiguous
+        vector<u32> items(size);
+        vector<vec3> centers(size), extents(size);
+
+        for(u32 i = 0; i < size; ++i)
+        {
+            items[i] = mItems[order[i]];
+            centers[i] = mItemCenter[order[i]];
+            extents[i] = mItemExtent[order[i]];
+            mPosition[items[i]] = i;
+        }
+
+        mItems.swap(items);
+        mItemCenter.swap(centers);
+        mItemExtent.swap(extents);
+
+        mNodeDirty.assign(mNodes.size(), 0);
+        mCost = mBuiltCost;
+        mRebuild = mRefit = false;
+
+        GXY_COUNTER("bvhNodes", mNodes.size());
+    }
+
+    void BoundingVolumeHierarchy::mBuildNode(vector<u32> &order, u32 node, u32 first, u32 count)
+    {
+        vec3 minBox(FLT_MAX), maxBox(-FLT_MAX);
+        vec3 minCenter(FLT_MAX), maxCenter(-FLT_MAX);
+
+        for(u32 i = first; i < first + count; ++i)
+        {
+            vec3 const &center = mItemCenter[order[i]];
+            vec3 const &extent = mItemExtent[order[i]];
+
+            minBox = glm::min(minBox, center - extent);
+            maxBox = glm::max(maxBox, center + extent);
+            minCenter = glm::min(minCenter, center);
+            maxCenter = glm::max(maxCenter, center);
+        }
+
+        BVHNode &current = mNodes[node];
+
+        current.center = (minBox + maxBox) * 0.5f;
+        current.extent = (maxBox - minBox) * 0.5f;
+        current.firstItem = first;
+        current.numItems = count;
+        current.left = 0;
+
+        mBuiltCost += area(current.extent);
+
+        if(count <= MAX_LEAF_ITEMS)
+        {
+            for(u32 i = first; i < first + count; ++i)
+                mItemLeaf[i] = node;
+
+            return;
+        }
+
+        // Median of the largest axis of centers : the tree stays balanced, even with boxes at the same place
+        vec3 spread = maxCenter - minCenter;
+        u32 axis = (spread.x > spread.y) ? ((spread.x > spread.z) ? 0 : 2) : ((spread.y > spread.z) ? 1 : 2);
+        u32 middle = first + count / 2;
+
+        nth_element(order.begin() + first, order.begin() + middle, order.begin() + first + count,
+                    [this, axis](u32 a, u32 b){return mItemCenter[a][axis] < mItemCenter[b][axis];});
+
+        u32 left = mNodes.size();
+
+        mNodes.resize(left + 2);
+        mNodes[node].left = left;
+
+        mBuildNode(order, left, first, middle - first);
+        mBuildNode(order, left + 1, middle, first + count - middle);
+    }
+
+    void BoundingVolumeHierarchy::mRefitNodes(void)
+    {
+        GXY_ZONE("BoundingVolumeHierarchy::mRefitNodes");
+
+        // Children are after their parent : refit from the end
+        for(u32 i = mNodes.size(); i-- > 0;)
+        {
+            BVHNode &node = mNodes[i];
+            vec3 minBox(FLT_MAX), maxBox(-FLT_MAX);
+
+            if(node.left == 0)
+            {
+                if(!mNodeDirty[i])
+                    continue;
+
+                for(u32 j = node.firstItem; j < node.firstItem + node.numItems; ++j)
+                {
+                    minBox = glm::min(minBox, mItemCenter[j] - mItemExtent[j]);
+                    maxBox = glm::max(maxBox, mItemCenter[j] + mItemExtent[j]);
+                }
+            }
+
+            else
+            {
+                if(!mNodeDirty[node.left] && !mNodeDirty[node.left + 1])
+                    continue;
+
+                for(u32 j = node.left; j < node.left + 2; ++j)
+                {
+                    minBox = glm::min(minBox, mNodes[j].center - mNodes[j].extent);
+                    maxBox = glm::max(maxBox, mNodes[j].center + mNodes[j].extent);
+                }
+
+                mNodeDirty[i] = 1;
+            }
+
+            mCost -= area(node.extent);
+            node.center = (minBox + maxBox) * 0.5f;
+            node.extent = (maxBox - minBox) * 0.5f;
+            mCost += area(node.extent);
+        }
+
+        fill(mNodeDirty.begin(), mNodeDirty.end(), 0);
+        mRefit = false;
+    }
+
+    void BoundingVolumeHierarchy::cull(Frustrum const &frustrum, vector<u32> &visible)
+    {
+        GXY_ZONE("BoundingVolumeHierarchy::cull");
+
+        if(mRebuild)
+            mBuild();
+
+        else if(mRefit)
+        {
+            mRefitNodes();
+
+            // Moved items make boxes overlap : build again once the tree is twice worse
+            if(mCost > 2.0f * mBuiltCost)
+                mBuild();
+        }
+
+        visible.clear();
+
+        if(mNodes.empty())
+            return;
+
+        // Median splits : the depth is lower than 32, so is the stack
+        u32 stackNode[64], stackPlanes[64];
+        u32 top = 0;
+        u32 testedNodes = 0;
+
+        stackNode[top] = 0;
+        stackPlanes[top++] = (1 << 6) - 1;
+
+        while(top > 0)
+        {
+            --top;
+
+            BVHNode const &node = mNodes[stackNode[top]];
+            u32 planes = stackPlanes[top];
+            bool outside = false;
+
+            ++testedNodes;
+
+            // Planes which the box is fully in front of are not tested by the children
+            for(u32 i = 0; i < 6 && !outside; ++i)
+            {
+                if((planes & (1 << i)) == 0)
+                    continue;
+
+                float distance = distancePlane(frustrum.mPlanes[i], node.center);
+                float radius = dot(abs(frustrum.mPlanes[i].plane.xyz()), node.extent);
+
+                if(distance + radius <= 0.0f)
+                    outside = true;
+
+                else if(distance - radius > 0.0f)
+                    planes &= ~(1 << i);
+            }
+
+            if(outside)
+                continue;
+
+            if(planes == 0)
+                visible.insert(visible.end(), mItems.begin() + node.firstItem, mItems.begin() + node.firstItem + node.numItems);
+
+            else if(node.left == 0)
+            {
+                // Same test as Frustrum::boxInside, only on the planes left
+                for(u32 j = node.firstItem; j < node.firstItem + node.numItems; ++j)
+                {
+                    bool inside = true;
+
+                    for(u32 i = 0; i < 6 && inside; ++i)
+                        if((planes & (1 << i)) != 0 &&
+                           distancePlane(frustrum.mPlanes[i], mItemCenter[j]) + dot(abs(frustrum.mPlanes[i].plane.xyz()), mItemExtent[j]) <= 0.0f)
+                            inside = false;
+
+                    if(inside)
+                        visible.push_back(mItems[j]);
+                }
+            }
+
+            else
+            {
+                stackNode[top] = node.left + 1;
+                stackPlanes[top++] = planes;
+                stackNode[top] = node.left;
+                stackPlanes[top++] = planes;
+            }
+        }
+
+        GXY_COUNTER("bvhTestedNodes", testedNodes);
+        GXY_COUNTER("bvhVisibleItems", visible.size());
+    }
+}
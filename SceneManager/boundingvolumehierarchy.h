@@ -0,0 +1,108 @@
+/*!
+ * \file boundingvolumehierarchy.h
+ * \brief Tree of bounding boxes to cull many objects at once
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#ifndef BOUNDINGVOLUMEHIERARCHY_H
+#define BOUNDINGVOLUMEHIERARCHY_H
+
+#include "../include/include.h"
+#include "../Camera/camera.h"
+#include "../Debug/cpuprofiler.h"
+
+namespace GXY
+{
+    /**
+     * @brief The BoundingVolumeHierarchy class
+     *
+     * Binary tree over the world boxes of items, whatever their place in the Nodes.
+     * Moving items only refits the boxes of their ancestors; the tree is built again
+     * when items are added, or when refits made it twice worse than after the build.
+     * Nodes are stored flat, children after their parent, and the items of one subtree are contiguous.
+     */
+    class BoundingVolumeHierarchy
+    {
+    public:
+        /**
+         * @brief BoundingVolumeHierarchy Constructor
+         */
+        BoundingVolumeHierarchy(void);
+
+        BoundingVolumeHierarchy(BoundingVolumeHierarchy const &hierarchy) = delete;
+        BoundingVolumeHierarchy &operator=(BoundingVolumeHierarchy const &hierarchy) = delete;
+
+        /**
+         * @brief Add one item, or move it if it is already in the tree
+         * @param[in] item : identifier of the item, for example its index in the TransformHierarchy
+         * @param[in] bounds : box of the item in the world
+         */
+        void setBounds(u32 item, AABB3D const &bounds);
+
+        /**
+         * @brief Get the items inside a frustrum
+         *
+         * A subtree fully in front of one plane does not test this plane any more,
+         * so the result is the same as Frustrum::boxInside on each item
+         * @param[in] frustrum : The frustrum
+         * @param[out] visible : items inside, in the order of the tree
+         */
+        void cull(Frustrum const &frustrum, std::vector<u32> &visible);
+
+        /**
+         * @brief Get the number of items
+         * @return number of items
+         */
+        inline u32 size(void) const {return mItems.size();}
+
+    private:
+        static u32 const NO_ITEM = 0xFFFFFFFF; //!< Identifier without item
+        static u32 const MAX_LEAF_ITEMS = 4; //!< Items in one leaf at most
+
+        /**
+         * @brief One node of the tree
+         */
+        struct BVHNode
+        {
+            glm::vec3 center; //!< Center of the box
+            u32 firstItem; //!< First item of the subtree in mItems
+            glm::vec3 extent; //!< Half size of the box
+            u32 numItems; //!< Number of items of the subtree
+            u32 left; //!< Index of the left child, the right one is after it, 0 for a leaf
+        };
+
+        std::vector<BVHNode> mNodes; //!< Root at 0, children after their parent
+        std::vector<u8> mNodeDirty; //!< Box of the node has to be computed again
+        std::vector<u32> mItems; //!< Items, sorted by leaf
+        std::vector<glm::vec3> mItemCenter; //!< Center of the box of each item, in mItems order
+        std::vector<glm::vec3> mItemExtent; //!< Half size of the box of each item, in mItems order
+        std::vector<u32> mItemLeaf; //!< Leaf of each item, in mItems order
+        std::vector<u32> mPosition; //!< Position in mItems of each identifier, NO_ITEM if absent
+        float mBuiltCost; //!< Sum of areas of the boxes after the build
+        float mCost; //!< Sum of areas of the boxes now
+        bool mRebuild; //!< Items were added since the build
+        bool mRefit; //!< Items moved since the refit
+
+        /**
+         * @brief Build the tree again, splitting nodes at the median of their largest axis
+         */
+        void mBuild(void);
+
+        /**
+         * @brief Build one node and its children
+         * @param[in,out] order : positions of items, sorted by leaf at the end
+         * @param[in] node : index of the node
+         * @param[in] first : first item of the node
+         * @param[in] count : number of items of the node
+         */
+        void mBuildNode(std::vector<u32> &order, u32 node, u32 first, u32 count);
+
+        /**
+         * @brief Compute again the boxes of the nodes with moved items, from the leaves to the root
+         */
+        void mRefitNodes(void);
+    };
+}
+
+#endif // BOUNDINGVOLUMEHIERARCHY_H
@@ -0,0 +1,127 @@
+/*!
+ * \file hlodproxy.cpp
+ * \brief One simplified Model drawn instead of a subtree of Nodes far away
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#include "hlodproxy.h"
+#include "../System/device.h"
+#include "scenemanager.h"
+
+using namespace glm;
+using namespace std;
+
+namespace GXY
+{
+    HlodProxy::HlodProxy(shared_ptr<Node> const &node, float distance) :
+        mNode(node), mDistance(distance), mValid(false)
+    {
+        mIndex = global->sceneManager->addHlodProxy(this);
+    }
+
+    void HlodProxy::setDistance(float distance)
+    {
+        mDistance = distance;
+        global->sceneManager->sceneChanged();
+    }
+
+    void HlodProxy::mCollectSources(Node const &node, mat4 const &transform, vector<ProxySource> &sources) const
+    {
+        TransformHierarchy &transforms = global->sceneManager->transforms();
+
+        // Products of local matrices : they do not change when mNode moves
+        for(auto const &model : node.mModels)
+        {
+            if(!model->model()->isLoaded() || model->model()->ressource->path().empty())
+                continue;
+
+            ProxySource source;
+
+            source.path = model->model()->ressource->path();
+            source.transform = transform * transforms.local(model->index());
+            sources.push_back(source);
+        }
+
+        for(auto const &child : node.mChildren)
+            mCollectSources(*child, transform * transforms.local(child->index()), sources);
+    }
+
+    void HlodProxy::update(vec3 const &camera, bool check)
+    {
+        // A bake is over : a failed one is not started again before the subtree changes
+        if(mBaking != nullptr && mBaking->isFinished())
+        {
+            if(mBaking->isLoaded())
+            {
+                if(mModelNode == nullptr)
+                    mModelNode = make_shared<ModelNode>(mBaking, mNode, mIndex);
+
+                else
+                    mModelNode->setModel(mBaking);
+
+                mSources = move(mBakingSources);
+            }
+
+            mBakingSources.clear();
+            mBaking = nullptr;
+            check = true;
+        }
+
+        if(check)
+        {
+            GXY_ZONE("HlodProxy::check");
+
+            mSubtree.clear();
+            mCollectSources(*mNode, mat4(1.0f), mSubtree);
+
+            bool valid = !mSources.empty() && mSubtree == mSources;
+
+            // The switch of the culling pass is written again, with the swaps of the other proxies of the frame
+            if(valid != mValid)
+            {
+                mValid = valid;
+                global->sceneManager->sceneChanged();
+            }
+        }
+
+        if(mValid || mBaking != nullptr || mSubtree.empty() || mSubtree == mTriedSources)
+            return;
+
+        AABB3D bounds = mNode->AABB();
+
+        if(distance(bounds.center.xyz(), camera) < mDistance)
+            return;
+
+        mTriedSources = mSubtree;
+        mBakingSources = mSubtree;
+        mBaking = global->ressourceManager->bakeModelAsync(mBakingSources);
+    }
+
+    void HlodProxy::pushInPipeline(void)
+    {
+        if(mValid)
+            mModelNode->pushInPipeline();
+    }
+
+    HlodSwitch HlodProxy::hlodSwitch(void) const
+    {
+        HlodSwitch hlod;
+        u32 parent = mNode->mParent != nullptr ? mNode->mParent->hlodSwitch() : NO_HLOD;
+
+        // Without proxy, the subtree is never far
+        if(!mValid)
+        {
+            hlod.centerDistance = vec4(0.0f, 0.0f, 0.0f, mDistance);
+            hlod.transformParent = uvec4(NO_HLOD, parent, 0, 0);
+        }
+
+        else
+        {
+            hlod.centerDistance = vec4(mModelNode->model()->ressource->AABB().center.xyz(), mDistance);
+            hlod.transformParent = uvec4(global->sceneManager->transforms().slot(mModelNode->index()), parent, 0, 0);
+        }
+
+        return hlod;
+    }
+}
@@ -0,0 +1,93 @@
+/*!
+ * \file hlodproxy.h
+ * \brief One simplified Model drawn instead of a subtree of Nodes far away
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#ifndef HLODPROXY_H
+#define HLODPROXY_H
+
+#include "../include/include.h"
+#include "modelnode.h"
+
+namespace GXY
+{
+    /**
+     * @brief The HlodProxy class
+     *
+     * All Models of the subtree of one Node are merged and simplified in one proxy, in the space of the Node :
+     * the Node can move without baking it again. Beyond a distance, the culling pass draws the proxy
+     * instead of the instances of the subtree, see HlodSwitch.
+     *
+     * The proxy is baked on a worker, only when the camera is far and the Models of the subtree
+     * or their matrices relative to the Node changed. Meanwhile, the subtree is drawn.
+     */
+    class HlodProxy
+    {
+    public:
+        /**
+         * @brief HlodProxy Constructor, use addHlodProxy
+         * @param[in] node : Node whose subtree is replaced
+         * @param[in] distance : Distance from which the proxy is drawn
+         */
+        HlodProxy(std::shared_ptr<Node> const &node, float distance);
+
+        HlodProxy(HlodProxy const &proxy) = delete;
+        HlodProxy &operator=(HlodProxy const &proxy) = delete;
+
+        /**
+         * @brief Change the distance from which the proxy is drawn
+         * @param[in] distance : Distance to the center of the subtree
+         */
+        void setDistance(float distance);
+
+        /**
+         * @brief Get the index of its HlodSwitch
+         * @return index
+         */
+        inline u32 index(void) const {return mIndex;}
+
+        /**
+         * @brief Take the proxy baked, check if the subtree changed, and bake it again if the camera is far
+         *
+         * Called once by frame, after SceneManager::commitTransforms
+         * @param[in] camera : Position of the camera
+         * @param[in] check : Matrices changed or Models were loaded, the subtree is compared to the proxy
+         */
+        void update(glm::vec3 const &camera, bool check);
+
+        /**
+         * @brief Add the proxy in the scene being built, if it matches the subtree
+         */
+        void pushInPipeline(void);
+
+        /**
+         * @brief Get what the culling pass needs to choose between the subtree and the proxy
+         * @return the HlodSwitch
+         */
+        HlodSwitch hlodSwitch(void) const;
+
+    private:
+        /**
+         * @brief Collect the loaded Models of one Node and its children, with their matrices relative to mNode
+         * @param[in] node : The Node
+         * @param[in] transform : Matrix of the Node relative to mNode
+         * @param[out] sources : Models found, pushed at the end
+         */
+        void mCollectSources(Node const &node, glm::mat4 const &transform, std::vector<ProxySource> &sources) const;
+
+        std::shared_ptr<Node> mNode; //!< Node whose subtree is replaced
+        std::shared_ptr<ModelNode> mModelNode; //!< Draws the last proxy baked, nullptr before
+        std::shared_ptr<AsyncRessource<Model>> mBaking; //!< Proxy being baked, nullptr if none
+        std::vector<ProxySource> mSubtree; //!< Models of the subtree at the last check
+        std::vector<ProxySource> mSources; //!< Models of the last proxy baked
+        std::vector<ProxySource> mBakingSources; //!< Models of the proxy being baked
+        std::vector<ProxySource> mTriedSources; //!< Models of the last bake started, not started again if it failed
+        float mDistance; //!< Distance from which the proxy is drawn
+        u32 mIndex; //!< Index of its HlodSwitch
+        bool mValid; //!< The last proxy baked matches the subtree
+    };
+}
+
+#endif // HLODPROXY_H
@@ -1,6 +1,7 @@
 #include "modelnode.h"
 
 #include "../System/device.h"
+#include "scenemanager.h"
 
 using namespace glm;
 using namespace std;
@@ -8,45 +9,69 @@ using namespace std;
 namespace GXY
 {
     ModelNode::ModelNode(std::string const &path, std::shared_ptr<Node> const &parent) :
-        mParent(parent), mModel(global->ressourceManager->getModel(path)), mMatrix(mat4(1.0f))
+        ModelNode(global->ressourceManager->getModelAsync(path), parent, NO_HLOD)
     {
-        mAABB = computeAABB3D(mModel->AABB(), mParent->mGlobalMatrix);
+
+    }
+
+    ModelNode::ModelNode(std::shared_ptr<AsyncRessource<Model>> const &model, std::shared_ptr<Node> const &parent, u32 hlod) :
+        mParent(parent), mModel(model), mHasBounds(false), mProxyOf(hlod)
+    {
+        TransformHierarchy &transforms = global->sceneManager->transforms();
+
+        mIndex = transforms.add(mParent->index());
+        transforms.setSlot(mIndex, global->sceneManager->addModelNode());
+    }
+
+    void ModelNode::setModel(std::shared_ptr<AsyncRessource<Model>> const &model)
+    {
+        mModel = model;
+        mHasBounds = false;
+        global->sceneManager->sceneChanged();
+    }
+
+    AABB3D ModelNode::AABB(void) const
+    {
+        return global->sceneManager->transforms().bounds(mIndex);
     }
 
     void ModelNode::identity()
     {
-        mMatrix = mat4(1.0f);
-        mAABB = computeAABB3D(mModel->AABB(), mParent->mGlobalMatrix);
-        mParent->mActualizeBoundingBoxes();
+        global->sceneManager->transforms().setLocal(mIndex, mat4(1.0f));
     }
 
     void ModelNode::rotate(float angle, const vec3 &axe)
     {
-        mMatrix = glm::rotate(mMatrix, angle, axe);
-
-        mAABB = computeAABB3D(mModel->AABB(), mParent->mGlobalMatrix * mMatrix);
-        mParent->mActualizeBoundingBoxes();
+        global->sceneManager->transforms().multiplyLocal(mIndex, glm::rotate(mat4(1.0f), angle, axe));
     }
 
     void ModelNode::translate(const vec3 &vec)
     {
-        mMatrix = glm::translate(mMatrix, vec);
-
-        mAABB = computeAABB3D(mModel->AABB(), mParent->mGlobalMatrix * mMatrix);
-        mParent->mActualizeBoundingBoxes();
+        global->sceneManager->transforms().multiplyLocal(mIndex, glm::translate(mat4(1.0f), vec));
     }
 
     void ModelNode::scale(float factor)
     {
-        mMatrix = glm::scale(mMatrix, vec3(factor));
-
-        mAABB = computeAABB3D(mModel->AABB(), mParent->mGlobalMatrix * mMatrix);
-        mParent->mActualizeBoundingBoxes();
+        global->sceneManager->transforms().multiplyLocal(mIndex, glm::scale(mat4(1.0f), vec3(factor)));
     }
 
-    void ModelNode::pushInPipeline(Frustrum const &frustrum)
+    void ModelNode::pushInPipeline(void)
     {
-        if(frustrum.boxInside(mAABB))
-            mModel->pushInPipeline(mParent->mGlobalMatrix * mMatrix);
+        // The scene is built again when the Model is loaded
+        if(!mModel->isLoaded())
+            return;
+
+        TransformHierarchy &transforms = global->sceneManager->transforms();
+
+        if(!mHasBounds)
+        {
+            transforms.setBounds(mIndex, mModel->ressource->AABB());
+            mHasBounds = true;
+        }
+
+        // Instances of a subtree with a proxy are drawn near it, the proxy far
+        u32 hlod = mProxyOf != NO_HLOD ? mProxyOf | HLOD_PROXY : mParent->hlodSwitch();
+
+        mModel->ressource->pushInPipeline(transforms.slot(mIndex), hlod);
     }
 }
@@ -9,7 +9,7 @@
 #define MODELNODE_H
 
 #include "../include/include.h"
-#include "../System/model.h"
+#include "../System/ressourcemanager.h"
 #include "node.h"
 
 namespace GXY
@@ -18,7 +18,8 @@ namespace GXY
      * @brief The ModelNode class
      *
      * Describe A Model in a node.
-     * This Model is associate with one matrix
+     * This Model is associate with one entry of the TransformHierarchy.
+     * The Model is loaded in background : the ModelNode is not rendered before
      */
     class ModelNode
     {
@@ -30,6 +31,26 @@ namespace GXY
          */
         ModelNode(std::string const &path, std::shared_ptr<Node> const &parent);
 
+        /**
+         * @brief ModelNode Constructor for the proxy of one subtree, the Node does not own it
+         * @param[in] model : Proxy baked
+         * @param[in] parent : Node whose subtree is replaced
+         * @param[in] hlod : HlodSwitch of the Node
+         */
+        ModelNode(std::shared_ptr<AsyncRessource<Model>> const &model, std::shared_ptr<Node> const &parent, u32 hlod);
+
+        /**
+         * @brief Draw another Model, a proxy baked again
+         * @param[in] model : The Model, loaded
+         */
+        void setModel(std::shared_ptr<AsyncRessource<Model>> const &model);
+
+        /**
+         * @brief Get the Model
+         * @return the Model, maybe not loaded yet
+         */
+        inline std::shared_ptr<AsyncRessource<Model>> const &model(void) const {return mModel;}
+
         /**
          * @brief Perform a rotation of a Model inside a Node
          * @param[in] angle : Angle of the rotation
@@ -55,27 +76,28 @@ namespace GXY
         void identity(void);
 
         /**
-         * @brief updateAABB : If Node undergoes a transformation, this function should be call
-         * @param[in] globalMatrix
+         * @brief AABB : Get the Bounding Box of this object in the Real World
+         * @return AABB3D, up to date after SceneManager::commitTransforms
          */
-        inline void updateAABB(void) {mAABB = computeAABB3D(mModel->AABB(), mParent->mGlobalMatrix * mMatrix);}
+        AABB3D AABB(void) const;
 
         /**
-         * @brief AABB : Get the Bounding Box of this object in the Real World
-         * @return AABB3D
+         * @brief Get the index of this ModelNode in the TransformHierarchy
+         * @return index
          */
-        inline AABB3D const &AABB(void) const {return mAABB;}
+        inline u32 index(void) const {return mIndex;}
 
         /**
-         * @brief Push in a command Buffer news value to be render
+         * @brief Add this ModelNode as one instance of its Model in the scene being built, if it is loaded
          */
-        void pushInPipeline(Frustrum const &frustrum);
+        void pushInPipeline(void);
 
     private:
         std::shared_ptr<Node> mParent; //!< Node Parent
-        std::shared_ptr<Model> mModel; //!< Pointer on a Model
-        glm::mat4 mMatrix; //!< Matrix relative to a Node
-        AABB3D mAABB; //!< Bounding Box in a Real World
+        std::shared_ptr<AsyncRessource<Model>> mModel; //!< Pointer on a Model, maybe not loaded yet
+        u32 mIndex; //!< Index in the TransformHierarchy, its local matrix is relative to the Node
+        bool mHasBounds; //!< The box of the Model is given to the TransformHierarchy
+        u32 mProxyOf; //!< HlodSwitch of the subtree it replaces, NO_HLOD if it is not a proxy
     };
 }
 
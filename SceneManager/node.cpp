@@ -9,131 +9,63 @@
 #include "../System/device.h"
 #include "modelnode.h"
 #include "pointlightnode.h"
+#include "hlodproxy.h"
+#include "scenemanager.h"
 
 using namespace glm;
 using namespace std;
 
 namespace GXY
 {
-    Node::Node(glm::mat4 const &parent) : mParent(nullptr), mGlobalMatrix(parent), mGlobalScaleFactor(1.0f)
-    {
-        mAABB.coord[0] = vec4(FLT_MAX, FLT_MAX, FLT_MAX, 1.0);
-        mAABB.coord[1] = vec4(FLT_MAX, FLT_MAX, FLT_MIN, 1.0);
-        mAABB.coord[2] = vec4(FLT_MAX, FLT_MIN, FLT_MAX, 1.0);
-        mAABB.coord[3] = vec4(FLT_MAX, FLT_MIN, FLT_MIN, 1.0);
-        mAABB.coord[4] = vec4(FLT_MIN, FLT_MAX, FLT_MAX, 1.0);
-        mAABB.coord[5] = vec4(FLT_MIN, FLT_MAX, FLT_MIN, 1.0);
-        mAABB.coord[6] = vec4(FLT_MIN, FLT_MIN, FLT_MAX, 1.0);
-        mAABB.coord[7] = vec4(FLT_MIN, FLT_MIN, FLT_MIN, 1.0);
-    }
-
-    void Node::mActualizeBoundingBoxes()
-    {
-        vec3 newMin = vec3(FLT_MAX, FLT_MAX, FLT_MAX);
-        vec3 newMax = vec3(FLT_MIN, FLT_MIN, FLT_MIN);
-
-        for(auto model : mModels)
-        {
-            newMin = glm::min(newMin, model->AABB().coord[0].xyz());
-            newMax = glm::max(newMax, model->AABB().coord[7].xyz());
-        }
-
-        for(auto child : mChildren)
-        {
-            newMin = glm::min(newMin, child->mAABB.coord[0].xyz());
-            newMax = glm::max(newMax, child->mAABB.coord[7].xyz());
-        }
-
-        mAABB.coord[0] = vec4(newMin.x, newMin.y, newMin.z, 1.0);
-        mAABB.coord[1] = vec4(newMin.x, newMin.y, newMax.z, 1.0);
-        mAABB.coord[2] = vec4(newMin.x, newMax.y, newMin.z, 1.0);
-        mAABB.coord[3] = vec4(newMin.x, newMax.y, newMax.z, 1.0);
-        mAABB.coord[4] = vec4(newMax.x, newMin.y, newMin.z, 1.0);
-        mAABB.coord[5] = vec4(newMax.x, newMin.y, newMax.z, 1.0);
-        mAABB.coord[6] = vec4(newMax.x, newMax.y, newMin.z, 1.0);
-        mAABB.coord[7] = vec4(newMax.x, newMax.y, newMax.z, 1.0);
-
-        if(mParent != nullptr)
-            mParent->mActualizeBoundingBoxes();
-    }
+    static u32 const TRAVERSAL_CHUNK = 256; //!< ModelNodes or PointLightNodes of one Node in one task at most
 
-    void Node::mBuildAABB()
+    Node::Node(u32 parent) : mParent(nullptr)
     {
-        for(auto child : mChildren)
-            child->mBuildAABB();
-
-        // Is a Leaf
-        if(mChildren.empty())
-            mActualizeBoundingBoxes();
+        mIndex = global->sceneManager->transforms().add(parent);
     }
 
-    void Node::mApplyMatrixToChildrenAndModels(const mat4 &matrix)
+    AABB3D Node::AABB(void) const
     {
-        mGlobalMatrix *= matrix;
-
-        for(auto model : mModels)
-            model->updateAABB();
-
-        for(auto pointLight : mPointLights)
-            pointLight->updateMatrix();
-
-        for(auto child : mChildren)
-            child->mApplyMatrixToChildrenAndModels(matrix);
+        return global->sceneManager->transforms().bounds(mIndex);
     }
 
-    void Node::mApplyScaleFactorToChildren(float factor)
+    u32 Node::hlodSwitch(void) const
     {
-        mGlobalScaleFactor *= factor;
+        for(Node const *node = this; node != nullptr; node = node->mParent.get())
+            if(node->mHlodProxy != nullptr)
+                return node->mHlodProxy->index();
 
-        for(auto child : mChildren)
-            child->mApplyScaleFactorToChildren(factor);
+        return NO_HLOD;
     }
 
     void Node::identity(void)
     {
-        mApplyScaleFactorToChildren(mParent->mGlobalScaleFactor / mGlobalScaleFactor);
-
-        mat4 matrix = inverse(mGlobalMatrix) * (mParent != nullptr ? mParent->mGlobalMatrix : mat4(1.0f));
-
-        mApplyMatrixToChildrenAndModels(matrix);
-
-        mBuildAABB();
+        global->sceneManager->transforms().setLocal(mIndex, mat4(1.0f));
+        global->sceneManager->transforms().setLocalScaleFactor(mIndex, 1.0f);
     }
 
     void Node::rotate(float angle, const vec3 &axe)
     {
-        mat4 matrix = glm::rotate(mat4(1.0f), angle, axe);
-
-        mApplyMatrixToChildrenAndModels(matrix);
-
-        mBuildAABB();
+        global->sceneManager->transforms().multiplyLocal(mIndex, glm::rotate(mat4(1.0f), angle, axe));
     }
 
     void Node::translate(const vec3 &vec)
     {
-        mat4 matrix = glm::translate(mat4(1.0f), vec);
-
-        mApplyMatrixToChildrenAndModels(matrix);
-
-        mBuildAABB();
+        global->sceneManager->transforms().multiplyLocal(mIndex, glm::translate(mat4(1.0f), vec));
     }
 
     void Node::scale(float factor)
     {
-        mat4 matrix = glm::scale(mat4(1.0f), vec3(factor));
+        TransformHierarchy &transforms = global->sceneManager->transforms();
 
-        mGlobalScaleFactor *= factor;
-        mApplyScaleFactorToChildren(factor);
-        mApplyMatrixToChildrenAndModels(matrix);
-
-        mBuildAABB();
+        transforms.multiplyLocal(mIndex, glm::scale(mat4(1.0f), vec3(factor)));
+        transforms.setLocalScaleFactor(mIndex, transforms.localScaleFactor(mIndex) * factor);
     }
 
     shared_ptr<Node> addNode(shared_ptr<Node> const &parent)
     {
-        shared_ptr<Node> newNode = make_shared<Node>(parent->mGlobalMatrix);
+        shared_ptr<Node> newNode = make_shared<Node>(parent->mIndex);
 
-        newNode->mGlobalScaleFactor = parent->mGlobalScaleFactor;
         newNode->mParent = parent;
 
         parent->mChildren.push_back(newNode);
@@ -147,8 +79,6 @@ namespace GXY
 
         parent->mModels.push_back(toPush);
 
-        parent->mActualizeBoundingBoxes();
-
         return toPush;
     }
 
@@ -161,24 +91,67 @@ namespace GXY
         return toPush;
     }
 
-    void Node::pushModelsInPipeline(Frustrum const &frustrum)
+    shared_ptr<HlodProxy> addHlodProxy(shared_ptr<Node> const &node, float distance)
+    {
+        if(node->mHlodProxy != nullptr)
+            node->mHlodProxy->setDistance(distance);
+
+        else
+            node->mHlodProxy = make_shared<HlodProxy>(node, distance);
+
+        return node->mHlodProxy;
+    }
+
+    void Node::splitTraversal(vector<TraversalTask> &tasks, u32 depth)
     {
-        if(frustrum.boxInside(mAABB) == false)
+        u32 numItems = std::max(mModels.size(), mPointLights.size());
+
+        if(depth == 0)
+        {
+            tasks.push_back({this, 0, numItems, true});
             return;
+        }
 
-        for(auto model : mModels)
-            model->pushInPipeline(frustrum);
+        for(u32 first = 0; first < numItems; first += TRAVERSAL_CHUNK)
+            tasks.push_back({this, first, std::min(first + TRAVERSAL_CHUNK, numItems), false});
 
         for(auto child : mChildren)
-            child->pushModelsInPipeline(frustrum);
+            child->splitTraversal(tasks, depth - 1);
     }
 
-    void Node::pushPointLightsInPipeline(Frustrum const &frustrum)
+    void Node::collectModels(u32 first, u32 last, bool withChildren, TraversalList &list)
     {
-        for(auto pointLight : mPointLights)
-            pointLight->pushInPipeline(frustrum);
+        last = std::min<u32>(last, mModels.size());
 
-        for(auto child : mChildren)
-            child->pushPointLightsInPipeline(frustrum);
+        for(u32 i = first; i < last; ++i)
+            list.models.push_back(mModels[i].get());
+
+        if(withChildren)
+            for(auto const &child : mChildren)
+                child->collectModels(0, child->mModels.size(), true, list);
+    }
+
+    void Node::collectPointLights(u32 first, u32 last, bool withChildren, Frustrum const &frustrum, TraversalList &list)
+    {
+        last = std::min<u32>(last, mPointLights.size());
+
+        for(u32 i = first; i < last; ++i)
+        {
+            PointLight light;
+            mat4 toWorldSpace;
+
+            if(mPointLights[i]->prepare(frustrum, light, toWorldSpace))
+            {
+                list.pointLights.push_back(light);
+                list.pointLightMatrices.push_back(toWorldSpace);
+
+                if(mPointLights[i]->hasPendingRendering())
+                    list.pendingPointLights.push_back(mPointLights[i].get());
+            }
+        }
+
+        if(withChildren)
+            for(auto const &child : mChildren)
+                child->collectPointLights(0, child->mPointLights.size(), true, frustrum, list);
     }
 }
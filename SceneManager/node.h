@@ -15,13 +15,49 @@
 
 namespace GXY
 {
+    class Node;
     class ModelNode;
     class PointLightNode;
+    class HlodProxy;
+
+    /**
+     * @brief One part of the traversal of the tree, run by one thread
+     */
+    struct TraversalTask
+    {
+        Node *node; //!< Node traversed
+        u32 first; //!< First ModelNode and PointLightNode of the Node
+        u32 last; //!< After the last ModelNode and PointLightNode of the Node
+        bool withChildren; //!< Children of the Node are traversed as well
+    };
+
+    /**
+     * @brief What one thread found during its part of the traversal, in the order of the traversal
+     */
+    struct TraversalList
+    {
+        std::vector<ModelNode*> models; //!< ModelNodes
+        std::vector<PointLight> pointLights; //!< PointLights inside the frustrum
+        std::vector<glm::mat4> pointLightMatrices; //!< World Matrices of these PointLights
+        std::vector<PointLightNode*> pendingPointLights; //!< PointLights with shadow maps or virtual lights to render on the GL thread
+
+        /**
+         * @brief Empty all lists, without releasing memory
+         */
+        inline void clear(void)
+        {
+            models.clear();
+            pointLights.clear();
+            pointLightMatrices.clear();
+            pendingPointLights.clear();
+        }
+    };
 
     /**
      * @brief The Node class
      *
-     * Provide one interface to Manage Dependance
+     * Provide one interface to Manage Dependance.
+     * Matrices and bounding boxes are in the TransformHierarchy of the SceneManager
      */
     class Node
     {
@@ -42,15 +78,24 @@ namespace GXY
 
         friend std::shared_ptr<PointLightNode> addPointLight(const std::shared_ptr<Node> &parent);
 
+        /**
+         * @brief Draw one proxy instead of the subtree of the Node, when it is far
+         * @param[in] node : The Node
+         * @param[in] distance : Distance from which the proxy is drawn
+         * @return the proxy, the same if the Node already has one
+         */
+        friend std::shared_ptr<HlodProxy> addHlodProxy(std::shared_ptr<Node> const &node, float distance);
+
         friend ModelNode;
         friend PointLightNode;
+        friend HlodProxy;
 
     public:
         /**
          * @brief NodeConstructor
-         * @param[in] parent : a Pointer on a Node Parent
+         * @param[in] parent : index of the Node Parent in the TransformHierarchy, NO_PARENT for the root
          */
-        Node(glm::mat4 const &parent);
+        Node(u32 parent);
 
         /**
          * @brief Perform a rotation of a Node : All models and children are affected
@@ -77,50 +122,67 @@ namespace GXY
         void identity(void);
 
         /**
-         * @brief Push in a command Buffer news value to be render of all Models in a Node
-         * @param[in] frustrum
+         * @brief Split the traversal of this Node and its children in tasks, in the order of the traversal
+         *
+         * ModelNodes and PointLightNodes of split Nodes are cut in chunks, so a flat scene is shared as well
+         * @param[out] tasks : Tasks, pushed at the end
+         * @param[in] depth : Levels still split, deeper Nodes are one task with all their children
          */
-        void pushModelsInPipeline(Frustrum const &frustrum);
-
-        void pushPointLightsInPipeline(Frustrum const &frustrum);
+        void splitTraversal(std::vector<TraversalTask> &tasks, u32 depth);
 
-    private:
-        std::shared_ptr<Node> mParent; //!< Parent Node
-        glm::mat4 mGlobalMatrix; //!< GlobalMatrix : Depend of Parent Node
-        AABB3D mAABB; //!< Bounding Box of this Node : Depend of Child and Model Bounding Boxe
-
-        float mGlobalScaleFactor; //!< Scale Factor
-
-        std::vector<std::shared_ptr<Node>> mChildren; //!< Children Node
-        std::vector<std::shared_ptr<ModelNode>> mModels; //!< Model owned by Node
-        std::vector<std::shared_ptr<PointLightNode>> mPointLights; //!< PointLight owned by Node
+        /**
+         * @brief Collect the ModelNodes of a part of this Node, for the scene being built
+         *
+         * Only called when ModelNodes are added, the GPU culls each instance
+         * @param[in] first : First ModelNode of this Node
+         * @param[in] last : After the last ModelNode of this Node
+         * @param[in] withChildren : ModelNodes of children are collected as well
+         * @param[out] list : List of the thread
+         */
+        void collectModels(u32 first, u32 last, bool withChildren, TraversalList &list);
 
         /**
-         * @brief Apply scale Factor to all tree
-         * @param[in] factor
+         * @brief Collect the PointLights inside the frustrum of a part of this Node
+         * @param[in] first : First PointLightNode of this Node
+         * @param[in] last : After the last PointLightNode of this Node
+         * @param[in] withChildren : PointLightNodes of children are collected as well
+         * @param[in] frustrum : Frustrum's Camera
+         * @param[out] list : List of the thread
          */
-        void mApplyScaleFactorToChildren(float factor);
+        void collectPointLights(u32 first, u32 last, bool withChildren, Frustrum const &frustrum, TraversalList &list);
 
         /**
-         * @brief Apply matrix to all tree
-         * @param[in] matrix
+         * @brief Get the index of this Node in the TransformHierarchy
+         * @return index
          */
-        void mApplyMatrixToChildrenAndModels(glm::mat4 const &matrix);
+        inline u32 index(void) const {return mIndex;}
 
         /**
-         * @brief Perform changement on the AABB on go up in the tree.
+         * @brief AABB : Get the Bounding Box of all Models of this Node and its children
+         * @return AABB3D, up to date after SceneManager::commitTransforms
          */
-        void mActualizeBoundingBoxes();
+        AABB3D AABB(void) const;
 
         /**
-         * @brief Compute all bounding box for the AABB.
+         * @brief Get the HlodSwitch of the nearest Node with a proxy, this one or above
+         * @return index of the HlodSwitch, NO_HLOD if none
          */
-        void mBuildAABB();
+        u32 hlodSwitch(void) const;
+
+    private:
+        std::shared_ptr<Node> mParent; //!< Parent Node
+        u32 mIndex; //!< Index in the TransformHierarchy
+
+        std::vector<std::shared_ptr<Node>> mChildren; //!< Children Node
+        std::vector<std::shared_ptr<ModelNode>> mModels; //!< Model owned by Node
+        std::vector<std::shared_ptr<PointLightNode>> mPointLights; //!< PointLight owned by Node
+        std::shared_ptr<HlodProxy> mHlodProxy; //!< Proxy of the subtree, nullptr if none
     };
 
     std::shared_ptr<Node> addNode(std::shared_ptr<Node> const &parent);
     std::shared_ptr<ModelNode> addModel(std::shared_ptr<Node> const &parent, std::string const &path);
     std::shared_ptr<PointLightNode> addPointLight(std::shared_ptr<Node> const &parent);
+    std::shared_ptr<HlodProxy> addHlodProxy(std::shared_ptr<Node> const &node, float distance);
 }
 
 
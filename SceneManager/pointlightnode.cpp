@@ -11,67 +11,53 @@ namespace GXY
     PointLightNode::PointLightNode(shared_ptr<Node> const &parent) :
         mParent(parent), mShadows(false, false, -1), mVirtualLight(false, false)
     {
-
+        mIndex = global->sceneManager->transforms().add(mParent->index());
     }
 
     void PointLightNode::setPosition(const vec3 &position)
     {
         mPosition = position;
-        mMatrix = scale(translate(mParent->mGlobalMatrix, mPosition), vec3(mRadius));
+        mUpdateLocal();
     }
 
     void PointLightNode::setRadius(float radius)
     {
         mRadius = radius;
-        mMatrix = scale(translate(mParent->mGlobalMatrix, mPosition), vec3(mRadius));
+        mUpdateLocal();
     }
 
-    void PointLightNode::updateMatrix(void)
+    void PointLightNode::mUpdateLocal(void)
     {
-        mMatrix = scale(translate(mParent->mGlobalMatrix, mPosition), vec3(mRadius));
+        global->sceneManager->transforms().setLocal(mIndex, scale(translate(mat4(1.0f), mPosition), vec3(mRadius)));
     }
 
-    void PointLightNode::pushInPipeline(Frustrum const &frustrum)
+    bool PointLightNode::prepare(Frustrum const &frustrum, PointLight &light, mat4 &toWorldSpace) const
     {
-        DrawArrayCommand command;
-        PointLight light;
         Sphere sphere;
-        bool reallocate = false;
 
-        command.baseInstance = 0;
-        command.instanceCount = 1;
-        command.count = 4;
-        command.first = global->Lighting.commandPointLights->numElements() * 4;
+        TransformHierarchy const &transforms = global->sceneManager->transforms();
+        float radius = mRadius * transforms.worldScaleFactor(mIndex);
+
+        toWorldSpace = transforms.world(mIndex);
 
         light.color = vec4(mColor * mIntensity, 0.0);
-        light.positionRadius = vec4(mMatrix[3].xyz(), mRadius * mParent->mGlobalScaleFactor);
+        light.positionRadius = vec4(toWorldSpace[3].xyz(), radius);
         light.shadowInformation.x = get<2>(mShadows);
 
         sphere.position = light.positionRadius.xyz();
         sphere.radius = light.positionRadius.w;
 
         if(!frustrum.sphereInside(sphere))
-            return;
-
-        global->Lighting.commandPointLights->push(command, reallocate);
-        global->Lighting.pointLight->push(light, reallocate);
-        global->Lighting.toWorldSpace->push(mMatrix, reallocate);
-
-        if((global->Lighting.commandPointLights->numElements() * 4 > global->Lighting.quadsPointLights->numMaxElements()))
         {
-            global->Lighting.quadsPointLights->allocate(4 * global->Lighting.commandPointLights->numElements());
-
-            global->Lighting.vaoPointLight->create();
-            global->Lighting.vaoPointLight->configure(*global->Lighting.quadsPointLights);
+            GXY_COUNTER("culledLights", 1);
+            return false;
         }
 
-        if(reallocate)
-        {
-            global->Lighting.quadsPointLights->bindBase(SHADER_STORAGE, 5);
-            global->Lighting.pointLight->bindBase(SHADER_STORAGE, 6);
-            global->Lighting.toWorldSpace->bindBase(SHADER_STORAGE, 7);
-        }
+        return true;
+    }
 
+    void PointLightNode::renderPending(void)
+    {
         if(get<0>(mShadows) == true)
             if(get<1>(mShadows) == false)
                 mRenderShadowMaps();
@@ -96,18 +82,26 @@ namespace GXY
 
     void PointLightNode::mRenderShadowMaps(void)
     {
+        GXY_ZONE("PointLightNode::mRenderShadowMaps");
         get<1>(mShadows) = true;
 
+        TransformHierarchy const &transforms = global->sceneManager->transforms();
+
         global->device->setClearColor(1.0, 1.0, 1.0);
-            renderIntoCubeMapArray(global->Lighting.pointLightShadowMaps, get<2>(mShadows), mMatrix[3].xyz(), mRadius * mParent->mGlobalScaleFactor, global->Shaders.depthPointLight);
+            renderIntoCubeMapArray(global->Lighting.pointLightShadowMaps, get<2>(mShadows), transforms.world(mIndex)[3].xyz(),
+                                   mRadius * transforms.worldScaleFactor(mIndex), global->Shaders.depthPointLight);
         global->device->setClearColor(0.0, 0.0, 0.0);
     }
 
     void PointLightNode::mCreateVirtualLights(void)
     {
+        GXY_ZONE("PointLightNode::mCreateVirtualLights");
         get<1>(mVirtualLight) = true;
 
-        renderIntoCubeMap(global->Lighting.vplPointLightCreation, mMatrix[3].xyz(), mRadius * mParent->mGlobalScaleFactor, global->Shaders.createVPLPoint);
+        TransformHierarchy const &transforms = global->sceneManager->transforms();
+
+        renderIntoCubeMap(global->Lighting.vplPointLightCreation, transforms.world(mIndex)[3].xyz(),
+                          mRadius * transforms.worldScaleFactor(mIndex), global->Shaders.createVPLPoint);
     }
 
     PointLightNode::~PointLightNode()
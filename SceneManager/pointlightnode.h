@@ -45,15 +45,30 @@ namespace GXY
         inline void setIntensity(float intensity) {mIntensity = intensity;}
 
         /**
-         * @brief If a transformation of a Node is performed, matrix is recomputed
+         * @brief Cull the Light, and give what the Pipeline of Light needs if it is inside
+         *
+         * Does not call OpenGL, so it can run on any thread
+         * @param[in] frustrum : Frustrum's Camera
+         * @param[out] light : The PointLight
+         * @param[out] toWorldSpace : Its World Matrix
+         * @return true if it is inside
          */
-        void updateMatrix(void);
+        bool prepare(Frustrum const &frustrum, PointLight &light, glm::mat4 &toWorldSpace) const;
 
         /**
-         * @brief Push Light in Pipeline of Light
-         * @param[in] frustrum : Frustrum's Camera
+         * @brief To know if shadow maps or virtual lights are still to render
+         * @return true if renderPending has something to do
+         */
+        inline bool hasPendingRendering(void) const
+        {
+            return (std::get<0>(mShadows) && !std::get<1>(mShadows)) ||
+                   (std::get<0>(mVirtualLight) && !std::get<1>(mVirtualLight));
+        }
+
+        /**
+         * @brief Render shadow maps and virtual lights enabled since the last time, on the GL thread
          */
-        void pushInPipeline(Frustrum const &frustrum);
+        void renderPending(void);
 
         void enableShadowMaps(s32 index);
         void enableVirtualLight(void);
@@ -62,7 +77,7 @@ namespace GXY
 
     private:
         std::shared_ptr<Node> mParent;
-        glm::mat4 mMatrix;
+        u32 mIndex; //!< Index in the TransformHierarchy, its local matrix places the sphere in the Node
         glm::vec3 mPosition;
         float mRadius;
         glm::vec3 mColor;
@@ -73,6 +88,11 @@ namespace GXY
 
         void mRenderShadowMaps(void);
         void mCreateVirtualLights(void);
+
+        /**
+         * @brief Put the position and the radius in the local matrix
+         */
+        void mUpdateLocal(void);
     };
 }
 
@@ -6,15 +6,74 @@
  */
 
 #include "scenemanager.h"
+#include "modelnode.h"
+#include "pointlightnode.h"
+#include "hlodproxy.h"
+#include "../System/jobsystem.h"
 
 using namespace std;
 using namespace glm;
 namespace GXY
 {
-    SceneManager::SceneManager(void)
+    static u32 const TRAVERSAL_DEPTH = 2; //!< Levels of Nodes split in several tasks
+
+    /**
+     * @brief Fence the region of one ring Buffer read by the commands already sent, and empty the next one
+     *
+     * Only waits if the GPU still reads the next region, written FRAMES_IN_FLIGHT layouts ago
+     * @param[in] buffer : The Buffer
+     */
+    template<typename T>
+    static void nextLayoutRegion(Buffer<T> &buffer)
+    {
+        buffer.lockRegion();
+        buffer.nextRegion();
+        buffer.setToZeroElement();
+    }
+
+    /**
+     * @brief Measure the CPU time spent by one pass while it is alive, and put a GPUMarker and a CPU zone around it
+     */
+    class PassTimer
+    {
+    public:
+        /**
+         * @brief PassTimer Constructor
+         * @param[out] timings : where the time will be pushed
+         * @param[in] name : name of the pass
+         */
+        PassTimer(vector<pair<char const*, double>> &timings, char const *name) :
+            mTimings(timings), mName(name), mStart(chrono::steady_clock::now()), mMarker(name)
+#ifdef GXY_PROFILE
+            , mZone(name)
+#endif
+        {}
+
+        /**
+         * @brief PassTimer Destructor : push the time in milliseconds
+         */
+        ~PassTimer(void)
+        {
+            mTimings.emplace_back(mName, chrono::duration<double, milli>(chrono::steady_clock::now() - mStart).count());
+        }
+
+    private:
+        vector<pair<char const*, double>> &mTimings; //!< Timings of the frame
+        char const *mName; //!< Name of the pass
+        chrono::steady_clock::time_point mStart; //!< Beginning of the pass
+        GPUMarker mMarker; //!< GPU time of the pass
+#ifdef GXY_PROFILE
+        CPUZone mZone; //!< Pass on the CPU timeline
+#endif
+    };
+
+    SceneManager::SceneManager(void) :
+        mOcclusionCulling(true), mBackfaceCulling(false), mMinPixelSize(0.0f), mLodBias(0.0f), mShadowLodBias(1.0f), mNumModelNodes(0), mSceneChanged(false)
     {
         global->sceneManager = this;
-        mRootNode = make_shared<Node>(mat4(1.0f));
+        mTransforms = make_shared<TransformHierarchy>();
+        mModelBounds = make_shared<BoundingVolumeHierarchy>();
+        mRootNode = make_shared<Node>(TransformHierarchy::NO_PARENT);
 
         mGeometryFrameBuffer = make_shared<FrameBuffer>();
         mDirectLightFrameBuffer = make_shared<FrameBuffer>();
@@ -36,6 +95,14 @@ namespace GXY
 
         for(u32 i = 0; i < 3; ++i)
             mImageAmbientOcclusion->emptyTexture(i, powerOf2(global->device->width()), powerOf2(global->device->height()), R32F);
+
+        u32 wHiZ = powerOf2(global->device->width()) / 2;
+        u32 hHiZ = powerOf2(global->device->height()) / 2;
+
+        for(mHiZLevels = 1; (std::max(wHiZ, hHiZ) >> mHiZLevels) > 0; ++mHiZLevels);
+
+        mHiZ = make_shared<Texture>(1);
+        mHiZ->emptyTextureMipmaps(0, wHiZ, hHiZ, mHiZLevels, R32F);
     }
 
     void SceneManager::createCameraStatic(const vec3 &pos, const vec3 &look)
@@ -52,27 +119,93 @@ namespace GXY
 
     void SceneManager::render()
     {
+        mPassTimings.clear();
+
+        mBeginFrame();
         initialize();
+        commitTransforms();
+        mUpdateHlodProxies();
+
+        // Loads, new ModelNodes and proxy swaps since the last frame share one rebuild
+        if(mSceneChanged)
+            mBuildScene();
 
         mGeometryFrameBuffer->bind();
         global->device->clearDepthColorBuffer();
-            pushModelsInPipeline(mCamera);
+        {
+            PassTimer timer(mPassTimings, "culling");
+            pushModelsInPipeline(mCamera, mOcclusionCulling ? CULLING_LAST_VISIBLE : CULLING_FRUSTRUM, mMinPixelSize, mBackfaceCulling,
+                                 mLodBias);
+        }
+
+        if(global->Model.command->numElements() == 0)
+        {
+            mEndFrame();
+            return;
+        }
 
-            if(global->Model.command->numElements() == 0)
-                return;
+        // Clusters facing away are already culled, their remaining back faces as well
+        if(mBackfaceCulling)
+            glEnable(GL_CULL_FACE);
+        {
+            PassTimer timer(mPassTimings, "depth");
             global->Shaders.depth->use();
                 renderDepthPass();
+        }
+        if(mOcclusionCulling)
+        {
+            PassTimer timer(mPassTimings, "occlusion");
+            renderOcclusionPass();
+        }
+        {
+            PassTimer timer(mPassTimings, "models");
             global->Shaders.model->use();
                 renderModels();
+        }
+        glDisable(GL_CULL_FACE);
+        {
+            PassTimer timer(mPassTimings, "ambientOcclusion");
+            renderAmbientOcclusion();
+        }
+        {
+            PassTimer timer(mPassTimings, "pointLights");
+            renderPointLights();
+            glDisable(GL_BLEND);
+        }
+        {
+            PassTimer timer(mPassTimings, "indirect");
+            renderIndirectPointLight();
+        }
+        {
+            PassTimer timer(mPassTimings, "final");
+            renderFinal();
+        }
+
+        mEndFrame();
+    }
+
+    void SceneManager::mBeginFrame(void)
+    {
+        // Only wait if the GPU still reads the regions we are going to fill
+        global->Uniform.contextBuffer->nextRegion();
 
-        renderAmbientOcclusion();
+        global->Model.transformUpdate->nextRegion();
+        global->Model.transformUpdate->setToZeroElement();
 
-            renderPointLights();
-        glDisable(GL_BLEND);
+        global->Lighting.commandPointLights->nextRegion();
+        global->Lighting.pointLight->nextRegion();
+        global->Lighting.toWorldSpace->nextRegion();
+    }
 
-        renderIndirectPointLight();
+    void SceneManager::mEndFrame(void)
+    {
+        global->Uniform.contextBuffer->lockRegion();
 
-        renderFinal();
+        global->Model.transformUpdate->lockRegion();
+
+        global->Lighting.commandPointLights->lockRegion();
+        global->Lighting.pointLight->lockRegion();
+        global->Lighting.toWorldSpace->lockRegion();
     }
 
     void SceneManager::initialize()
@@ -83,46 +216,462 @@ namespace GXY
                                                                                            powerOf2(global->device->width()), powerOf2(global->device->height()));
     }
 
-    void SceneManager::pushModelsInPipeline(shared_ptr<AbstractCamera> const &camera)
+    void SceneManager::pushModelsInPipeline(shared_ptr<AbstractCamera> const &camera, CullingPhase phase, float minPixelSize,
+                                            bool backfaceCulling, float lodBias)
+    {
+        mUploadTransforms();
+
+        mNextView(*camera);
+
+        if(global->Model.command->numElements() == 0)
+            return;
+
+        // Compute Matrix and Culling pass
+        global->Shaders.matrixCulling->use();
+        global->Shaders.matrixCulling->uniform1i(phase, "phase");
+        global->Shaders.matrixCulling->uniform1f(minPixelSize, "minPixelSize");
+        global->Shaders.matrixCulling->uniform1i(backfaceCulling, "backfaceCulling");
+        global->Shaders.matrixCulling->uniform1f(lodBias, "lodBias");
+        global->Shaders.matrixCulling->uniform2f(vec2(powerOf2(global->device->width()), powerOf2(global->device->height())), "viewportSize");
+
+        // Instances and commands are appended by the culling pass
+        global->Model.drawCount->clear();
+        global->Model.instanceCount->clear();
+
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_UNIFORM_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+            glDispatchCompute(global->Model.instance->numElements() / 64 + 1, 1, 1);
+
+        mCompactCommands(phase);
+    }
+
+    void SceneManager::mNextView(AbstractCamera &camera)
     {
-        global->Model.command->setToZeroElement();
-        global->Model.toWorldSpace->setToZeroElement();
+        // Commands already sent keep reading the previous region, only a region used FRAMES_IN_FLIGHT frames ago is waited for
+        global->Uniform.frustrumBuffer->lockRegion();
+        global->Uniform.frustrumBuffer->nextRegion();
+
+        FrustrumUniform *frustrum = global->Uniform.frustrumBuffer->map();
 
-        global->Uniform.frustrumBuffer->map()->frustrumMatrix = camera->toClipSpace();
-        global->Uniform.frustrumBuffer->map()->posCamera = camera->position();
+        frustrum->frustrumMatrix = camera.toClipSpace();
+        frustrum->posCamera = camera.position();
         for(u32 i = 0; i < 6; ++i)
-            global->Uniform.frustrumBuffer->map()->planesFrustrum[i] = camera->frustrum().mPlanes[i].plane;
+            frustrum->planesFrustrum[i] = camera.frustrum().mPlanes[i].plane;
+
+        frustrum->numberMeshesPointLights = uvec4(global->Model.command->numElements(), global->Lighting.commandPointLights->numElements(),
+                                                  global->Model.instance->numElements(), 0);
+    }
+
+    void SceneManager::pushInstancedModel(Model *model)
+    {
+        mInstancedModels.push_back(model);
+    }
+
+    void SceneManager::commitTransforms(void)
+    {
+        mTransforms->update();
+    }
+
+    u32 SceneManager::addModelNode(void)
+    {
+        mSceneChanged = true;
+
+        return mNumModelNodes++;
+    }
+
+    u32 SceneManager::addHlodProxy(HlodProxy *proxy)
+    {
+        mSceneChanged = true;
+        mHlodProxies.push_back(proxy);
+
+        return mHlodProxies.size() - 1;
+    }
+
+    void SceneManager::mUpdateHlodProxies(void)
+    {
+        // Subtrees are compared to their proxy only when something moved or was loaded
+        bool check = mSceneChanged || !mTransforms->changed().empty();
+        vec3 camera = mCamera->position().xyz();
+
+        for(auto proxy : mHlodProxies)
+            proxy->update(camera, check);
+    }
+
+    void SceneManager::mBuildScene(void)
+    {
+        GXY_ZONE("SceneManager::mBuildScene");
+        GXY_COUNTER("modelNodes", mNumModelNodes);
+
+        // The frames in flight keep reading the old layout : the new one goes in the next region
+        nextLayoutRegion(*global->Model.command);
+        nextLayoutRegion(*global->Model.aabb3D);
+        nextLayoutRegion(*global->Model.clusterCone);
+        nextLayoutRegion(*global->Model.clusterLod);
+        nextLayoutRegion(*global->Model.instance);
+        nextLayoutRegion(*global->Model.hlodSwitch);
+
+        mTraverse([](TraversalTask const &task, TraversalList &list)
+        {
+            task.node->collectModels(task.first, task.last, task.withChildren, list);
+        });
+
+        // Same order as a walk on one thread, so the same layout
+        for(auto const &list : mTraversalLists)
+            for(auto model : list.models)
+                model->pushInPipeline();
+
+        for(auto proxy : mHlodProxies)
+            proxy->pushInPipeline();
+
+        // One switch by proxy, even not baked : instances of its subtree point to it
+        bool isReallocateHlod = false;
+        HlodSwitch *switches = global->Model.hlodSwitch->append(mHlodProxies.size(), isReallocateHlod);
+
+        for(u32 i = 0; i < mHlodProxies.size(); ++i)
+            switches[i] = mHlodProxies[i]->hlodSwitch();
+
+        if(isReallocateHlod)
+            global->Model.hlodSwitch->bindBase(SHADER_STORAGE, 19);
+
+        // ModelNodes which share one Model become one instanced command by cluster
+        vector<u32> firstCommands(mInstancedModels.size()), firstInstances(mInstancedModels.size());
+        u32 numCommands = 0, numInstances = 0;
+
+        for(u32 i = 0; i < mInstancedModels.size(); ++i)
+        {
+            firstCommands[i] = numCommands;
+            firstInstances[i] = numInstances;
+            numCommands += mInstancedModels[i]->numClusters();
+            numInstances += mInstancedModels[i]->numClusters() * mInstancedModels[i]->numInstances();
+        }
+
+        GXY_COUNTER("pushedCommands", numCommands);
+        GXY_COUNTER("instances", numInstances);
+
+        bool isReallocateCommand = false; // command, aabb3D, clusterCone and clusterLod have the same size
+        bool isReallocateInstance = false;
+
+        global->Model.command->append(numCommands, isReallocateCommand);
+        global->Model.aabb3D->append(numCommands, isReallocateCommand);
+        global->Model.clusterCone->append(numCommands, isReallocateCommand);
+        global->Model.clusterLod->append(numCommands, isReallocateCommand);
+        global->Model.instance->append(numInstances, isReallocateInstance);
+
+        if(isReallocateCommand)
+        {
+            global->Model.command->bindBase(SHADER_STORAGE, 0);
+            global->Model.aabb3D->bindBase(SHADER_STORAGE, 3);
+            global->Model.clusterCone->bindBase(SHADER_STORAGE, 17);
+            global->Model.clusterLod->bindBase(SHADER_STORAGE, 18);
+
+            global->Model.commandOcclusion->allocate(global->Model.command->numMaxElements());
+            global->Model.commandOcclusion->bindBase(SHADER_STORAGE, 10);
+
+            global->Model.commandCompact->allocate(global->Model.command->numMaxElements());
+            global->Model.commandCompact->bindBase(SHADER_STORAGE, 12);
+
+            global->Model.instanceCount->allocate(global->Model.command->numMaxElements());
+            global->Model.instanceCount->bindBase(SHADER_STORAGE, 15);
+        }
+
+        if(isReallocateInstance)
+        {
+            global->Model.instance->bindBase(SHADER_STORAGE, 14);
+
+            // Buffers of occlusion culling, cleared below
+            global->Model.visibility->allocate(global->Model.instance->numMaxElements());
+            global->Model.visibility->bindBase(SHADER_STORAGE, 9);
+
+            global->Model.visibleInstance->allocate(global->Model.instance->numMaxElements());
+            global->Model.visibleInstance->bindBase(SHADER_STORAGE, 13);
+        }
+
+        // Each Model writes its own elements, the Buffers are already large enough
+        global->jobSystem->parallelFor(0, mInstancedModels.size(), 16, [&](u32 i)
+        {
+            mInstancedModels[i]->writeInstancesInPipeline(firstCommands[i], firstInstances[i]);
+        });
+
+        mInstancedModels.clear();
+
+        // Instances moved, their visibility at the last frame is lost
+        if(global->Model.visibility->numMaxElements() > 0)
+            global->Model.visibility->clear();
+
+        glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+
+        mSceneChanged = false;
+    }
+
+    void SceneManager::mUploadTransforms(void)
+    {
+        commitTransforms();
+
+        if(mTransforms->changed().empty())
+            return;
+
+        GXY_ZONE("SceneManager::mUploadTransforms");
+
+        // Matrices already in toWorldSpace are copied by the GPU
+        if(global->Model.toWorldSpace->numMaxElements() < mNumModelNodes)
+        {
+            while(global->Model.toWorldSpace->numMaxElements() < mNumModelNodes)
+                global->Model.toWorldSpace->reallocate();
+
+            global->Model.toWorldSpace->bindBase(SHADER_STORAGE, 2);
+
+            // We reallocate toClipSpace as well
+            global->Model.toClipSpace->allocate(global->Model.toWorldSpace->numMaxElements());
+            global->Model.toClipSpace->bindBase(SHADER_STORAGE, 1);
+        }
+
+        bool isReallocate = false;
+        u32 firstUpdate = global->Model.transformUpdate->numElements();
+
+        // Nodes and PointLightNodes are not in toWorldSpace
+        for(auto index : mTransforms->changed())
+        {
+            TransformUpdate update;
+            u32 slot = mTransforms->slot(index);
+
+            if(slot == TransformHierarchy::NO_SLOT)
+                continue;
+
+            update.toWorldSpace = mTransforms->world(index);
+            update.slot = uvec4(slot, 0, 0, 0);
+
+            global->Model.transformUpdate->push(update, isReallocate);
+        }
+
+        mMarkModelBounds();
+        mTransforms->clearChanged();
 
-            mRootNode->pushModelsInPipeline(camera->frustrum());
-            global->Uniform.frustrumBuffer->map()->numberMeshesPointLights.x = global->Model.command->numElements();
+        u32 numberUpdates = global->Model.transformUpdate->numElements() - firstUpdate;
 
-            // Compute Matrix and Culling pass
-            global->Shaders.matrixCulling->use();
-                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_UNIFORM_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
-                glDispatchCompute(global->Model.command->numElements() / 64 + 1, 1, 1);
+        GXY_COUNTER("uploadedTransforms", numberUpdates);
+
+        if(numberUpdates == 0)
+            return;
+
+        if(isReallocate)
+            global->Model.transformUpdate->bindBase(SHADER_STORAGE, 16);
+
+        global->Shaders.scatterTransforms->use();
+        global->Shaders.scatterTransforms->uniform1i(firstUpdate, "firstUpdate");
+        global->Shaders.scatterTransforms->uniform1i(numberUpdates, "numberUpdates");
+
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            glDispatchCompute(numberUpdates / 64 + 1, 1, 1);
+    }
+
+    void SceneManager::mMarkModelBounds(void)
+    {
+        mBoundsPending.resize(mTransforms->size(), 0);
+
+        for(auto index : mTransforms->changed())
+        {
+            if(mTransforms->slot(index) == TransformHierarchy::NO_SLOT || mBoundsPending[index])
+                continue;
+
+            mBoundsPending[index] = 1;
+            mBoundsChanged.push_back(index);
+        }
+    }
+
+    void SceneManager::mUpdateModelBounds(void)
+    {
+        GXY_ZONE("SceneManager::mUpdateModelBounds");
+        GXY_COUNTER("refitModelNodes", mBoundsChanged.size());
+
+        // A Model still loading has no box yet : setBounds changes its entry again once it is loaded
+        for(auto index : mBoundsChanged)
+        {
+            mBoundsPending[index] = 0;
+
+            if(mTransforms->hasBounds(index))
+                mModelBounds->setBounds(index, mTransforms->ownBounds(index));
+        }
+
+        mBoundsChanged.clear();
+    }
+
+    void SceneManager::cullModelNodes(Frustrum const &frustrum, vector<u32> &visible)
+    {
+        commitTransforms();
+        mMarkModelBounds();
+        mUpdateModelBounds();
+
+        mModelBounds->cull(frustrum, visible);
+    }
+
+    void SceneManager::mTraverse(function<void(TraversalTask const&, TraversalList&)> const &visit)
+    {
+        GXY_ZONE("SceneManager::mTraverse");
+
+        mTraversalTasks.clear();
+        mRootNode->splitTraversal(mTraversalTasks, TRAVERSAL_DEPTH);
+
+        // Lists keep their memory from one frame to the next
+        if(mTraversalLists.size() < mTraversalTasks.size())
+            mTraversalLists.resize(mTraversalTasks.size());
+
+        for(auto &list : mTraversalLists)
+            list.clear();
+
+        global->jobSystem->parallelFor(0, mTraversalTasks.size(), 1, [&](u32 i)
+        {
+            GXY_ZONE("SceneManager::traversalTask");
+            visit(mTraversalTasks[i], mTraversalLists[i]);
+        });
+
+        GXY_COUNTER("traversalTasks", mTraversalTasks.size());
+    }
+
+    void SceneManager::mPushPointLights(void)
+    {
+        vector<u32> firstLights(mTraversalLists.size());
+        u32 numLights = 0;
+
+        for(u32 i = 0; i < mTraversalLists.size(); ++i)
+        {
+            firstLights[i] = numLights;
+            numLights += mTraversalLists[i].pointLights.size();
+        }
+
+        bool reallocate = false;
+
+        DrawArrayCommand *commands = global->Lighting.commandPointLights->append(numLights, reallocate);
+        PointLight *lights = global->Lighting.pointLight->append(numLights, reallocate);
+        mat4 *matrices = global->Lighting.toWorldSpace->append(numLights, reallocate);
+
+        global->jobSystem->parallelFor(0, mTraversalLists.size(), 1, [&](u32 i)
+        {
+            TraversalList const &list = mTraversalLists[i];
+
+            for(u32 j = 0; j < list.pointLights.size(); ++j)
+            {
+                u32 index = firstLights[i] + j;
+
+                commands[index].count = 4;
+                commands[index].instanceCount = 1;
+                commands[index].first = index * 4;
+                commands[index].baseInstance = 0;
+
+                lights[index] = list.pointLights[j];
+                matrices[index] = list.pointLightMatrices[j];
+            }
+        });
+
+        if((global->Lighting.commandPointLights->numElements() * 4 > global->Lighting.quadsPointLights->numMaxElements()))
+        {
+            global->Lighting.quadsPointLights->allocate(4 * global->Lighting.commandPointLights->numElements());
+
+            global->Lighting.vaoPointLight->create();
+            global->Lighting.vaoPointLight->configure(*global->Lighting.quadsPointLights);
+        }
+
+        if(reallocate)
+        {
+            global->Lighting.quadsPointLights->bindBase(SHADER_STORAGE, 5);
+            global->Lighting.pointLight->bindBase(SHADER_STORAGE, 6);
+            global->Lighting.toWorldSpace->bindBase(SHADER_STORAGE, 7);
+        }
+
+        // Shadow maps and virtual lights call OpenGL : on this thread only
+        for(auto const &list : mTraversalLists)
+            for(auto pointLight : list.pendingPointLights)
+                pointLight->renderPending();
+    }
+
+    void SceneManager::mCompactCommands(CullingPhase phase)
+    {
+        global->Shaders.compactCommands->use();
+        global->Shaders.compactCommands->uniform1i(phase, "phase");
+
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            glDispatchCompute(global->Model.command->numElements() / 64 + 1, 1, 1);
     }
 
     void SceneManager::renderDepthPass()
     {
         //Depth Pass
-        global->Model.command->bind(DRAW_INDIRECT);
+        global->Model.commandCompact->bind(DRAW_INDIRECT);
+        global->Model.drawCount->bind(PARAMETER);
         global->Model.vaoDepth->bind();
         glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 
-            synchronize(); // clear and dispatch
             glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
-            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, global->Model.command->numElements(), 0);
+            glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0,
+                                                global->Model.command->numElements(), 0);
+    }
+
+    void SceneManager::renderHiZ(void)
+    {
+        global->Shaders.hiZ->use();
+        mGeometryFrameBuffer->bindDepthBufferTexture(0);
+
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        for(u32 level = 0; level < mHiZLevels; ++level)
+        {
+            u32 w = std::max(mHiZ->getWidth(0) >> level, 1u);
+            u32 h = std::max(mHiZ->getHeight(0) >> level, 1u);
+
+            global->Shaders.hiZ->uniform1i(level, "level");
+
+            if(level > 0)
+                mHiZ->bindImageLevel(0, 0, level - 1, R32F);
+
+            mHiZ->bindImageLevel(0, 1, level, R32F);
+
+                glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+                glDispatchCompute((w + 7) / 8, (h + 7) / 8, 1);
+        }
+    }
+
+    void SceneManager::renderOcclusionPass(void)
+    {
+        renderHiZ();
+
+        // Test all meshes against what the first phase drew
+        global->Shaders.matrixCulling->use();
+        global->Shaders.matrixCulling->uniform1i(CULLING_OCCLUSION, "phase");
+        mHiZ->bindTextures(0, 0, 1);
+
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            glDispatchCompute(global->Model.instance->numElements() / 64 + 1, 1, 1);
+
+        mCompactCommands(CULLING_OCCLUSION);
+
+        // Add the instances which were hidden at the last frame
+        global->Shaders.depth->use();
+        global->Model.commandOcclusion->bind(DRAW_INDIRECT);
+        global->Model.drawCount->bind(PARAMETER);
+        global->Model.vaoDepth->bind();
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+            glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+            glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, sizeof(u32),
+                                                global->Model.command->numElements(), 0);
     }
 
     void SceneManager::renderModels()
     {
         // Rendering pass
+        global->Model.drawCount->bind(PARAMETER);
         global->Model.vao->bind();
-        synchronize();
         glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
         glDepthFunc(GL_EQUAL);
         glDepthMask(GL_FALSE);
-            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, global->Model.command->numElements(), 0);
+            glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+            // Meshes of the first phase, then the meshes added by the occlusion phase
+            global->Model.commandCompact->bind(DRAW_INDIRECT);
+            glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0,
+                                                global->Model.command->numElements(), 0);
+
+            global->Model.commandOcclusion->bind(DRAW_INDIRECT);
+            glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, sizeof(u32),
+                                                global->Model.command->numElements(), 0);
         glDepthFunc(GL_LESS);
         glDepthMask(GL_TRUE);
     }
@@ -133,17 +682,20 @@ namespace GXY
         global->Lighting.pointLight->setToZeroElement();
         global->Lighting.toWorldSpace->setToZeroElement();
 
-        mRootNode->pushPointLightsInPipeline(mCamera->frustrum());
+        Frustrum const &frustrum = mCamera->frustrum();
+
+        mTraverse([&frustrum](TraversalTask const &task, TraversalList &list)
+        {
+            task.node->collectPointLights(task.first, task.last, task.withChildren, frustrum, list);
+        });
+
+        mPushPointLights();
 
         mDirectLightFrameBuffer->bind();
         global->device->clearColorBuffer();
 
-        global->Uniform.frustrumBuffer->map()->frustrumMatrix = mCamera->toClipSpace();
-        global->Uniform.frustrumBuffer->map()->posCamera = mCamera->position();
-        for(u32 i = 0; i < 6; ++i)
-            global->Uniform.frustrumBuffer->map()->planesFrustrum[i] = mCamera->frustrum().mPlanes[i].plane;
-
-        global->Uniform.frustrumBuffer->map()->numberMeshesPointLights.y = global->Lighting.commandPointLights->numElements();
+        // Cube maps of the lights took their own views meanwhile
+        mNextView(*mCamera);
 
         if(global->Lighting.commandPointLights->numElements() == 0)
             return;
@@ -164,14 +716,14 @@ namespace GXY
         glBlendEquation(GL_FUNC_ADD);
         glBlendFunc(GL_ONE, GL_ONE);
 
-        synchronize();
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
-        glMultiDrawArraysIndirect(GL_TRIANGLE_STRIP, nullptr, global->Lighting.commandPointLights->numElements(), 0);
+        glMultiDrawArraysIndirect(GL_TRIANGLE_STRIP, (void*)global->Lighting.commandPointLights->regionOffset(),
+                                  global->Lighting.commandPointLights->numElements(), 0);
     }
 
     void SceneManager::renderIndirectPointLight(void)
     {
-        synchronize();
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
         mIndirectLightFrameBuffer->bind();
         global->device->clearColorBuffer();
 
@@ -188,29 +740,33 @@ namespace GXY
         mGeometryFrameBuffer->bindTextures(1, 0, 2);
         global->Shaders.ambientOcclusion->use();
 
-            synchronize();
             glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
             glDispatchCompute(powerOf2(global->device->width()) / 8, powerOf2(global->device->height()) / 8, 1);
 
-        mImageAmbientOcclusion->bindImages(1, 0, 1);
-        mImageAmbientOcclusion->bindTextures(0, 0, 1);
-        global->Shaders.blurHorizontalPass->use();
-
-            synchronize();
-            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
-            glDispatchCompute(powerOf2(global->device->width()) / 64, powerOf2(global->device->height()), 1);
-
-        mImageAmbientOcclusion->bindImages(2, 0, 1);
-        mImageAmbientOcclusion->bindTextures(1, 0, 1);
-        global->Shaders.blurVerticalPass->use();
-            synchronize();
-            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
-            glDispatchCompute(powerOf2(global->device->width()), powerOf2(global->device->height()) / 64, 1);
+        {
+            GPUMarker marker("blurHorizontal");
+
+            mImageAmbientOcclusion->bindImages(1, 0, 1);
+            mImageAmbientOcclusion->bindTextures(0, 0, 1);
+            global->Shaders.blurHorizontalPass->use();
+
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+                glDispatchCompute(powerOf2(global->device->width()) / 64, powerOf2(global->device->height()), 1);
+        }
+        {
+            GPUMarker marker("blurVertical");
+
+            mImageAmbientOcclusion->bindImages(2, 0, 1);
+            mImageAmbientOcclusion->bindTextures(1, 0, 1);
+            global->Shaders.blurVerticalPass->use();
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+                glDispatchCompute(powerOf2(global->device->width()), powerOf2(global->device->height()) / 64, 1);
+        }
     }
 
     void SceneManager::renderFinal()
     {
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        global->device->bindFrameBuffer();
         global->Shaders.final->use();
         global->Quad.vao->bind();
 
@@ -218,9 +774,7 @@ namespace GXY
         mImageAmbientOcclusion->bindTextures(2, 1, 1);
         mDirectLightFrameBuffer->bindTextures(0, 2, 1);
         mIndirectLightFrameBuffer->bindTextures(0, 3, 1);
-        global->device->setViewPort();
 
-            synchronize();
             glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
             glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
     }
@@ -9,12 +9,16 @@
 #define SCENEMANAGER_H
 
 #include "node.h"
+#include "transformhierarchy.h"
+#include "boundingvolumehierarchy.h"
 #include "../System/device.h"
 #include "../System/shader.h"
 #include "../System/buffer.h"
 #include "../System/vertexarray.h"
 #include "../Camera/camera.h"
 #include "../System/framebuffer.h"
+#include "../Debug/gpuprofiler.h"
+#include "../Debug/cpuprofiler.h"
 
 namespace  GXY
 {
@@ -41,10 +45,63 @@ namespace  GXY
          */
         void initialize(void);
 
-        void pushModelsInPipeline(std::shared_ptr<AbstractCamera> const &camera);
+        /**
+         * @brief Upload what changed in the scene and run the culling pass on all instances
+         *
+         * The scene stays on the GPU : render builds it again once per frame, only when ModelNodes were added,
+         * and only the World Matrices changed since the last call are uploaded
+         * @param[in] camera : The camera
+         * @param[in] phase : CULLING_FRUSTRUM, or CULLING_LAST_VISIBLE for the first phase of occlusion culling
+         * @param[in] minPixelSize : Clusters smaller on the screen are culled, 0 to keep all
+         * @param[in] backfaceCulling : Cull clusters whose triangles all face away from the camera
+         * @param[in] lodBias : Coarser levels of detail are chosen as if meshes were 2^lodBias times smaller
+         */
+        void pushModelsInPipeline(std::shared_ptr<AbstractCamera> const &camera, CullingPhase phase = CULLING_FRUSTRUM,
+                                  float minPixelSize = 0.0f, bool backfaceCulling = false, float lodBias = 0.0f);
+
+        /**
+         * @brief Add a Model with instances in the scene being built, called by Model
+         * @param[in] model : The model
+         */
+        void pushInstancedModel(Model *model);
+
+        /**
+         * @brief Compute matrices of all Nodes edited since the last commit, in one pass
+         *
+         * Called at the beginning of render, and before each culling pass.
+         * Call it to read matrices of Nodes edited in the same frame
+         */
+        void commitTransforms(void);
+
+        /**
+         * @brief Give a slot in toWorldSpace to a new ModelNode, the scene will be built again
+         * @return The slot of its World Matrix
+         */
+        u32 addModelNode(void);
+
+        /**
+         * @brief Get the ModelNodes inside a frustrum, whatever the Nodes which own them
+         *
+         * Traverse the BoundingVolumeHierarchy over world boxes of all ModelNodes,
+         * refitted here with the matrices changed since the last call : frames without caller do not pay for it
+         * @param[in] frustrum : The frustrum
+         * @param[out] visible : Indices of ModelNodes inside, in the TransformHierarchy
+         */
+        void cullModelNodes(Frustrum const &frustrum, std::vector<u32> &visible);
 
         void renderDepthPass(void);
 
+        /**
+         * @brief Build the Hi-Z pyramid from the depth buffer
+         */
+        void renderHiZ(void);
+
+        /**
+         * @brief Second phase of occlusion culling : test all clusters against the Hi-Z,
+         * and add in the depth buffer the clusters which were hidden at the last frame
+         */
+        void renderOcclusionPass(void);
+
         /**
          * @brief Render all Models on equal Depth
          */
@@ -88,7 +145,81 @@ namespace  GXY
          */
         inline std::shared_ptr<Node> getRootNode(void) {return mRootNode;}
 
+        /**
+         * @brief Get matrices and bounding boxes of all Nodes, updated once by culling pass
+         * @return The TransformHierarchy
+         */
+        inline TransformHierarchy &transforms(void) {return *mTransforms;}
+
+        /**
+         * @brief Build the scene again at the next frame, a Model was loaded or a proxy swapped
+         *
+         * All calls of one frame cost one rebuild
+         */
+        inline void sceneChanged(void) {mSceneChanged = true;}
+
+        /**
+         * @brief Add one proxy, updated at each frame, called by HlodProxy
+         * @param[in] proxy : The proxy
+         * @return index of its HlodSwitch
+         */
+        u32 addHlodProxy(HlodProxy *proxy);
+
+        /**
+         * @brief Use a Camera created outside the SceneManager
+         * @param camera : The new Camera
+         */
+        inline void setCamera(std::shared_ptr<AbstractCamera> const &camera) {mCamera = camera;}
+
+        /**
+         * @brief Enable or disable the occlusion culling against the Hi-Z
+         * @param enable
+         */
+        inline void setOcclusionCulling(bool enable) {mOcclusionCulling = enable;}
+
+        /**
+         * @brief Cull back faces of Models, and clusters which only have back faces
+         *
+         * Disabled by default : all faces are drawn, as some assets have materials seen from both sides
+         * @param enable
+         */
+        inline void setBackfaceCulling(bool enable) {mBackfaceCulling = enable;}
+
+        /**
+         * @brief Cull clusters whose bounding box is smaller than minPixelSize on the screen
+         * @param minPixelSize : size in pixels, 0 to disable
+         */
+        inline void setSmallFeatureCulling(float minPixelSize) {mMinPixelSize = minPixelSize;}
+
+        /**
+         * @brief Choose levels of detail of the camera as if meshes were 2^lodBias times smaller on the screen
+         * @param lodBias : 0 by default, negative for finer levels
+         */
+        inline void setLodBias(float lodBias) {mLodBias = lodBias;}
+
+        /**
+         * @brief Same as setLodBias for the shadow maps of point lights, their faces are small and many
+         * @param lodBias : 1 by default
+         */
+        inline void setShadowLodBias(float lodBias) {mShadowLodBias = lodBias;}
+
+        /**
+         * @brief Get the bias of the levels of detail for shadow maps
+         * @return the bias
+         */
+        inline float shadowLodBias(void) const {return mShadowLodBias;}
+
+        /**
+         * @brief Get the CPU time spent by each pass during the last render
+         * @return pairs (name of pass, time in milliseconds) in order of execution
+         */
+        inline std::vector<std::pair<char const*, double>> const &passTimings(void) const {return mPassTimings;}
+
     private:
+        std::shared_ptr<TransformHierarchy> mTransforms; //*< Matrices and bounding boxes of all Nodes
+        std::shared_ptr<BoundingVolumeHierarchy> mModelBounds; //*< World boxes of all ModelNodes
+        std::vector<u32> mBoundsChanged; //*< ModelNodes moved since mModelBounds was refitted
+        std::vector<u8> mBoundsPending; //*< The entry is in mBoundsChanged
         std::shared_ptr<Node> mRootNode; //*< The Root Node
         std::shared_ptr<AbstractCamera> mCamera; //*< The Camera
 
@@ -96,6 +227,82 @@ namespace  GXY
         std::shared_ptr<FrameBuffer> mDirectLightFrameBuffer; //*< The FrameBuffer used to render DirectLighting
         std::shared_ptr<FrameBuffer> mIndirectLightFrameBuffer; //*< The FrameBuffer used to render IndirectLighting
         std::shared_ptr<Texture> mImageAmbientOcclusion; //*< AO, Horizontal Pass, Vertical Pass
+        std::shared_ptr<Texture> mHiZ; //*< Farthest depth, half size of the depth buffer, with all its levels
+        u32 mHiZLevels; //*< Number of levels of mHiZ
+        bool mOcclusionCulling; //*< Occlusion culling is enabled
+        bool mBackfaceCulling; //*< Back faces and clusters facing away are culled
+        float mMinPixelSize; //*< Size under which clusters are culled, 0 if disabled
+        float mLodBias; //*< Bias of the levels of detail of the camera
+        float mShadowLodBias; //*< Bias of the levels of detail of shadow maps
+        std::vector<Model*> mInstancedModels; //*< Models with instances in the scene being built
+        std::vector<HlodProxy*> mHlodProxies; //*< Proxies of subtrees, by index of HlodSwitch
+        std::vector<TraversalTask> mTraversalTasks; //*< Parts of the traversal of the tree
+        std::vector<TraversalList> mTraversalLists; //*< What each part of the traversal found
+
+        u32 mNumModelNodes; //*< Number of slots in toWorldSpace
+        bool mSceneChanged; //*< ModelNodes were added or Models loaded since the scene was built
+
+        std::vector<std::pair<char const*, double>> mPassTimings; //*< CPU time of each pass for the last frame
+
+        /**
+         * @brief Go on the next region of all ring Buffers, wait only if the GPU still uses it
+         */
+        void mBeginFrame(void);
+
+        /**
+         * @brief Put a fence on the current region of all ring Buffers
+         */
+        void mEndFrame(void);
+
+        /**
+         * @brief Push commands, bounding boxes and instances of all ModelNodes, only when ModelNodes are added
+         *
+         * The layout is written in the next region of its ring Buffers : the frames in flight are not waited for
+         */
+        void mBuildScene(void);
+
+        /**
+         * @brief Scatter the World Matrices changed since the last upload in toWorldSpace
+         */
+        void mUploadTransforms(void);
+
+        /**
+         * @brief Update the proxies against the camera, bake them again when their subtree changed
+         */
+        void mUpdateHlodProxies(void);
+
+        /**
+         * @brief Remember the ModelNodes whose matrix changed, before they are forgotten by clearChanged
+         */
+        void mMarkModelBounds(void);
+
+        /**
+         * @brief Move in mModelBounds the ModelNodes remembered by mMarkModelBounds
+         */
+        void mUpdateModelBounds(void);
+
+        /**
+         * @brief Split the tree in tasks and visit them on all threads, each one fills its own list
+         * @param[in] visit : Called once by task, must not call OpenGL
+         */
+        void mTraverse(std::function<void(TraversalTask const&, TraversalList&)> const &visit);
+
+        /**
+         * @brief Merge the PointLights of all lists in the Buffers of lighting, in the order of the traversal
+         */
+        void mPushPointLights(void);
+
+        /**
+         * @brief Write one camera in the next region of the frustrum Buffer, the region of the previous view is fenced
+         * @param[in] camera : Camera of the view
+         */
+        void mNextView(AbstractCamera &camera);
+
+        /**
+         * @brief Write the commands of instances which survive one phase of the culling pass
+         * @param[in] phase : Phase of the culling pass
+         */
+        void mCompactCommands(CullingPhase phase);
     };
 }
 
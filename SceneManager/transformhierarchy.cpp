@@ -0,0 +1,191 @@
+/*!
+ * \file transformhierarchy.cpp
+ * \brief Matrices and bounding boxes of all Nodes, stored flat
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#include "transformhierarchy.h"
+#include "../System/device.h"
+#include "../System/jobsystem.h"
+
+using namespace std;
+using namespace glm;
+
+namespace GXY
+{
+    u32 const TransformHierarchy::NO_PARENT;
+    u32 const TransformHierarchy::NO_SLOT;
+
+    static u32 const BOUNDS_GRAIN = 4096; //!< Entries of one job computing boxes
+
+    TransformHierarchy::TransformHierarchy(void) :
+        mAnyDirty(false), mBoundsDirty(false)
+    {
+
+    }
+
+    u32 TransformHierarchy::add(u32 parent)
+    {
+        u32 index = mParent.size();
+
+        assert(parent == NO_PARENT || parent < index);
+
+        mParent.push_back(parent);
+        mLocal.push_back(mat4(1.0f));
+        mWorld.push_back(mat4(1.0f));
+        mLocalScale.push_back(1.0f);
+        mWorldScale.push_back(1.0f);
+        mDirty.push_back(1);
+        mHasBounds.push_back(0);
+        mLocalBounds.push_back(makeAABB3D(vec3(0.0f), vec3(0.0f)));
+        mMin.push_back(vec3(FLT_MAX));
+        mMax.push_back(vec3(-FLT_MAX));
+        mSlot.push_back(NO_SLOT);
+        mIsChanged.push_back(0);
+
+        mAnyDirty = true;
+
+        return index;
+    }
+
+    void TransformHierarchy::setLocal(u32 index, mat4 const &local)
+    {
+        mLocal[index] = local;
+        mDirty[index] = 1;
+        mAnyDirty = true;
+    }
+
+    void TransformHierarchy::multiplyLocal(u32 index, mat4 const &matrix)
+    {
+        mLocal[index] *= matrix;
+        mDirty[index] = 1;
+        mAnyDirty = true;
+    }
+
+    void TransformHierarchy::setLocalScaleFactor(u32 index, float factor)
+    {
+        mLocalScale[index] = factor;
+        mDirty[index] = 1;
+        mAnyDirty = true;
+    }
+
+    void TransformHierarchy::setBounds(u32 index, AABB3D const &bounds)
+    {
+        mHasBounds[index] = 1;
+        mLocalBounds[index] = bounds;
+        mDirty[index] = 1;
+        mAnyDirty = true;
+    }
+
+    void TransformHierarchy::update(void)
+    {
+        if(!mAnyDirty)
+            return;
+
+        GXY_ZONE("TransformHierarchy::update");
+
+        u32 size = mParent.size();
+
+        // Parents are before their children : a dirty parent has already dirtied them
+        for(u32 i = 0; i < size; ++i)
+        {
+            u32 parent = mParent[i];
+
+            if(parent != NO_PARENT && mDirty[parent])
+                mDirty[i] = 1;
+
+            if(!mDirty[i])
+                continue;
+
+            if(parent == NO_PARENT)
+            {
+                mWorld[i] = mLocal[i];
+                mWorldScale[i] = mLocalScale[i];
+            }
+
+            else
+            {
+                mWorld[i] = mWorld[parent] * mLocal[i];
+                mWorldScale[i] = mWorldScale[parent] * mLocalScale[i];
+            }
+
+            if(!mIsChanged[i])
+            {
+                mIsChanged[i] = 1;
+                mChanged.push_back(i);
+            }
+        }
+
+        GXY_COUNTER("changedTransforms", mChanged.size());
+
+        // A box only depends on the world matrix of its entry : computed on all cores
+        global->jobSystem->parallelFor(0, size, BOUNDS_GRAIN, [this](u32 i)
+        {
+            if(!mDirty[i] || !mHasBounds[i])
+                return;
+
+            AABB3D box = computeAABB3D(mLocalBounds[i], mWorld[i]);
+
+            mMin[i] = box.center.xyz() - box.extent.xyz();
+            mMax[i] = box.center.xyz() + box.extent.xyz();
+        });
+
+        fill(mDirty.begin(), mDirty.end(), 0);
+        mAnyDirty = false;
+        mBoundsDirty = true;
+    }
+
+    void TransformHierarchy::clearChanged(void)
+    {
+        for(auto index : mChanged)
+            mIsChanged[index] = 0;
+
+        mChanged.clear();
+    }
+
+    void TransformHierarchy::mPropagateBounds(void)
+    {
+        GXY_ZONE("TransformHierarchy::mPropagateBounds");
+
+        u32 size = mParent.size();
+
+        // Children are after their parent : merge boxes from the end
+        for(u32 i = 0; i < size; ++i)
+        {
+            if(!mHasBounds[i])
+            {
+                mMin[i] = vec3(FLT_MAX);
+                mMax[i] = vec3(-FLT_MAX);
+            }
+        }
+
+        for(u32 i = size; i-- > 0;)
+        {
+            u32 parent = mParent[i];
+
+            if(parent == NO_PARENT || mHasBounds[parent])
+                continue;
+
+            mMin[parent] = glm::min(mMin[parent], mMin[i]);
+            mMax[parent] = glm::max(mMax[parent], mMax[i]);
+        }
+
+        mBoundsDirty = false;
+    }
+
+    AABB3D TransformHierarchy::bounds(u32 index)
+    {
+        if(mBoundsDirty)
+            mPropagateBounds();
+
+        return makeAABB3D(mMin[index], mMax[index]);
+    }
+
+    AABB3D TransformHierarchy::ownBounds(u32 index) const
+    {
+        assert(mHasBounds[index]);
+
+        return makeAABB3D(mMin[index], mMax[index]);
+    }
+}
@@ -0,0 +1,149 @@
+/*!
+ * \file transformhierarchy.h
+ * \brief Matrices and bounding boxes of all Nodes, stored flat
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#ifndef TRANSFORMHIERARCHY_H
+#define TRANSFORMHIERARCHY_H
+
+#include "../include/include.h"
+#include "../Debug/cpuprofiler.h"
+
+namespace GXY
+{
+    /**
+     * @brief The TransformHierarchy class
+     *
+     * Owns one entry for each Node, ModelNode and PointLightNode, in arrays indexed by entry.
+     * A parent is always added before its children, so one pass in order computes
+     * all world matrices, and one pass in reverse order computes bounding boxes of Nodes.
+     * Nodes only keep the index of their entry.
+     *
+     * Edits only mark entries dirty, whatever their number : matrices are computed
+     * by update, and bounding boxes of Nodes only when one of them is asked.
+     */
+    class TransformHierarchy
+    {
+    public:
+        static u32 const NO_PARENT = 0xFFFFFFFF; //!< Parent of the root
+        static u32 const NO_SLOT = 0xFFFFFFFF; //!< Slot of entries which are not drawn
+
+        /**
+         * @brief TransformHierarchy Constructor
+         */
+        TransformHierarchy(void);
+
+        TransformHierarchy(TransformHierarchy const &hierarchy) = delete;
+        TransformHierarchy &operator=(TransformHierarchy const &hierarchy) = delete;
+
+        /**
+         * @brief Add one entry, with an identity local matrix
+         * @param[in] parent : index of the parent entry, or NO_PARENT
+         * @return index of the new entry
+         */
+        u32 add(u32 parent);
+
+        /**
+         * @brief Replace the matrix relative to the parent
+         * @param[in] index : index of the entry
+         * @param[in] local : new local matrix
+         */
+        void setLocal(u32 index, glm::mat4 const &local);
+
+        /**
+         * @brief Apply one transformation after the local matrix
+         * @param[in] index : index of the entry
+         * @param[in] matrix : transformation
+         */
+        void multiplyLocal(u32 index, glm::mat4 const &matrix);
+
+        /**
+         * @brief Replace the scale factor relative to the parent
+         * @param[in] index : index of the entry
+         * @param[in] factor : new factor
+         */
+        void setLocalScaleFactor(u32 index, float factor);
+
+        /**
+         * @brief Give a bounding box to one entry, its world box is computed from it
+         *
+         * Entries without bounding box get the box of their children
+         * @param[in] index : index of the entry
+         * @param[in] bounds : box in the space of the entry
+         */
+        void setBounds(u32 index, AABB3D const &bounds);
+
+        /**
+         * @brief Link one entry to its matrix in toWorldSpace
+         * @param[in] index : index of the entry
+         * @param[in] slot : index of the matrix in toWorldSpace
+         */
+        inline void setSlot(u32 index, u32 slot) {mSlot[index] = slot;}
+
+        /**
+         * @brief Compute world matrices of entries edited since the last call, and boxes of entries which own one
+         */
+        void update(void);
+
+        /**
+         * @brief Get the entries whose world matrix changed since the last clearChanged
+         * @return indices, each one once
+         */
+        inline std::vector<u32> const &changed(void) const {return mChanged;}
+
+        /**
+         * @brief Forget the entries changed, once they are uploaded
+         */
+        void clearChanged(void);
+
+        inline glm::mat4 const &local(u32 index) const {return mLocal[index];}
+        inline glm::mat4 const &world(u32 index) const {return mWorld[index];}
+        inline float localScaleFactor(u32 index) const {return mLocalScale[index];}
+        inline float worldScaleFactor(u32 index) const {return mWorldScale[index];}
+        inline u32 slot(u32 index) const {return mSlot[index];}
+        inline bool hasBounds(u32 index) const {return mHasBounds[index] != 0;}
+        inline u32 size(void) const {return mParent.size();}
+
+        /**
+         * @brief Get the bounding box in the world, up to date after update
+         *
+         * The first call after update merges boxes of all Nodes
+         * @param[in] index : index of the entry
+         * @return the box
+         */
+        AABB3D bounds(u32 index);
+
+        /**
+         * @brief Get the bounding box in the world of an entry which owns one, without merging boxes of Nodes
+         * @param[in] index : index of the entry
+         * @return the box, up to date after update
+         */
+        AABB3D ownBounds(u32 index) const;
+
+    private:
+        std::vector<u32> mParent; //!< Index of the parent, always lower than the index of the entry
+        std::vector<glm::mat4> mLocal; //!< Matrix relative to the parent
+        std::vector<glm::mat4> mWorld; //!< Matrix in the world
+        std::vector<float> mLocalScale; //!< Scale factor relative to the parent
+        std::vector<float> mWorldScale; //!< Scale factor in the world
+        std::vector<u8> mDirty; //!< Local matrix changed, or world matrix changed during update
+        std::vector<u8> mHasBounds; //!< The entry has its own box
+        std::vector<AABB3D> mLocalBounds; //!< Its own box, in the space of the entry
+        std::vector<glm::vec3> mMin; //!< Corner min of the box in the world
+        std::vector<glm::vec3> mMax; //!< Corner max of the box in the world
+        std::vector<u32> mSlot; //!< Index in toWorldSpace, NO_SLOT if not drawn
+        std::vector<u8> mIsChanged; //!< The entry is in mChanged
+        std::vector<u32> mChanged; //!< Entries changed since the last clearChanged
+        bool mAnyDirty; //!< One entry at least is dirty
+        bool mBoundsDirty; //!< Boxes of Nodes have to be merged again
+
+        /**
+         * @brief Merge boxes of children in boxes of Nodes, from the last entry to the first
+         */
+        void mPropagateBounds(void);
+    };
+}
+
+#endif // TRANSFORMHIERARCHY_H
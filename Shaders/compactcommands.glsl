@@ -0,0 +1,92 @@
+#version 440 core
+
+// Uniform
+#define FRUSTRUM 1
+
+// Shader Storage
+#define COMMAND 0
+#define COMMAND_OCCLUSION 10
+#define DRAW_COUNT 11
+#define COMMAND_COMPACT 12
+#define INSTANCE_COUNT 15
+
+// Culling phases, see CullingPhase
+#define CULLING_FRUSTRUM 0
+#define CULLING_LAST_VISIBLE 1
+#define CULLING_OCCLUSION 2
+
+// One invocation for each command, after matrixculling.glsl
+layout(local_size_x = 64) in;
+
+uniform int phase;
+
+layout(binding = FRUSTRUM, shared) uniform FrustrumBuffer
+{
+    mat4 frustrumMatrix; //!< Is the projectionMatrix product viewMatrix
+    vec4 posCamera; //!< .xyz = posCamera or PosLight for shadowMaps for example
+    vec4 planesFrustrum[6];
+    uvec4 numberMeshesPointLights; //!< numberCommands : .x, numberPointLights : .y, numberInstances : .z
+};
+
+struct DrawElementCommand
+{
+    uint count; //!< Number of index taken on the IndexBuffer
+    uint primCount; //!< Number of instances
+    uint firstIndex; //!< first Index if big IndexBuffer
+    uint baseVertex; //!< first Vertex if big VertexBuffer
+    uint baseInstance; //!< first Instance of this command in the instance Buffers
+};
+
+layout(binding = COMMAND, shared) readonly buffer CommandBuffer
+{
+    DrawElementCommand command[];
+};
+
+layout(binding = INSTANCE_COUNT, shared) readonly buffer InstanceCountBuffer
+{
+    uvec2 instanceCount[]; //!< Instances which survive the first phase : .x, the occlusion phase : .y
+};
+
+layout(binding = COMMAND_COMPACT, shared) writeonly buffer CommandCompactBuffer
+{
+    DrawElementCommand commandCompact[]; //!< Commands drawn by the first phase
+};
+
+layout(binding = COMMAND_OCCLUSION, shared) writeonly buffer CommandOcclusionBuffer
+{
+    DrawElementCommand commandOcclusion[]; //!< Commands of instances found visible by the occlusion phase
+};
+
+layout(binding = DRAW_COUNT, shared) buffer DrawCountBuffer
+{
+    uint numberCompact; //!< Commands in commandCompact
+    uint numberOcclusion; //!< Commands in commandOcclusion
+};
+
+void main(void)
+{
+    uint id = gl_GlobalInvocationID.x;
+
+    if(id >= numberMeshesPointLights.x)
+        return;
+
+    DrawElementCommand compact = command[id];
+
+    // The vertex shader reads visibleInstance[baseInstance + gl_InstanceID]
+    if(phase == CULLING_OCCLUSION)
+    {
+        compact.primCount = instanceCount[id].y;
+        compact.baseInstance += instanceCount[id].x;
+
+        if(compact.primCount > 0)
+            commandOcclusion[atomicAdd(numberOcclusion, 1)] = compact;
+    }
+
+    else
+    {
+        compact.primCount = instanceCount[id].x;
+
+        if(compact.primCount > 0)
+            commandCompact[atomicAdd(numberCompact, 1)] = compact;
+    }
+}
@@ -14,6 +14,7 @@
 #define PROJECT_LIGHT 5
 #define POINT_LIGHT 6
 #define WORLD_POINT_LIGHT 7
+#define VISIBLE_INSTANCE 13
 
 layout(location = 0) in vec3 inPos;
 
@@ -30,6 +31,11 @@ layout(binding = CLIP, shared) readonly buffer ClipSpaceBuffer
     mat4 toClipSpace[];
 };
 
+layout(binding = VISIBLE_INSTANCE, shared) readonly buffer VisibleInstanceBuffer
+{
+    uint visibleInstance[]; //!< Matrix of each instance which survives the culling pass
+};
+
 layout(binding = WORLD, shared) readonly buffer WorldSpaceBuffer
 {
     mat4 toWorldSpace[];
@@ -42,11 +48,14 @@ flat out int materialIndex;
 
 void main(void)
 {
+    // Instances which survive the culling pass are packed from baseInstance
+    uint transform = visibleInstance[gl_BaseInstanceARB + gl_InstanceID];
+
     materialIndex = inMaterialIndex;
     texCoord = inTexCoord;
-    mat3 normalMatrix = transpose(inverse(mat3(toWorldSpace[gl_DrawIDARB])));
+    mat3 normalMatrix = transpose(inverse(mat3(toWorldSpace[transform])));
     normal = normalMatrix * inNormal;
 
-    position = (toWorldSpace[gl_DrawIDARB] * vec4(inPos, 1.0)).xyz;
-    gl_Position = toClipSpace[gl_DrawIDARB] * vec4(inPos, 1.0);
+    position = (toWorldSpace[transform] * vec4(inPos, 1.0)).xyz;
+    gl_Position = toClipSpace[transform] * vec4(inPos, 1.0);
 }
@@ -0,0 +1,41 @@
+#version 440 core
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// Level 0 is read from the depth buffer, others from the previous level
+layout(binding = 0) uniform sampler2D depthSampler;
+layout(binding = 0, r32f) readonly uniform image2D previousLevel;
+layout(binding = 1, r32f) writeonly uniform image2D currentLevel;
+
+uniform int level;
+
+void main(void)
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+
+    if(any(greaterThanEqual(texel, imageSize(currentLevel))))
+        return;
+
+    ivec2 source = texel * 2;
+    vec4 depths;
+
+    if(level == 0)
+    {
+        depths.x = texelFetch(depthSampler, source, 0).x;
+        depths.y = texelFetch(depthSampler, source + ivec2(1, 0), 0).x;
+        depths.z = texelFetch(depthSampler, source + ivec2(0, 1), 0).x;
+        depths.w = texelFetch(depthSampler, source + ivec2(1, 1), 0).x;
+    }
+
+    // Texels outside of the previous level are read as 0 and don't change the max
+    else
+    {
+        depths.x = imageLoad(previousLevel, source).x;
+        depths.y = imageLoad(previousLevel, source + ivec2(1, 0)).x;
+        depths.z = imageLoad(previousLevel, source + ivec2(0, 1)).x;
+        depths.w = imageLoad(previousLevel, source + ivec2(1, 1)).x;
+    }
+
+    // Keep the farthest depth : a box behind it is hidden for sure
+    imageStore(currentLevel, texel, vec4(max(max(depths.x, depths.y), max(depths.z, depths.w))));
+}
@@ -13,32 +13,87 @@
 #define PROJECT_LIGHT 5
 #define POINT_LIGHT 6
 #define WORLD_POINT_LIGHT 7
+#define VISIBILITY 9
+#define VISIBLE_INSTANCE 13
+#define INSTANCE 14
+#define INSTANCE_COUNT 15
+#define CLUSTER_CONE 17
+#define CLUSTER_LOD 18
+#define HLOD_SWITCH 19
 
+// Culling phases, see CullingPhase
+#define CULLING_FRUSTRUM 0
+#define CULLING_LAST_VISIBLE 1
+#define CULLING_OCCLUSION 2
+
+// Proxies of subtrees, see HlodSwitch
+#define NO_HLOD 0xFFFFFFFFu
+#define HLOD_PROXY 0x80000000u
+
+// Bits of visibility
+#define VISIBLE_LAST_FRAME 1
+#define DRAWN_FIRST_PHASE 2
+
+// One invocation for each instance of each cluster
 layout(local_size_x = 64) in;
 
+uniform int phase;
+uniform float minPixelSize; //!< Clusters smaller on the screen are culled, 0 to disable
+uniform int backfaceCulling; //!< Clusters which only have back faces are culled
+uniform float lodBias; //!< Levels of detail are chosen as if meshes were 2^lodBias times smaller
+uniform vec2 viewportSize; //!< In pixels
+
+layout(binding = 0) uniform sampler2D hiZSampler;
+
 layout(binding = FRUSTRUM, shared) uniform FrustrumBuffer
 {
     mat4 frustrumMatrix; //!< Is the projectionMatrix product viewMatrix
     vec4 posCamera; //!< .xyz = posCamera or PosLight for shadowMaps for example
     vec4 planesFrustrum[6];
-    uvec4 numberMeshesPointLights; //!< NumberMeshed : .x, .y = NumberPointLights
+    uvec4 numberMeshesPointLights; //!< numberCommands : .x, numberPointLights : .y, numberInstances : .z
 };
 
 struct DrawElementCommand
 {
     uint count; //!< Number of index taken on the IndexBuffer
-    uint primCount; //!< Number of instance : 1 in our engine
+    uint primCount; //!< Number of instances
     uint firstIndex; //!< first Index if big IndexBuffer
     uint baseVertex; //!< first Vertex if big VertexBuffer
-    uint baseInstance; //!< first Instance if several Instances : 0 in our engine
+    uint baseInstance; //!< first Instance of this command in the instance Buffers
+};
+
+struct DrawInstance
+{
+    uint command; //!< Index of the DrawElementCommand
+    uint transform; //!< Index of the matrix in toWorldSpace
+    uint hlod; //!< HlodSwitch which draws it near, or far with HLOD_PROXY, NO_HLOD if none
+};
+
+struct HlodSwitch
+{
+    vec4 centerDistance; //!< Center of the subtree in the space of the proxy : .xyz, distance from which the proxy is drawn : .w
+    uvec4 transformParent; //!< Matrix of the proxy : .x, NO_HLOD if not baked ; HlodSwitch above : .y
 };
 
 struct AABB3D
 {
-    vec4 coord[8]; //!< One box own 8 vertex
+    vec4 center; //!< .w = 1
+    vec4 extent; //!< Half size, .w = 0
+};
+
+struct ClusterCone
+{
+    vec4 centerRadius; //!< Bounding sphere
+    vec4 axisCutoff; //!< Mean normal : .xyz, sine of the half angle : .w, 1 if it can't be culled
 };
 
-layout(binding = COMMAND, shared) writeonly buffer CommandBuffer
+struct ClusterLod
+{
+    vec4 meshCenter; //!< Center of the box of the mesh : .xyz, minSize : .w
+    vec4 meshExtent; //!< Half size of the box of the mesh : .xyz, maxSize : .w, negative for the finest level
+};
+
+layout(binding = COMMAND, shared) readonly buffer CommandBuffer
 {
     DrawElementCommand command[];
 };
@@ -53,42 +108,241 @@ layout(binding = WORLD, shared) readonly buffer WorldSpaceBuffer
     mat4 toWorldSpace[];
 };
 
-layout(binding = AABB, shared) buffer AABBBuffer
+layout(binding = AABB, shared) readonly buffer AABBBuffer
 {
     AABB3D box[];
 };
 
+layout(binding = CLUSTER_CONE, shared) readonly buffer ClusterConeBuffer
+{
+    ClusterCone cone[];
+};
+
+layout(binding = CLUSTER_LOD, shared) readonly buffer ClusterLodBuffer
+{
+    ClusterLod lod[];
+};
+
+layout(binding = HLOD_SWITCH, shared) readonly buffer HlodSwitchBuffer
+{
+    HlodSwitch hlodSwitch[];
+};
+
+layout(binding = INSTANCE, shared) readonly buffer InstanceBuffer
+{
+    DrawInstance instance[];
+};
+
+layout(binding = VISIBILITY, shared) buffer VisibilityBuffer
+{
+    uint visibility[]; //!< VISIBLE_LAST_FRAME and DRAWN_FIRST_PHASE for each instance
+};
+
+layout(binding = VISIBLE_INSTANCE, shared) writeonly buffer VisibleInstanceBuffer
+{
+    uint visibleInstance[]; //!< Matrices of instances which survive, packed from baseInstance of their command
+};
+
+layout(binding = INSTANCE_COUNT, shared) buffer InstanceCountBuffer
+{
+    uvec2 instanceCount[]; //!< Instances which survive the first phase : .x, the occlusion phase : .y
+};
+
+// The corner the farthest along the normal is outside : the box is outside
+bool isInFrustrum(vec3 center, vec3 extent)
+{
+    for(uint i = 0; i < 6; ++i)
+    {
+        vec4 plane = planesFrustrum[i];
+
+        if(dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extent) <= 0.0)
+            return false;
+    }
+
+    return true;
+}
+
+// Return false if the box crosses the near plane
+bool projectBox(vec3 center, vec3 extent, out vec3 minNDC, out vec3 maxNDC)
+{
+    minNDC = vec3(1.0);
+    maxNDC = vec3(-1.0);
+
+    // Corners in clip space are the projected center plus or minus the projected axes
+    vec4 clipCenter = frustrumMatrix * vec4(center, 1.0);
+    vec4 axisX = frustrumMatrix[0] * extent.x;
+    vec4 axisY = frustrumMatrix[1] * extent.y;
+    vec4 axisZ = frustrumMatrix[2] * extent.z;
+
+    for(uint i = 0; i < 8; ++i)
+    {
+        vec4 clip = clipCenter + (((i & 1) != 0) ? axisX : -axisX)
+                               + (((i & 2) != 0) ? axisY : -axisY)
+                               + (((i & 4) != 0) ? axisZ : -axisZ);
+
+        if(clip.w <= 0.0)
+            return false;
+
+        minNDC = min(minNDC, clip.xyz / clip.w);
+        maxNDC = max(maxNDC, clip.xyz / clip.w);
+    }
+
+    return true;
+}
+
+// All normals of the cluster look away from the camera, seen from anywhere in its sphere
+bool isBackFacing(ClusterCone localCone, mat4 toWorld)
+{
+    mat3 linear = mat3(toWorld);
+    vec3 scale = vec3(length(linear[0]), length(linear[1]), length(linear[2]));
+
+    // A non uniform scale does not keep the cone
+    if(localCone.axisCutoff.w >= 1.0 || max(max(scale.x, scale.y), scale.z) > 1.01 * min(min(scale.x, scale.y), scale.z))
+        return false;
+
+    // A mirror flips the winding, so the front faces
+    vec3 axis = normalize(linear * localCone.axisCutoff.xyz) * sign(determinant(linear));
+    vec3 center = (toWorld * vec4(localCone.centerRadius.xyz, 1.0)).xyz;
+    vec3 view = center - posCamera.xyz;
+
+    return dot(view, axis) >= localCone.axisCutoff.w * length(view) + localCone.centerRadius.w * scale.x;
+}
+
+// The size of the whole mesh chooses the level : all its clusters switch together
+bool isLodSelected(ClusterLod localLod, mat4 toWorld)
+{
+    vec3 center = (toWorld * vec4(localLod.meshCenter.xyz, 1.0)).xyz;
+    vec3 extent = abs(toWorld[0].xyz) * localLod.meshExtent.x +
+                  abs(toWorld[1].xyz) * localLod.meshExtent.y +
+                  abs(toWorld[2].xyz) * localLod.meshExtent.z;
+    vec3 minNDC, maxNDC;
+
+    // The camera is next to the mesh : the finest level
+    if(!projectBox(center, extent, minNDC, maxNDC))
+        return localLod.meshExtent.w < 0.0;
+
+    vec2 size = (maxNDC.xy - minNDC.xy) * 0.5 * viewportSize * exp2(-lodBias);
+    float pixels = max(size.x, size.y);
+
+    return pixels >= localLod.meshCenter.w && (localLod.meshExtent.w < 0.0 || pixels < localLod.meshExtent.w);
+}
+
+// Without proxy baked, the subtree is never far
+bool isFar(HlodSwitch current)
+{
+    if(current.transformParent.x == NO_HLOD)
+        return false;
+
+    vec3 center = (toWorldSpace[current.transformParent.x] * vec4(current.centerDistance.xyz, 1.0)).xyz;
+
+    return distance(center, posCamera.xyz) >= current.centerDistance.w;
+}
+
+// The subtree is drawn near its switch and the proxy far, only if all switches above are near
+bool isHlodSelected(uint hlod)
+{
+    if(hlod == NO_HLOD)
+        return true;
+
+    uint index = hlod & ~HLOD_PROXY;
+
+    if(isFar(hlodSwitch[index]) != ((hlod & HLOD_PROXY) != 0))
+        return false;
+
+    for(index = hlodSwitch[index].transformParent.y; index != NO_HLOD; index = hlodSwitch[index].transformParent.y)
+        if(isFar(hlodSwitch[index]))
+            return false;
+
+    return true;
+}
+
+bool isTooSmall(vec3 minNDC, vec3 maxNDC)
+{
+    vec2 size = (maxNDC.xy - minNDC.xy) * 0.5 * viewportSize;
+
+    return max(size.x, size.y) < minPixelSize;
+}
+
+bool isOccluded(vec3 minNDC, vec3 maxNDC)
+{
+    vec2 minUV = clamp(minNDC.xy * 0.5 + 0.5, 0.0, 1.0);
+    vec2 maxUV = clamp(maxNDC.xy * 0.5 + 0.5, 0.0, 1.0);
+    float nearestDepth = minNDC.z * 0.5 + 0.5;
+
+    // Choose the level where the box covers at most 2x2 texels
+    vec2 extent = (maxUV - minUV) * vec2(textureSize(hiZSampler, 0));
+    int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, textureQueryLevels(hiZSampler) - 1);
+    ivec2 size = textureSize(hiZSampler, level);
+
+    ivec2 minTexel = min(ivec2(minUV * vec2(size)), size - 1);
+    ivec2 maxTexel = min(ivec2(maxUV * vec2(size)), size - 1);
+
+    float farthestDepth = max(max(texelFetch(hiZSampler, minTexel, level).x,
+                                  texelFetch(hiZSampler, ivec2(maxTexel.x, minTexel.y), level).x),
+                              max(texelFetch(hiZSampler, ivec2(minTexel.x, maxTexel.y), level).x,
+                                  texelFetch(hiZSampler, maxTexel, level).x));
+
+    return nearestDepth > farthestDepth;
+}
+
 void main(void)
 {
-    if(gl_GlobalInvocationID.x < numberMeshesPointLights.x)
+    uint id = gl_GlobalInvocationID.x;
+
+    if(id >= numberMeshesPointLights.z)
+        return;
+
+    DrawInstance current = instance[id];
+    mat4 toWorld = toWorldSpace[current.transform];
+
+    AABB3D localBox = box[current.command];
+    vec3 minNDC, maxNDC;
+
+    // Only the center is transformed, the extent is the sum of the absolute axes (Arvo)
+    vec3 center = (toWorld * localBox.center).xyz;
+    vec3 extent = abs(toWorld[0].xyz) * localBox.extent.x +
+                  abs(toWorld[1].xyz) * localBox.extent.y +
+                  abs(toWorld[2].xyz) * localBox.extent.z;
+
+    bool visible = isHlodSelected(current.hlod) && isInFrustrum(center, extent);
+
+    if(visible)
+        visible = isLodSelected(lod[current.command], toWorld);
+
+    if(visible && backfaceCulling != 0)
+        visible = !isBackFacing(cone[current.command], toWorld);
+
+    bool inFront = projectBox(center, extent, minNDC, maxNDC);
+
+    if(visible && inFront && minPixelSize > 0.0)
+        visible = !isTooSmall(minNDC, maxNDC);
+
+    uint base = command[current.command].baseInstance;
+
+    // Second phase : test against the Hi-Z built from instances drawn by the first phase
+    if(phase == CULLING_OCCLUSION)
     {
-        AABB3D newBox;
-
-        toClipSpace[gl_GlobalInvocationID.x] = frustrumMatrix * toWorldSpace[gl_GlobalInvocationID.x];
-
-        for(uint i = 0; i < 8; ++i)
-            newBox.coord[i] = toWorldSpace[gl_GlobalInvocationID.x] * box[gl_GlobalInvocationID.x].coord[i];
-
-        for(uint i = 0; i < 6; ++i)
-        {
-            bool isIn = false;
-
-            for(uint j = 0; j < 8 && !isIn; ++j)
-            {
-                if(dot(planesFrustrum[i], newBox.coord[j]) > 0.0)
-                {
-                    isIn = true;
-                    break;
-                }
-            }
-
-            if(!isIn)
-            {
-                command[gl_GlobalInvocationID.x].primCount = 0;
-                return;
-            }
-        }
-
-        command[gl_GlobalInvocationID.x].primCount = 1;
+        if(visible && inFront)
+            visible = !isOccluded(minNDC, maxNDC);
+
+        // Instances of the first phase are already in the depth buffer, the new ones go after them
+        if(visible && (visibility[id] & DRAWN_FIRST_PHASE) == 0)
+            visibleInstance[base + instanceCount[current.command].x + atomicAdd(instanceCount[current.command].y, 1)] = current.transform;
+
+        visibility[id] = visible ? VISIBLE_LAST_FRAME : 0;
+        return;
+    }
+
+    // All clusters of one Model write the same matrix
+    toClipSpace[current.transform] = frustrumMatrix * toWorld;
+
+    // First phase : only instances visible last frame
+    if(phase == CULLING_LAST_VISIBLE)
+    {
+        visible = visible && (visibility[id] & VISIBLE_LAST_FRAME) != 0;
+        visibility[id] = (visibility[id] & VISIBLE_LAST_FRAME) | (visible ? DRAWN_FIRST_PHASE : 0);
     }
+
+    if(visible)
+        visibleInstance[base + atomicAdd(instanceCount[current.command].x, 1)] = current.transform;
 }
@@ -14,12 +14,19 @@
 #define PROJECT_LIGHT 5
 #define POINT_LIGHT 6
 #define WORLD_POINT_LIGHT 7
+#define VISIBLE_INSTANCE 13
 
 layout(location = 0) in vec3 inPos;
 
+#ifdef COMPACT_VERTEX
+layout(location = 1) in vec2 inNormal; // Octahedral
+layout(location = 2) in vec2 inTangent; // Octahedral
+layout(location = 3) in float inBiTangentSign;
+#else
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec3 inTangent;
 layout(location = 3) in vec3 inBiTangent;
+#endif
 
 layout(location = 4) in vec2 inTexCoord;
 
@@ -30,6 +37,11 @@ layout(binding = CLIP, shared) readonly buffer ClipSpaceBuffer
     mat4 toClipSpace[];
 };
 
+layout(binding = VISIBLE_INSTANCE, shared) readonly buffer VisibleInstanceBuffer
+{
+    uint visibleInstance[]; //!< Matrix of each instance which survives the culling pass
+};
+
 layout(binding = WORLD, shared) readonly buffer WorldSpaceBuffer
 {
     mat4 toWorldSpace[];
@@ -46,15 +58,39 @@ out vec2 texCoord;
 
 flat out int materialIndex;
 
+#ifdef COMPACT_VERTEX
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+
+    // Lower half was folded over the diagonals
+    if(n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(n.xy, vec2(0.0)));
+
+    return normalize(n);
+}
+#endif
+
 void main(void)
 {
+    // Instances which survive the culling pass are packed from baseInstance
+    uint transform = visibleInstance[gl_BaseInstanceARB + gl_InstanceID];
+
     materialIndex = inMaterialIndex;
     texCoord = inTexCoord;
-    mat3 normalMatrix = transpose(inverse(mat3(toWorldSpace[gl_DrawIDARB])));
+    mat3 normalMatrix = transpose(inverse(mat3(toWorldSpace[transform])));
+#ifdef COMPACT_VERTEX
+    vec3 vertexNormal = decodeOctahedral(inNormal);
+    vec3 vertexTangent = decodeOctahedral(inTangent);
+    normal = normalMatrix * vertexNormal;
+    tangent = normalMatrix * vertexTangent;
+    biTangent = normalMatrix * (cross(vertexNormal, vertexTangent) * sign(inBiTangentSign));
+#else
     normal = normalMatrix * inNormal;
     tangent = normalMatrix * inTangent;
     biTangent = normalMatrix * inBiTangent;
+#endif
 
-    position = (toWorldSpace[gl_DrawIDARB] * vec4(inPos, 1.0)).xyz;
-    gl_Position = toClipSpace[gl_DrawIDARB] * vec4(inPos, 1.0);
+    position = (toWorldSpace[transform] * vec4(inPos, 1.0)).xyz;
+    gl_Position = toClipSpace[transform] * vec4(inPos, 1.0);
 }
@@ -14,6 +14,7 @@
 #define PROJECT_LIGHT 5
 #define POINT_LIGHT 6
 #define WORLD_POINT_LIGHT 7
+#define VISIBLE_INSTANCE 13
 
 layout(location = 0) in vec3 inPos;
 
@@ -24,6 +25,11 @@ layout(binding = CLIP, shared) readonly buffer ClipSpaceBuffer
     mat4 toClipSpace[];
 };
 
+layout(binding = VISIBLE_INSTANCE, shared) readonly buffer VisibleInstanceBuffer
+{
+    uint visibleInstance[]; //!< Matrix of each instance which survives the culling pass
+};
+
 layout(binding = WORLD, shared) readonly buffer WorldSpaceBuffer
 {
     mat4 toWorldSpace[];
@@ -31,6 +37,9 @@ layout(binding = WORLD, shared) readonly buffer WorldSpaceBuffer
 
 void main(void)
 {
-    position = (toWorldSpace[gl_DrawIDARB] * vec4(inPos, 1.0)).xyz;
-    gl_Position = toClipSpace[gl_DrawIDARB] * vec4(inPos, 1.0);
+    // Instances which survive the culling pass are packed from baseInstance
+    uint transform = visibleInstance[gl_BaseInstanceARB + gl_InstanceID];
+
+    position = (toWorldSpace[transform] * vec4(inPos, 1.0)).xyz;
+    gl_Position = toClipSpace[transform] * vec4(inPos, 1.0);
 }
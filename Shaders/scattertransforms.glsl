@@ -0,0 +1,39 @@
+#version 440 core
+
+// Shader Storage
+#define WORLD 2
+#define TRANSFORM_UPDATE 16
+
+// One invocation for each matrix changed since the last upload
+layout(local_size_x = 64) in;
+
+uniform int firstUpdate; //!< First update of this upload in the region
+uniform int numberUpdates; //!< Number of updates of this upload
+
+struct TransformUpdate
+{
+    mat4 toWorldSpace; //!< World Matrix
+    uvec4 slot; //!< Index of the matrix in toWorldSpace : .x
+};
+
+layout(binding = WORLD, shared) writeonly buffer WorldMatrixBuffer
+{
+    mat4 toWorldSpace[];
+};
+
+layout(binding = TRANSFORM_UPDATE, shared) readonly buffer TransformUpdateBuffer
+{
+    TransformUpdate transformUpdate[];
+};
+
+void main(void)
+{
+    uint id = gl_GlobalInvocationID.x;
+
+    if(id >= uint(numberUpdates))
+        return;
+
+    TransformUpdate update = transformUpdate[uint(firstUpdate) + id];
+
+    toWorldSpace[update.slot.x] = update.toWorldSpace;
+}
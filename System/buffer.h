@@ -40,6 +40,7 @@
 
 #include "../include/include.h"
 #include "../include/constant.h"
+#include "../Debug/cpuprofiler.h"
 
 namespace GXY
 {
@@ -74,7 +75,20 @@ namespace GXY
         /**
          * @brief Buffer Constructor
          */
-        Buffer(void) : mId(0), mPtr(nullptr), mNumElementsMax(0), mNumElements(0){}
+        Buffer(void) : mId(0), mPtr(nullptr), mNumElementsMax(0), mNumElements(0),
+                       mNumRegions(1), mRegion(0), mRegionSize(0){}
+
+        /**
+         * @brief Buffer Constructor for a ring Buffer
+         *
+         * The storage is split in numRegions regions of the same size, one per frame in flight.
+         * Each region is protected by its own fence, so the CPU can fill one region while
+         * the GPU still reads the other ones.
+         * @param[in] numRegions : Number of regions (FRAMES_IN_FLIGHT in general)
+         */
+        explicit Buffer(u32 numRegions) : mId(0), mPtr(nullptr), mNumElementsMax(0), mNumElements(0),
+                                          mNumRegions(std::max(numRegions, 1u)), mRegion(0), mRegionSize(0),
+                                          mFences(mNumRegions, nullptr){}
 
         /**
          * @brief Buffer Constructor move semantic
@@ -86,8 +100,14 @@ namespace GXY
             mPtr = std::move(buffer.mPtr);
             mNumElementsMax = std::move(buffer.mNumElementsMax);
             mNumElements = std::move(buffer.mNumElements);
+            mNumRegions = std::move(buffer.mNumRegions);
+            mRegion = std::move(buffer.mRegion);
+            mRegionSize = std::move(buffer.mRegionSize);
+            mFences = std::move(buffer.mFences);
+            mBindings = std::move(buffer.mBindings);
 
             buffer.mId = buffer.mNumElementsMax = buffer.mNumElements = 0;
+            buffer.mRegion = buffer.mRegionSize = 0;
             buffer.mPtr = nullptr;
         }
 
@@ -102,8 +122,14 @@ namespace GXY
             mPtr = std::move(buffer.mPtr);
             mNumElementsMax = std::move(buffer.mNumElementsMax);
             mNumElements = std::move(buffer.mNumElements);
+            mNumRegions = std::move(buffer.mNumRegions);
+            mRegion = std::move(buffer.mRegion);
+            mRegionSize = std::move(buffer.mRegionSize);
+            mFences = std::move(buffer.mFences);
+            mBindings = std::move(buffer.mBindings);
 
             buffer.mId = buffer.mNumElementsMax = buffer.mNumElements = 0;
+            buffer.mRegion = buffer.mRegionSize = 0;
             buffer.mPtr = nullptr;
 
             return *this;
@@ -114,6 +140,8 @@ namespace GXY
 
         /**
          * @brief Allocate nElements in video Memory
+         *
+         * For a ring Buffer, nElements are allocated for each region
          * @param[in] nElements : Number of elements
          */
         inline void allocate(size_t nElements)
@@ -121,10 +149,12 @@ namespace GXY
             destroy();
             glGenBuffers(1, &mId);
 
-            u32 flags = GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT;
+            u32 flags = mFlags();
+
+            mRegionSize = mComputeRegionSize(nElements);
 
-            glNamedBufferStorageEXT(mId, nElements * sizeof(T), nullptr, flags);
-            mPtr = (T*)glMapNamedBufferRangeEXT(mId, 0, nElements * sizeof(T), flags);
+            glNamedBufferStorageEXT(mId, mRegionSize * mNumRegions, nullptr, flags);
+            mPtr = (T*)glMapNamedBufferRangeEXT(mId, 0, mRegionSize * mNumRegions, flags);
             mNumElementsMax = nElements;
         }
 
@@ -133,26 +163,76 @@ namespace GXY
          */
         inline void reallocate(void)
         {
-            u32 flags = GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT;
+            u32 flags = mFlags();
             u32 newBuffer;
 
+            GXY_COUNTER("bufferReallocations", 1);
+
             if(mNumElementsMax == 0)
                 allocate(1);
 
             // Allocate a new Buffer, copy actually in new buffer, delete actualy
             else
             {
+                // The GPU could still read others regions, we can't destroy them under its feet
+                if(mNumRegions > 1)
+                    mWaitAllRegions();
+
+                size_t oldRegionSize = mRegionSize;
+                size_t oldNumElementsMax = mNumElementsMax;
+
                 mNumElementsMax *= 2;
+                mRegionSize = mComputeRegionSize(mNumElementsMax);
 
                 glGenBuffers(1, &newBuffer);
-                glNamedBufferStorageEXT(newBuffer, mNumElementsMax * sizeof(T), nullptr, flags);
-                mPtr = (T*)glMapNamedBufferRangeEXT(newBuffer, 0, mNumElementsMax * sizeof(T), flags);
-                glNamedCopyBufferSubDataEXT(mId, newBuffer, 0, 0, (mNumElementsMax / 2) * sizeof(T));
+                glNamedBufferStorageEXT(newBuffer, mRegionSize * mNumRegions, nullptr, flags);
+                mPtr = (T*)glMapNamedBufferRangeEXT(newBuffer, 0, mRegionSize * mNumRegions, flags);
+
+                // Only the current region owns data which are still useful
+                glNamedCopyBufferSubDataEXT(mId, newBuffer, mRegion * oldRegionSize, mRegion * mRegionSize,
+                                            oldNumElementsMax * sizeof(T));
                 glDeleteBuffers(1, &mId);
                 mId = newBuffer;
+
+                for(auto const &binding : mBindings)
+                    mBindRegion(binding.first, binding.second);
             }
         }
 
+        /**
+         * @brief Put a fence after the last command which use the current region
+         *
+         * Does nothing if it is not a ring Buffer
+         */
+        inline void lockRegion(void)
+        {
+            if(mNumRegions == 1)
+                return;
+
+            if(mFences[mRegion] != nullptr)
+                glDeleteSync(mFences[mRegion]);
+
+            mFences[mRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+
+        /**
+         * @brief Go on the next region, and wait only if the GPU is still using it
+         *
+         * The number of elements is not reset, use setToZeroElement for that.
+         * All binding points given by bindBase are updated on the new region
+         */
+        inline void nextRegion(void)
+        {
+            if(mNumRegions == 1)
+                return;
+
+            mRegion = (mRegion + 1) % mNumRegions;
+            mWaitRegion(mRegion);
+
+            for(auto const &binding : mBindings)
+                mBindRegion(binding.first, binding.second);
+        }
+
         /**
          * @brief Copy one Buffer in another one
          * @param[in] buffer : Source Buffer
@@ -174,6 +254,14 @@ namespace GXY
             glBindBuffer(type, mId);
         }
 
+        /**
+         * @brief Fill the current region with 0 on the GPU, without waiting for it
+         */
+        inline void clear(void)
+        {
+            glClearNamedBufferSubDataEXT(mId, GL_R8UI, regionOffset(), mRegionSize, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+        }
+
         /**
          * @brief Bind the Buffer to one indexed Buffer target
          * @param[in] type : BufferType of this Buffer : UNIFORM SHADER_STORAGE ATOMIC
@@ -181,7 +269,19 @@ namespace GXY
          */
         inline void bindBase(BufferType type, u32 binding)
         {
-            glBindBufferBase(type, binding, mId);
+            if(mNumRegions == 1)
+            {
+                glBindBufferBase(type, binding, mId);
+                return;
+            }
+
+            // Remember it to follow the current region
+            auto it = std::find(mBindings.begin(), mBindings.end(), std::make_pair(type, binding));
+
+            if(it == mBindings.end())
+                mBindings.emplace_back(type, binding);
+
+            mBindRegion(type, binding);
         }
 
         /**
@@ -197,7 +297,30 @@ namespace GXY
                 reallocate();
             }
 
-            mPtr[mNumElements++] = elem;
+            map()[mNumElements++] = elem;
+        }
+
+        /**
+         * @brief Push nElements at once, they are written afterwards through the pointer returned
+         *
+         * The pointer is valid until the next reallocation, several threads can write
+         * in different elements
+         * @param[in] nElements : Number of elements
+         * @param[out] isReallocate : If is reallocate : put it to true, else don't change
+         * @return Pointer on the first element pushed
+         */
+        inline T *append(size_t nElements, bool &isReallocate)
+        {
+            while(mNumElements + nElements > mNumElementsMax)
+            {
+                isReallocate = true;
+                reallocate();
+            }
+
+            T *first = map() + mNumElements;
+            mNumElements += nElements;
+
+            return first;
         }
 
         /**
@@ -216,7 +339,7 @@ namespace GXY
         inline T &operator[](u32 index)
         {
             assert(index < mNumElementsMax);
-            mPtr[index];
+            return map()[index];
         }
 
         /** Bind the buffer range
@@ -228,14 +351,28 @@ namespace GXY
         */
         inline void bindRange(BufferType type, u32 binding, u32 offset, u32 nElements)
         {
-            glBindBufferRange(type, binding, mId, offset * sizeof(T), nElements * sizeof(T));
+            glBindBufferRange(type, binding, mId, regionOffset() + offset * sizeof(T), nElements * sizeof(T));
         }
 
         /**
          * @brief Get a pointer in "unified memory"
          * @return Pointer of start of Buffer
          */
-        inline T *map(void) {return mPtr;}
+        inline T *map(void) {return (T*)((u8*)mPtr + regionOffset());}
+
+        /**
+         * @brief Get the offset in bytes of the current region, 0 if it is not a ring Buffer
+         *
+         * Useful for indirect commands : glMultiDraw*Indirect(..., (void*)buffer.regionOffset(), ...)
+         * @return Offset in bytes
+         */
+        inline size_t regionOffset(void) const {return mRegion * mRegionSize;}
+
+        /**
+         * @brief Get the number of regions
+         * @return 1 if it is not a ring Buffer
+         */
+        inline u32 numRegions(void) const {return mNumRegions;}
 
         /**
          * @brief Get a maximal size of Buffer in number of Elements
@@ -254,6 +391,13 @@ namespace GXY
          */
         inline void destroy(void)
         {
+            for(auto &fence : mFences)
+            {
+                if(fence != nullptr)
+                    glDeleteSync(fence);
+                fence = nullptr;
+            }
+
             if(mId != 0)
             {
                 glDeleteBuffers(1, &mId);
@@ -261,6 +405,8 @@ namespace GXY
                 mPtr = nullptr;
                 mNumElementsMax = 0;
                 mNumElements = 0;
+                mRegion = 0;
+                mRegionSize = 0;
             }
         }
 
@@ -277,6 +423,83 @@ namespace GXY
         T* mPtr; //!< Pointer of start of Unified Memory for this Buffer
         size_t mNumElementsMax; //!< Maximal Size for this Buffer
         size_t mNumElements; //!< Number of elements pushed in this Buffer
+
+        u32 mNumRegions; //!< Number of regions, 1 if it is not a ring Buffer
+        u32 mRegion; //!< Current region
+        size_t mRegionSize; //!< Size of one region in bytes
+        std::vector<GLsync> mFences; //!< One fence per region
+        std::vector<std::pair<BufferType, u32>> mBindings; //!< Binding points which follow the current region
+
+        /**
+         * @brief Flags used for storage and mapping
+         *
+         * A ring Buffer is written while the GPU reads the others regions, so it has to be coherent
+         * @return flags
+         */
+        inline u32 mFlags(void) const
+        {
+            u32 flags = GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT;
+
+            if(mNumRegions > 1)
+                flags |= GL_MAP_COHERENT_BIT;
+
+            return flags;
+        }
+
+        /**
+         * @brief Compute the size of one region aligned for glBindBufferRange
+         * @param[in] nElements : number of elements by region
+         * @return size of one region in bytes
+         */
+        inline size_t mComputeRegionSize(size_t nElements) const
+        {
+            size_t size = nElements * sizeof(T);
+
+            if(mNumRegions == 1)
+                return size;
+
+            s32 uniformAlignment, storageAlignment;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+
+            size_t alignment = std::max(uniformAlignment, storageAlignment);
+
+            return (size + alignment - 1) / alignment * alignment;
+        }
+
+        /**
+         * @brief Bind the current region to one indexed Buffer target
+         * @param[in] type : BufferType of this Buffer : UNIFORM SHADER_STORAGE ATOMIC
+         * @param[in] binding : index of this Buffer (binding point)
+         */
+        inline void mBindRegion(BufferType type, u32 binding)
+        {
+            glBindBufferRange(type, binding, mId, regionOffset(), mNumElementsMax * sizeof(T));
+        }
+
+        /**
+         * @brief Wait for the completion of commands which use one region
+         * @param[in] region : index of the region
+         */
+        inline void mWaitRegion(u32 region)
+        {
+            if(mFences[region] == nullptr)
+                return;
+
+            while(glClientWaitSync(mFences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+
+            glDeleteSync(mFences[region]);
+            mFences[region] = nullptr;
+        }
+
+        /**
+         * @brief Wait for the completion of commands which use all regions
+         */
+        inline void mWaitAllRegions(void)
+        {
+            for(u32 i = 0; i < mNumRegions; ++i)
+                mWaitRegion(i);
+        }
     };
 }
 
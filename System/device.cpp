@@ -10,6 +10,13 @@
 #include "buffer.h"
 #include "shader.h"
 #include "framebuffer.h"
+#include "jobsystem.h"
+#include "../Debug/gpuprofiler.h"
+#include "../Debug/cpuprofiler.h"
+
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
 
 namespace GXY
 {
@@ -94,25 +101,40 @@ namespace GXY
 
     void createGlobalModel(void)
     {
-        global->Model.aabb3D = make_shared<Buffer<AABB3D>>();
-        global->Model.command = make_shared<Buffer<DrawElementCommand>>();
+        global->Model.aabb3D = make_shared<Buffer<AABB3D>>(FRAMES_IN_FLIGHT);
+        global->Model.clusterCone = make_shared<Buffer<ClusterCone>>(FRAMES_IN_FLIGHT);
+        global->Model.clusterLod = make_shared<Buffer<ClusterLod>>(FRAMES_IN_FLIGHT);
+        global->Model.hlodSwitch = make_shared<Buffer<HlodSwitch>>(FRAMES_IN_FLIGHT);
+        global->Model.command = make_shared<Buffer<DrawElementCommand>>(FRAMES_IN_FLIGHT);
+        global->Model.commandOcclusion = make_shared<Buffer<DrawElementCommand>>();
+        global->Model.commandCompact = make_shared<Buffer<DrawElementCommand>>();
+        global->Model.drawCount = make_shared<Buffer<u32>>();
+        global->Model.visibility = make_shared<Buffer<u32>>();
+        global->Model.instance = make_shared<Buffer<DrawInstance>>(FRAMES_IN_FLIGHT);
+        global->Model.instanceCount = make_shared<Buffer<uvec2>>();
+        global->Model.visibleInstance = make_shared<Buffer<u32>>();
         global->Model.index = make_shared<Buffer<u32>>();
         global->Model.material = make_shared<Buffer<Material>>();
         global->Model.toClipSpace = make_shared<Buffer<mat4>>();
         global->Model.toWorldSpace = make_shared<Buffer<mat4>>();
+        global->Model.transformUpdate = make_shared<Buffer<TransformUpdate>>(FRAMES_IN_FLIGHT);
         global->Model.vertex = make_shared<Buffer<Vertex>>();
         global->Model.vertexDepth = make_shared<Buffer<vec3>>();
 
         global->Model.vao = make_shared<VertexArray>();
         global->Model.vaoDepth = make_shared<VertexArray>();
+
+        // Draws of the first phase, then draws of the occlusion phase
+        global->Model.drawCount->allocate(2);
+        global->Model.drawCount->bindBase(SHADER_STORAGE, 11);
     }
 
     void createGlobalLighting(void)
     {
-        global->Lighting.commandPointLights = make_shared<Buffer<DrawArrayCommand>>();
-        global->Lighting.pointLight = make_shared<Buffer<PointLight>>();
+        global->Lighting.commandPointLights = make_shared<Buffer<DrawArrayCommand>>(FRAMES_IN_FLIGHT);
+        global->Lighting.pointLight = make_shared<Buffer<PointLight>>(FRAMES_IN_FLIGHT);
         global->Lighting.quadsPointLights = make_shared<Buffer<vec2>>();
-        global->Lighting.toWorldSpace = make_shared<Buffer<mat4>>();
+        global->Lighting.toWorldSpace = make_shared<Buffer<mat4>>(FRAMES_IN_FLIGHT);
         global->Lighting.vplCounter = make_shared<Buffer<u32>>();
         global->Lighting.vplPointLight = make_shared<Buffer<PointLightVPL>>();
 
@@ -140,7 +162,10 @@ namespace GXY
     void createGlobalShader(void)
     {
         global->Shaders.matrixCulling = make_shared<Shader>();
+        global->Shaders.compactCommands = make_shared<Shader>();
+        global->Shaders.scatterTransforms = make_shared<Shader>();
         global->Shaders.depth = make_shared<Shader>();
+        global->Shaders.hiZ = make_shared<Shader>();
         global->Shaders.model = make_shared<Shader>("Shaders/model.vert", "Shaders/model.frag");
 
         global->Shaders.ambientOcclusion = make_shared<Shader>();
@@ -156,7 +181,10 @@ namespace GXY
         global->Shaders.final = make_shared<Shader>("Shaders/final.vert", "Shaders/final.frag");
 
         global->Shaders.matrixCulling->compileFile("Shaders/matrixculling.glsl", COMPUTE);
+        global->Shaders.compactCommands->compileFile("Shaders/compactcommands.glsl", COMPUTE);
+        global->Shaders.scatterTransforms->compileFile("Shaders/scattertransforms.glsl", COMPUTE);
         global->Shaders.depth->compileFile("Shaders/depth.vert", VERTEX);
+        global->Shaders.hiZ->compileFile("Shaders/hiz.glsl", COMPUTE);
 
         global->Shaders.ambientOcclusion->compileFile("Shaders/ambientocclusion.glsl", COMPUTE);
         global->Shaders.blurHorizontalPass->compileFile("Shaders/blurH.glsl", COMPUTE);
@@ -165,7 +193,10 @@ namespace GXY
         global->Shaders.projectPointLights->compileFile("Shaders/projectpointlight.glsl", COMPUTE);
 
         global->Shaders.matrixCulling->link();
+        global->Shaders.compactCommands->link();
+        global->Shaders.scatterTransforms->link();
         global->Shaders.depth->link();
+        global->Shaders.hiZ->link();
 
         global->Shaders.ambientOcclusion->link();
         global->Shaders.blurHorizontalPass->link();
@@ -180,8 +211,8 @@ namespace GXY
         uniform_real_distribution<float> z(0.0, 1.0);
         uniform_real_distribution<float> xy(-1.0, 1.0);
 
-        global->Uniform.contextBuffer = make_shared<Buffer<Context>>();
-        global->Uniform.frustrumBuffer = make_shared<Buffer<FrustrumUniform>>();
+        global->Uniform.contextBuffer = make_shared<Buffer<Context>>(FRAMES_IN_FLIGHT);
+        global->Uniform.frustrumBuffer = make_shared<Buffer<FrustrumUniform>>(FRAMES_IN_FLIGHT * VIEWS_PER_FRAME);
         global->Uniform.randomNormal = make_shared<Buffer<vec4>>();
 
         global->Uniform.contextBuffer->allocate(1);
@@ -199,6 +230,10 @@ namespace GXY
     void createGlobal(Device *device)
     {
         global->device = device;
+        global->gpuProfiler = make_shared<GPUProfiler>();
+        global->cpuProfiler = make_shared<CPUProfiler>();
+        global->cpuProfiler->setThreadName("Main");
+        global->jobSystem = make_shared<JobSystem>(std::max(thread::hardware_concurrency(), 1u) - 1);
         global->ressourceManager = make_shared<RessourceManager>();
 
         createGlobalQuad();
@@ -212,6 +247,7 @@ namespace GXY
     Device::Device(int width, int height, bool fullScreen,
                    string const &title, vec3 const &clearColor,
                    string const &pathIcon) :
+        mMode(WINDOWED), mEGLDisplay(nullptr), mEGLContext(nullptr), mFrameIndex(0), mFrameLimit(0),
         mNImageInOneSecond(0), mLastTimeUpdate(0), mFPS(0), mControlFps(false)
     {
         // Initialisation SDL
@@ -252,14 +288,16 @@ namespace GXY
             throw Except(string("Error Create GL_Context : ") + SDL_GetError());
         }
 
-        // GLEW
-        glewExperimental = true;
-        u32 codeGlew = glewInit();
-        if(codeGlew != GLEW_OK)
+        try
+        {
+            mInitializeGlew();
+        }
+
+        catch(Except const &err)
         {
             SDL_GL_DeleteContext(mContext);
             SDL_DestroyWindow(mWindow.get());
-            throw Except(string("Glew Init Error : ") + (char const*)glewGetErrorString(codeGlew));
+            throw err;
         }
 
         mQuit = false;
@@ -280,6 +318,112 @@ namespace GXY
             }
         }
 
+        mInitialize(clearColor);
+    }
+
+    Device::Device(s32 width, s32 height, DeviceMode mode) :
+        mMode(mode), mContext(nullptr), mEGLDisplay(nullptr), mEGLContext(nullptr), mFrameIndex(0), mFrameLimit(0),
+        mNImageInOneSecond(0), mLastTimeUpdate(0), mFPS(0), mControlFps(false)
+    {
+        if(mode != HEADLESS)
+            throw Except("Device : a Window is created by Device(width, height, fullScreen, ...)");
+
+        // Only timer : no video without display
+        if(SDL_Init(SDL_INIT_TIMER) == -1)
+            throw Except(string("SDL2 Init Error : ") + SDL_GetError());
+
+        atexit(SDL_Quit);
+
+        mWidth = width;
+        mHeight = height;
+
+        mCreateHeadlessContext();
+        mInitializeGlew();
+
+        mQuit = false;
+        mMouse = make_shared<Mouse>();
+        mKeyBoard = make_shared<KeyBoard>();
+        mMouse->mX = mMouse->mY = mMouse->mXRel = mMouse->mYRel = 0;
+
+        // Time is simulated
+        mFPS = HEADLESS_FPS;
+
+        mOffscreen = make_shared<FrameBuffer>();
+        mOffscreen->create();
+        mOffscreen->createTexture(mWidth, mHeight, {RGBA8_UNORM}, true);
+
+        mInitialize(vec3(0.0, 0.0, 0.0));
+    }
+
+    void Device::mCreateHeadlessContext(void)
+    {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        EGLDisplay display = EGL_NO_DISPLAY;
+
+        // Surfaceless platform works without any X or Wayland server
+        if(getPlatformDisplay != nullptr)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+
+        if(display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        if(display == EGL_NO_DISPLAY || eglInitialize(display, nullptr, nullptr) == EGL_FALSE)
+            throw Except("EGL Init Error : no display available");
+
+        if(eglBindAPI(EGL_OPENGL_API) == EGL_FALSE)
+        {
+            eglTerminate(display);
+            throw Except("EGL Init Error : OpenGL API is not supported");
+        }
+
+        EGLint const configAttributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        EGLint const contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION, 4,
+                                            EGL_CONTEXT_MINOR_VERSION, 4,
+                                            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                            EGL_NONE};
+
+        EGLConfig config = EGL_NO_CONFIG_KHR;
+        EGLint numConfigs = 0;
+
+        // Without EGL_KHR_no_config_context, we need a config
+        if(eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) == EGL_FALSE || numConfigs == 0)
+            config = EGL_NO_CONFIG_KHR;
+
+        EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+
+        if(context == EGL_NO_CONTEXT)
+        {
+            eglTerminate(display);
+            throw Except("EGL Error : impossible to create an OpenGL 4.4 core Context");
+        }
+
+        if(eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) == EGL_FALSE)
+        {
+            eglDestroyContext(display, context);
+            eglTerminate(display);
+            throw Except("EGL Error : impossible to make current a Context without surface");
+        }
+
+        mEGLDisplay = display;
+        mEGLContext = context;
+    }
+
+    void Device::mInitializeGlew(void)
+    {
+        glewExperimental = true;
+        u32 codeGlew = glewInit();
+
+        // A Glew built for GLX can't find a GLX display with EGL, but OpenGL functions are loaded
+        if(codeGlew != GLEW_OK && !(mMode == HEADLESS && codeGlew == GLEW_ERROR_NO_GLX_DISPLAY))
+            throw Except(string("Glew Init Error : ") + (char const*)glewGetErrorString(codeGlew));
+
+        // The culling pass gives the number of draws to glMultiDrawElementsIndirectCount
+        if(!GLEW_ARB_indirect_parameters)
+            throw Except("ARB_indirect_parameters is not supported");
+    }
+
+    void Device::mInitialize(vec3 const &clearColor)
+    {
         setClearColor(clearColor);
 
         mLastTimeUpdateForControlFps = SDL_GetTicks();
@@ -358,12 +502,41 @@ namespace GXY
 
     void Device::begin(void)
     {
-        mUpdate();
+        if(mMode == HEADLESS)
+        {
+            mMouse->mXRel = mMouse->mYRel = 0;
+            bindFrameBuffer();
+        }
+
+        else
+            mUpdate();
+
+        global->gpuProfiler->beginFrame();
+
+        // Jobs which need the OpenGL context, queued by workers since the last frame
+        global->jobSystem->runMainThreadJobs();
+
+        // Ressources loaded by workers, a slice by frame
+        global->ressourceManager->update();
+
         clearDepthColorBuffer();
     }
 
     void Device::end(void)
     {
+        global->gpuProfiler->endFrame();
+
+        ++mFrameIndex;
+
+        if(mFrameLimit != 0 && mFrameIndex >= mFrameLimit)
+            mQuit = true;
+
+        if(mMode == HEADLESS)
+        {
+            glFlush();
+            return;
+        }
+
         ++mNImageInOneSecond;
 
         // pour récupérer le nombre de FPS réel
@@ -383,7 +556,6 @@ namespace GXY
             mLastTimeUpdateForControlFps = SDL_GetTicks();
         }
 
-        synchronize();
         SDL_GL_SwapWindow(mWindow.get());
     }
 
@@ -399,12 +571,46 @@ namespace GXY
 
     void Device::setTitle(string const &title)
     {
-        SDL_SetWindowTitle(mWindow.get(), title.c_str());
+        if(mWindow != nullptr)
+            SDL_SetWindowTitle(mWindow.get(), title.c_str());
+    }
+
+    void Device::bindFrameBuffer(void)
+    {
+        if(mMode == HEADLESS)
+            mOffscreen->bind();
+
+        else
+        {
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            setViewPort();
+        }
+    }
+
+    void Device::readPixels(vector<u8> &pixels)
+    {
+        if(mMode != HEADLESS)
+            throw Except("Device : readPixels is only available without Window");
+
+        pixels.resize(mWidth * mHeight * 4);
+        mOffscreen->readPixels(0, pixels);
     }
 
     Device::~Device(void)
     {
+        // Destroyed before the JobSystem : it waits for the jobs which write in the caches
+        global->ressourceManager = nullptr;
         delete global;
-        SDL_GL_DeleteContext(mContext);
+        mOffscreen = nullptr;
+
+        if(mMode == HEADLESS)
+        {
+            eglMakeCurrent(mEGLDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(mEGLDisplay, mEGLContext);
+            eglTerminate(mEGLDisplay);
+        }
+
+        else
+            SDL_GL_DeleteContext(mContext);
     }
 }
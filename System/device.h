@@ -19,6 +19,9 @@ namespace GXY
     class VertexArray;
     class Shader;
     class SceneManager;
+    class GPUProfiler;
+    class CPUProfiler;
+    class JobSystem;
 
     /**
      * @brief The Global struct
@@ -31,6 +34,9 @@ namespace GXY
         Device *device; //!< A pointer on current Device
         std::shared_ptr<RessourceManager> ressourceManager; //!< A pointer on RessourceManager
         SceneManager *sceneManager; //!< A pointer on SceneManager
+        std::shared_ptr<GPUProfiler> gpuProfiler; //!< A pointer on the GPUProfiler
+        std::shared_ptr<CPUProfiler> cpuProfiler; //!< A pointer on the CPUProfiler
+        std::shared_ptr<JobSystem> jobSystem; //!< A pointer on the JobSystem, one worker by core after the main thread
 
         struct
         {
@@ -50,12 +56,23 @@ namespace GXY
             std::shared_ptr<Buffer<u32>> index; //!< A pointer on the principal Element Buffer for rendering
 
             std::shared_ptr<Buffer<DrawElementCommand>> command; //!< A pointer on the DrawElementCommand Buffer for rendering
+            std::shared_ptr<Buffer<DrawElementCommand>> commandCompact; //!< A pointer on the commands which survive the culling pass, without hole
+            std::shared_ptr<Buffer<DrawElementCommand>> commandOcclusion; //!< A pointer on the commands of meshes found visible by the occlusion test, without hole
+            std::shared_ptr<Buffer<u32>> drawCount; //!< A pointer on the number of commands in commandCompact and commandOcclusion
+            std::shared_ptr<Buffer<DrawInstance>> instance; //!< A pointer on the instances of all commands
+            std::shared_ptr<Buffer<glm::uvec2>> instanceCount; //!< A pointer on the number of instances of each command which survive the culling pass
+            std::shared_ptr<Buffer<u32>> visibleInstance; //!< A pointer on the matrices of instances which survive the culling pass
+            std::shared_ptr<Buffer<u32>> visibility; //!< A pointer on the visibility of each instance at the last frame
             std::shared_ptr<Buffer<AABB3D>> aabb3D; //!< A pointer on Buffer which own Bounding Boxes for culling
+            std::shared_ptr<Buffer<ClusterCone>> clusterCone; //!< A pointer on Buffer which own cones of normals of commands for backface culling
+            std::shared_ptr<Buffer<ClusterLod>> clusterLod; //!< A pointer on Buffer which own the levels of detail of commands
+            std::shared_ptr<Buffer<HlodSwitch>> hlodSwitch; //!< A pointer on Buffer which own the choices between subtrees and their proxy
 
             std::shared_ptr<Buffer<Material>> material; //!< A pointer on the Material Buffer which own all materials
 
             std::shared_ptr<Buffer<glm::mat4>> toClipSpace; //!< A pointer on matrixClipSpace buffer
-            std::shared_ptr<Buffer<glm::mat4>> toWorldSpace; //!< A pointer on matrixWorldSpace buffer
+            std::shared_ptr<Buffer<glm::mat4>> toWorldSpace; //!< A pointer on matrixWorldSpace buffer, one matrix by ModelNode, written by the GPU
+            std::shared_ptr<Buffer<TransformUpdate>> transformUpdate; //!< A pointer on the matrices changed during the frame
         }Model;
 
         struct
@@ -91,7 +108,10 @@ namespace GXY
         struct
         {
             std::shared_ptr<Shader> matrixCulling; //!< A pointer on the Shader used to compute Matrix ClipSpace and perform frustrum culling
+            std::shared_ptr<Shader> compactCommands; //!< A pointer on the Shader used to write commands of instances which survive the culling
+            std::shared_ptr<Shader> scatterTransforms; //!< A pointer on the Shader used to write the matrices changed in toWorldSpace
             std::shared_ptr<Shader> depth; //!< A pointer on The Shader used to depth pass.
+            std::shared_ptr<Shader> hiZ; //!< A pointer on the Shader used to build the Hi-Z pyramid
             std::shared_ptr<Shader> model; //!< A pointer on the Shader used to render Model
 
             std::shared_ptr<Shader> ambientOcclusion; //!< A pointer on the Shaser used to compute Ambient Occlusion
@@ -223,6 +243,18 @@ namespace GXY
                glm::vec3 const &clearColor = glm::vec3(0.0, 0.0, 0.0),
                std::string const &pathIcon = "");
 
+        /**
+         * @brief Device Constructor without Window
+         *
+         * In HEADLESS mode, the OpenGL Context is created by EGL without surface,
+         * and the scene is rendered inside an offscreen FrameBuffer of width * height.
+         * There are no events and time is simulated at HEADLESS_FPS, so two runs render the same frames.
+         * @param[in] width : Width of the offscreen FrameBuffer
+         * @param[in] height : Height of the offscreen FrameBuffer
+         * @param[in] mode : WINDOWED or HEADLESS
+         */
+        Device(s32 width, s32 height, DeviceMode mode);
+
         /**
          * @brief Clear buffers and update events
          */
@@ -253,6 +285,35 @@ namespace GXY
          */
         void setTitle(std::string const &title);
 
+        /**
+         * @brief Bind the FrameBuffer where the final image is rendered : Window or offscreen FrameBuffer
+         */
+        void bindFrameBuffer(void);
+
+        /**
+         * @brief Read the final image, only in HEADLESS mode
+         * @param[out] pixels : RGBA8 pixels, width * height * 4 bytes, first row at the bottom
+         */
+        void readPixels(std::vector<u8> &pixels);
+
+        /**
+         * @brief Set the number of frames to render before run() returns false
+         * @param[in] limit : number of frames, 0 for unlimited
+         */
+        inline void setFrameLimit(u32 limit) {mFrameLimit = limit;}
+
+        /**
+         * @brief Get the number of frames ended since the creation of the Device
+         * @return index of the current frame
+         */
+        inline u32 frameIndex(void) const {return mFrameIndex;}
+
+        /**
+         * @brief Ask if the Device renders without Window
+         * @return true if HEADLESS
+         */
+        inline bool isHeadless(void) const {return mMode == HEADLESS;}
+
         /**
          * @brief Get width of Window
          * @return width of Window
@@ -323,9 +384,18 @@ namespace GXY
         ~Device(void);
 
     private :
+        DeviceMode mMode; //!< WINDOWED or HEADLESS
+
         std::shared_ptr<SDL_Window> mWindow; //!< The pointer of Window
         SDL_GLContext mContext; //!< The context of OpenGL
 
+        void *mEGLDisplay; //!< The EGLDisplay in HEADLESS mode
+        void *mEGLContext; //!< The EGLContext in HEADLESS mode
+        std::shared_ptr<FrameBuffer> mOffscreen; //!< The FrameBuffer which replaces the Window in HEADLESS mode
+
+        u32 mFrameIndex; //!< Number of frames ended
+        u32 mFrameLimit; //!< Number of frames to render, 0 for unlimited
+
         s32 mWidth, mHeight; //!< Respectively Width and height of Window
 
         bool mQuit; //!< Should the program run or not?
@@ -344,6 +414,22 @@ namespace GXY
          * @brief mUpdate
          */
         void mUpdate(void);
+
+        /**
+         * @brief Create the OpenGL Context with EGL without any surface
+         */
+        void mCreateHeadlessContext(void);
+
+        /**
+         * @brief Initialize Glew
+         */
+        void mInitializeGlew(void);
+
+        /**
+         * @brief Initialize states and Global structure, the context has to be current
+         * @param[in] clearColor : The color used to clear screen
+         */
+        void mInitialize(glm::vec3 const &clearColor);
     };
 
     /**
@@ -241,6 +241,15 @@ static CameraUp const up[] = {CAM_DOWN_Y,
         mColorBuffer.bindImages(indexFirstImage, firstUnit, count);
     }
 
+    void FrameBuffer::readPixels(u32 index, vector<u8> &pixels)
+    {
+        if(index >= mNumber || pixels.size() < mW * mH * 4)
+            throw Except("FrameBuffer : Index out of rang");
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTextureImageEXT(mColorBuffer.mId[index], GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+    }
+
     void FrameBuffer::bindDepthBufferTexture(u32 firstUnit)
     {
         mDepthBuffer.bindTextures(0, firstUnit, 1);
@@ -279,14 +288,13 @@ static CameraUp const up[] = {CAM_DOWN_Y,
             global->device->clearDepthColorBuffer();
             global->device->clearStencilBuffer();
 
-            global->sceneManager->pushModelsInPipeline(camera);
+            global->sceneManager->pushModelsInPipeline(camera, CULLING_FRUSTRUM, 0.0f, false,
+                                                       global->sceneManager->shadowLodBias());
             global->Shaders.depth->use();
                 global->sceneManager->renderDepthPass();
 
             shader->use();
                 global->sceneManager->renderModels();
-
-            synchronize();
         }
     }
 
@@ -304,14 +312,13 @@ static CameraUp const up[] = {CAM_DOWN_Y,
             frameBuffer->attachCubeMapArray(CubeMap(POS_X + i), index);
             global->device->clearDepthColorBuffer();
 
-            global->sceneManager->pushModelsInPipeline(camera);
+            global->sceneManager->pushModelsInPipeline(camera, CULLING_FRUSTRUM, 0.0f, false,
+                                                       global->sceneManager->shadowLodBias());
             global->Shaders.depth->use();
                 global->sceneManager->renderDepthPass();
 
             shader->use();
                 global->sceneManager->renderModels();
-
-            synchronize();
         }
     }
 }
@@ -130,6 +130,13 @@ namespace GXY
          * @param[in] count : Number of images to bind
          */
         void bindImages(u32 indexFirstImage, u32 firstUnit, u32 count);
+
+        /**
+         * @brief Read back one color Texture as RGBA8
+         * @param[in] index : Index of the color Texture
+         * @param[out] pixels : mW * mH * 4 bytes, it has to be already allocated
+         */
+        void readPixels(u32 index, std::vector<u8> &pixels);
         
         /**
          * @brief Destroy FrameBuffer and Texture
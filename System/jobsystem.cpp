@@ -0,0 +1,356 @@
+/*!
+ * \file jobsystem.cpp
+ * \brief Run jobs on all cores, with work stealing
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#include "jobsystem.h"
+#include "device.h"
+#include "../Debug/cpuprofiler.h"
+
+using namespace std;
+
+namespace GXY
+{
+    static atomic<u64> jobSystemId(0); //!< Identifier of the next JobSystem
+
+    /**
+     * @brief Queue of the calling thread
+     */
+    struct JobThreadState
+    {
+        u64 id; //!< Identifier of the JobSystem of the queue
+        u32 queue; //!< Index of the queue
+    };
+
+    static thread_local JobThreadState jobThreadState = {0, 0};
+
+    JobSystem::JobSystem(u32 numWorkers) :
+        mQueued(0), mMainThreadQueued(0), mId(++jobSystemId), mMainThread(this_thread::get_id()), mQuit(false)
+    {
+        for(u32 i = 0; i < numWorkers + 1; ++i)
+            mQueues.emplace_back(new Queue);
+
+        jobThreadState.id = mId;
+        jobThreadState.queue = 0;
+
+        for(u32 i = 0; i < numWorkers; ++i)
+            mWorkers.emplace_back(&JobSystem::mWork, this, i + 1);
+    }
+
+    u32 JobSystem::mThreadQueue(void) const
+    {
+        return (jobThreadState.id == mId) ? jobThreadState.queue : 0;
+    }
+
+    bool JobSystem::isMainThread(void) const
+    {
+        return this_thread::get_id() == mMainThread;
+    }
+
+    void JobSystem::mWakeAll(void)
+    {
+        // Sleepers check what they wait for under the mutex : they can't miss this notification
+        {
+            lock_guard<mutex> lock(mMutex);
+        }
+
+        mWake.notify_all();
+    }
+
+    void JobSystem::run(function<void(void)> job, JobCounter *counter, JobAffinity affinity)
+    {
+        if(counter != nullptr)
+            counter->mPending.fetch_add(1, memory_order_relaxed);
+
+        if(affinity == MAIN_THREAD)
+        {
+            {
+                lock_guard<mutex> lock(mMainThreadQueue.mutex);
+                mMainThreadQueue.jobs.push_back({move(job), counter});
+            }
+
+            mMainThreadQueued.fetch_add(1);
+            mWakeAll();
+            return;
+        }
+
+        Queue &queue = *mQueues[mThreadQueue()];
+
+        if(counter != nullptr)
+            counter->mQueued.fetch_add(1);
+
+        {
+            lock_guard<mutex> lock(queue.mutex);
+            queue.jobs.push_back({move(job), counter});
+        }
+
+        mQueued.fetch_add(1);
+
+        // One thread can wait for this counter : it only wakes for its jobs
+        if(counter != nullptr)
+        {
+            mWakeAll();
+            return;
+        }
+
+        {
+            lock_guard<mutex> lock(mMutex);
+        }
+
+        mWake.notify_one();
+    }
+
+    void JobSystem::mTaken(Job const &job)
+    {
+        mQueued.fetch_sub(1);
+
+        if(job.counter != nullptr)
+            job.counter->mQueued.fetch_sub(1);
+    }
+
+    bool JobSystem::mTake(u32 queue, Job &job, JobCounter const *counter)
+    {
+        auto matches = [counter](Job const &candidate){return counter == nullptr || candidate.counter == counter;};
+
+        // Own jobs first, the last pushed is the most likely in the cache
+        {
+            Queue &own = *mQueues[queue];
+            lock_guard<mutex> lock(own.mutex);
+
+            for(auto it = own.jobs.rbegin(); it != own.jobs.rend(); ++it)
+            {
+                if(!matches(*it))
+                    continue;
+
+                job = move(*it);
+                own.jobs.erase(next(it).base());
+                mTaken(job);
+                return true;
+            }
+        }
+
+        if(mMainThreadQueued.load() > 0 && isMainThread())
+        {
+            lock_guard<mutex> lock(mMainThreadQueue.mutex);
+
+            if(!mMainThreadQueue.jobs.empty())
+            {
+                job = move(mMainThreadQueue.jobs.front());
+                mMainThreadQueue.jobs.pop_front();
+                mMainThreadQueued.fetch_sub(1);
+                return true;
+            }
+        }
+
+        if(mQueued.load() == 0 || (counter != nullptr && counter->mQueued.load() == 0))
+            return false;
+
+        // Steal the oldest job of another thread, it is often the largest one
+        for(u32 i = 1; i < mQueues.size(); ++i)
+        {
+            Queue &victim = *mQueues[(queue + i) % mQueues.size()];
+            lock_guard<mutex> lock(victim.mutex);
+
+            for(auto it = victim.jobs.begin(); it != victim.jobs.end(); ++it)
+            {
+                if(!matches(*it))
+                    continue;
+
+                job = move(*it);
+                victim.jobs.erase(it);
+                mTaken(job);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void JobSystem::mExecute(Job &job)
+    {
+        job.function();
+
+        // Once at 0 the waiter can destroy the counter : do not touch it after
+        if(job.counter != nullptr && job.counter->mPending.fetch_sub(1, memory_order_acq_rel) == 1)
+            mWakeAll();
+    }
+
+    void JobSystem::wait(JobCounter &counter)
+    {
+        GXY_ZONE("JobSystem::wait");
+
+        u32 queue = mThreadQueue();
+        bool mainThread = isMainThread();
+
+        // Loadings queued beside the jobs of the counter are left to the workers
+        while(!counter.done())
+        {
+            Job job;
+
+            if(mTake(queue, job, &counter))
+            {
+                mExecute(job);
+                continue;
+            }
+
+            unique_lock<mutex> lock(mMutex);
+
+            mWake.wait(lock, [&]{return counter.done() || counter.mQueued.load() > 0 ||
+                                        (mainThread && mMainThreadQueued.load() > 0);});
+        }
+    }
+
+    void JobSystem::waitUntil(function<bool(void)> const &done)
+    {
+        GXY_ZONE("JobSystem::waitUntil");
+
+        u32 queue = mThreadQueue();
+        bool mainThread = isMainThread();
+
+        while(!done())
+        {
+            Job job;
+
+            if(mTake(queue, job, nullptr))
+            {
+                mExecute(job);
+                continue;
+            }
+
+            // Nobody notifies what done checks
+            unique_lock<mutex> lock(mMutex);
+
+            mWake.wait_for(lock, chrono::milliseconds(1), [&]{return mQueued.load() > 0 ||
+                                                                     (mainThread && mMainThreadQueued.load() > 0);});
+        }
+    }
+
+    void JobSystem::parallelFor(u32 begin, u32 end, u32 grain, function<void(u32)> const &body)
+    {
+        if(begin >= end)
+            return;
+
+        grain = std::max(grain, 1u);
+
+        u32 numJobs = (end - begin + grain - 1) / grain;
+
+        // Nothing to share
+        if(numJobs == 1 || mWorkers.empty())
+        {
+            for(u32 i = begin; i < end; ++i)
+                body(i);
+
+            return;
+        }
+
+        JobCounter counter;
+        Queue &queue = *mQueues[mThreadQueue()];
+
+        counter.mPending.store(numJobs, memory_order_relaxed);
+        counter.mQueued.store(numJobs, memory_order_relaxed);
+
+        {
+            lock_guard<mutex> lock(queue.mutex);
+
+            for(u32 first = begin; first < end; first += grain)
+            {
+                u32 last = std::min(first + grain, end);
+
+                queue.jobs.push_back({[&body, first, last]()
+                {
+                    for(u32 i = first; i < last; ++i)
+                        body(i);
+                }, &counter});
+            }
+        }
+
+        mQueued.fetch_add(numJobs);
+        mWakeAll();
+
+        wait(counter);
+    }
+
+    void JobSystem::runMainThreadJobs(void)
+    {
+        assert(isMainThread());
+
+        // Jobs queued by these jobs wait for the next call
+        u32 numJobs = mMainThreadQueued.load();
+
+        for(u32 i = 0; i < numJobs; ++i)
+        {
+            Job job;
+
+            {
+                lock_guard<mutex> lock(mMainThreadQueue.mutex);
+
+                if(mMainThreadQueue.jobs.empty())
+                    break;
+
+                job = move(mMainThreadQueue.jobs.front());
+                mMainThreadQueue.jobs.pop_front();
+                mMainThreadQueued.fetch_sub(1);
+            }
+
+            mExecute(job);
+        }
+
+        if(!mWorkers.empty())
+            return;
+
+        // One slice of the queued jobs by frame, a job started is not interrupted
+        auto start = chrono::steady_clock::now();
+        u32 queue = mThreadQueue();
+        Job job;
+
+        while(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() < MAIN_THREAD_JOBS_MILLISECONDS &&
+              mTake(queue, job, nullptr))
+            mExecute(job);
+    }
+
+    void JobSystem::mWork(u32 queue)
+    {
+        jobThreadState.id = mId;
+        jobThreadState.queue = queue;
+
+        if(global != nullptr && global->cpuProfiler != nullptr)
+            global->cpuProfiler->setThreadName("Worker");
+
+        while(true)
+        {
+            Job job;
+
+            if(mTake(queue, job, nullptr))
+            {
+                mExecute(job);
+                continue;
+            }
+
+            unique_lock<mutex> lock(mMutex);
+
+            mWake.wait(lock, [&]{return mQuit || mQueued.load() > 0;});
+
+            if(mQuit && mQueued.load() == 0)
+                return;
+        }
+    }
+
+    JobSystem::~JobSystem(void)
+    {
+        if(isMainThread())
+            while(mMainThreadQueued.load() > 0)
+                runMainThreadJobs();
+
+        {
+            lock_guard<mutex> lock(mMutex);
+            mQuit = true;
+        }
+
+        mWake.notify_all();
+
+        for(auto &worker : mWorkers)
+            worker.join();
+    }
+}
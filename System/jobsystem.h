@@ -0,0 +1,202 @@
+/*!
+ * \file jobsystem.h
+ * \brief Run jobs on all cores, with work stealing
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include "../include/include.h"
+
+namespace GXY
+{
+    class JobSystem;
+
+    /**
+     * @brief Where a job can run
+     */
+    enum JobAffinity{ANY_THREAD, //!< Any worker, or the main thread while it waits
+                     MAIN_THREAD //!< Only the main thread, which owns the OpenGL context
+                    };
+
+    /**
+     * @brief The JobCounter class
+     *
+     * Count the jobs not finished yet among the jobs run with it, JobSystem::wait waits for 0
+     */
+    class JobCounter
+    {
+        friend JobSystem;
+
+    public:
+        /**
+         * @brief JobCounter Constructor
+         */
+        JobCounter(void) : mPending(0), mQueued(0){}
+
+        JobCounter(JobCounter const &counter) = delete;
+        JobCounter &operator=(JobCounter const &counter) = delete;
+
+        /**
+         * @brief To know if all jobs of this counter are finished
+         * @return true if they are
+         */
+        inline bool done(void) const {return mPending.load(std::memory_order_acquire) == 0;}
+
+    private:
+        std::atomic<u32> mPending; //!< Jobs not finished yet
+        std::atomic<u32> mQueued; //!< Its ANY_THREAD jobs still in a queue, not started
+    };
+
+    /**
+     * @brief The JobSystem class
+     *
+     * One worker by core after the main thread. Each thread, the main one too, owns a deque :
+     * it pushes and takes its jobs at the back, and the other threads steal at the front when theirs is empty.
+     * A thread which waits for a counter runs the jobs of this counter meanwhile, so jobs can wait for other jobs,
+     * and a frame which waits for its parallelFor never runs a long loading queued beside it.
+     *
+     * Jobs with MAIN_THREAD are only run by the main thread, when it waits or in runMainThreadJobs :
+     * every job which calls OpenGL has to be one of them.
+     */
+    class JobSystem
+    {
+    public:
+        /**
+         * @brief JobSystem Constructor, the calling thread becomes the main thread
+         * @param[in] numWorkers : Number of threads created, the main thread is not counted
+         */
+        JobSystem(u32 numWorkers);
+
+        JobSystem(JobSystem const &system) = delete;
+        JobSystem &operator=(JobSystem const &system) = delete;
+
+        /**
+         * @brief Run one job, without waiting for it
+         * @param[in] job : The job
+         * @param[in] counter : Counter incremented now and decremented when the job is finished, can be nullptr
+         * @param[in] affinity : ANY_THREAD, or MAIN_THREAD for jobs which call OpenGL
+         */
+        void run(std::function<void(void)> job, JobCounter *counter = nullptr, JobAffinity affinity = ANY_THREAD);
+
+        /**
+         * @brief Wait for all jobs of one counter, running its jobs meanwhile, and MAIN_THREAD jobs on the main thread
+         * @param[in] counter : The counter
+         */
+        void wait(JobCounter &counter);
+
+        /**
+         * @brief Wait until done returns true, running other jobs meanwhile
+         *
+         * For what no counter follows : done is checked between two jobs, and at least every millisecond
+         * @param[in] done : The condition, checked on the calling thread
+         */
+        void waitUntil(std::function<bool(void)> const &done);
+
+        /**
+         * @brief Call body(i) for all i in [begin, end) on all threads, and wait for them
+         * @param[in] begin : First index
+         * @param[in] end : After the last index
+         * @param[in] grain : Number of indices of one job at most
+         * @param[in] body : The body, must not call OpenGL
+         */
+        void parallelFor(u32 begin, u32 end, u32 grain, std::function<void(u32)> const &body);
+
+        /**
+         * @brief Run the MAIN_THREAD jobs already queued, called once per frame by the Device
+         *
+         * Without worker, nothing else runs the ANY_THREAD jobs, loadings for instance :
+         * they are run here too, during MAIN_THREAD_JOBS_MILLISECONDS at most
+         */
+        void runMainThreadJobs(void);
+
+        /**
+         * @brief To know if the calling thread is the main thread
+         * @return true if it is
+         */
+        bool isMainThread(void) const;
+
+        /**
+         * @brief Get the number of threads which run jobs
+         * @return workers and the main thread
+         */
+        inline u32 numThreads(void) const {return mQueues.size();}
+
+        /**
+         * @brief JobSystem Destructor, finish all jobs and join all workers
+         */
+        ~JobSystem(void);
+
+    private:
+        /**
+         * @brief One job and its counter
+         */
+        struct Job
+        {
+            std::function<void(void)> function; //!< What to do
+            JobCounter *counter; //!< Counter to decrement after, can be nullptr
+        };
+
+        /**
+         * @brief Jobs of one thread
+         */
+        struct Queue
+        {
+            std::mutex mutex; //!< Owner and thieves take it shortly
+            std::deque<Job> jobs; //!< Owner at the back, thieves at the front
+        };
+
+        std::vector<std::unique_ptr<Queue>> mQueues; //!< Queue of each thread, the main thread is 0
+        Queue mMainThreadQueue; //!< MAIN_THREAD jobs
+        std::vector<std::thread> mWorkers; //!< Worker threads, worker i owns mQueues[i + 1]
+        std::atomic<u32> mQueued; //!< Jobs in mQueues
+        std::atomic<u32> mMainThreadQueued; //!< Jobs in mMainThreadQueue
+        std::mutex mMutex; //!< Only to sleep and wake
+        std::condition_variable mWake; //!< Jobs were queued, a counter reached 0, or workers have to stop
+        u64 mId; //!< Identifier of this JobSystem
+        std::thread::id mMainThread; //!< Thread which created the JobSystem
+        bool mQuit; //!< Workers have to stop
+
+        /**
+         * @brief Get the index of the queue of the calling thread
+         * @return index, 0 for the main thread and threads outside the JobSystem
+         */
+        u32 mThreadQueue(void) const;
+
+        /**
+         * @brief Take one job : in the own queue, in the MAIN_THREAD ones for the main thread, or stolen
+         * @param[in] queue : Queue of the calling thread
+         * @param[out] job : The job
+         * @param[in] counter : Only jobs of this counter are taken, MAIN_THREAD ones aside, nullptr for any job
+         * @return false if there is no such job anywhere
+         */
+        bool mTake(u32 queue, Job &job, JobCounter const *counter);
+
+        /**
+         * @brief Count one job taken out of mQueues
+         * @param[in] job : The job
+         */
+        void mTaken(Job const &job);
+
+        /**
+         * @brief Run one job and decrement its counter
+         * @param[in] job : The job
+         */
+        void mExecute(Job &job);
+
+        /**
+         * @brief Wake the threads which sleep, the caller has changed what they wait for
+         */
+        void mWakeAll(void);
+
+        /**
+         * @brief Loop of one worker
+         * @param[in] queue : Queue of the worker
+         */
+        void mWork(u32 queue);
+    };
+}
+
+#endif // JOBSYSTEM_H
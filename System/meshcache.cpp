@@ -0,0 +1,303 @@
+/*!
+ * \file meshcache.cpp
+ * \brief Keep imported Models on disk, to load them again without Assimp
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#include "meshcache.h"
+#include "../Debug/cpuprofiler.h"
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace glm;
+
+namespace GXY
+{
+    static u32 const MESH_CACHE_VERSION = 4; //!< Change it each time the layout or the optimization of meshes changes
+    static char const MESH_CACHE_MAGIC[4] = {'G', 'X', 'M', 'C'};
+    static char const *MESH_CACHE_DIRECTORY = "cache";
+
+    /**
+     * @brief Beginning of the file, sections follow it in this order, each one aligned on 16 bytes :
+     * path of the source, vertices, positions, indices, materials, boxes of clusters, commands, cones, levels of detail, paths of textures
+     */
+    struct MeshCacheHeader
+    {
+        char magic[4]; //!< MESH_CACHE_MAGIC
+        u32 version; //!< MESH_CACHE_VERSION
+        u32 importFlags; //!< Flags given to Assimp
+        u32 vertexSize; //!< sizeof(Vertex)
+        u64 sourceTime; //!< Modification time of the source, in nanoseconds
+        u64 sourceSize; //!< Size of the source in bytes
+        u32 pathSize; //!< Size of the path of the source
+        u32 numVertices; //!< Number of vertices
+        u32 numIndices; //!< Number of indices
+        u32 numMaterials; //!< Number of materials
+        u32 numClusters; //!< Number of clusters
+        u32 texturePathsSize; //!< Size of all paths of textures
+        u32 padding[2];
+        AABB3D aabb; //!< Bounding box of the Model
+    };
+
+    /**
+     * @brief One material in the file, its texture path is in the last section
+     */
+    struct MeshCacheMaterial
+    {
+        Material material; //!< Material without texture handle
+        u32 texturePathOffset; //!< Offset in the last section
+        u32 texturePathSize; //!< 0 if there is no texture
+        u32 padding[2];
+    };
+
+    /**
+     * @brief Offsets of the sections in the file
+     */
+    struct MeshCacheLayout
+    {
+        size_t path, vertices, positions, indices, materials, clustersAABB, clustersCommand, clustersCone, clustersLod, texturePaths, size;
+    };
+
+    static inline size_t align16(size_t offset)
+    {
+        return (offset + 15) & ~size_t(15);
+    }
+
+    static MeshCacheLayout computeLayout(MeshCacheHeader const &header)
+    {
+        MeshCacheLayout layout;
+
+        layout.path = align16(sizeof(MeshCacheHeader));
+        layout.vertices = align16(layout.path + header.pathSize);
+        layout.positions = align16(layout.vertices + header.numVertices * sizeof(Vertex));
+        layout.indices = align16(layout.positions + header.numVertices * sizeof(vec3));
+        layout.materials = align16(layout.indices + header.numIndices * sizeof(u32));
+        layout.clustersAABB = align16(layout.materials + header.numMaterials * sizeof(MeshCacheMaterial));
+        layout.clustersCommand = align16(layout.clustersAABB + header.numClusters * sizeof(AABB3D));
+        layout.clustersCone = align16(layout.clustersCommand + header.numClusters * sizeof(DrawElementCommand));
+        layout.clustersLod = align16(layout.clustersCone + header.numClusters * sizeof(ClusterCone));
+        layout.texturePaths = align16(layout.clustersLod + header.numClusters * sizeof(ClusterLod));
+        layout.size = layout.texturePaths + header.texturePathsSize;
+
+        return layout;
+    }
+
+    /**
+     * @brief FNV-1a, to name the file after the path of the source
+     */
+    static u64 hashPath(string const &path)
+    {
+        u64 hash = 14695981039346656037ULL;
+
+        for(auto c : path)
+        {
+            hash ^= (u8)c;
+            hash *= 1099511628211ULL;
+        }
+
+        return hash;
+    }
+
+    string cacheFile(string const &source, char const *extension)
+    {
+        stringstream name;
+
+        name << MESH_CACHE_DIRECTORY << "/" << hex << hashPath(source) << extension;
+
+        return name.str();
+    }
+
+    void cacheStamp(string const &source, u64 &time, u64 &size)
+    {
+        struct stat status;
+
+        time = size = 0;
+
+        if(stat(source.c_str(), &status) == 0)
+        {
+            time = (u64)status.st_mtim.tv_sec * 1000000000ULL + status.st_mtim.tv_nsec;
+            size = status.st_size;
+        }
+    }
+
+    void writeCacheFile(string const &file, vector<u8> const &data, string const &source)
+    {
+        mkdir(MESH_CACHE_DIRECTORY, 0755);
+
+        // Written aside and renamed : a crash never leaves a truncated file under the real name
+        string temporary = file + ".tmp";
+        ofstream stream(temporary, ios::binary);
+
+        if(stream.write((char const*)data.data(), data.size()))
+        {
+            stream.close();
+
+            if(rename(temporary.c_str(), file.c_str()) == 0)
+                return;
+        }
+
+        remove(temporary.c_str());
+        cerr << "Impossible to write the cache : " << file << " for " << source << endl;
+    }
+
+    MeshView MeshData::view(void) const
+    {
+        MeshView view;
+
+        view.vertices = vertices.data();
+        view.positions = positions.data();
+        view.numVertices = vertices.size();
+        view.indices = indices.data();
+        view.numIndices = indices.size();
+        view.materials = materials.data();
+        view.texturePaths = texturePaths;
+        view.clustersAABB = clustersAABB.data();
+        view.clustersCommand = clustersCommand.data();
+        view.clustersCone = clustersCone.data();
+        view.clustersLod = clustersLod.data();
+        view.numClusters = clustersCommand.size();
+        view.aabb = aabb;
+
+        return view;
+    }
+
+    MeshCache::MeshCache(string const &source, u32 importFlags) :
+        mSource(source), mPath(cacheFile(source, ".mesh")), mImportFlags(importFlags), mMapping(nullptr), mMappingSize(0)
+    {
+        cacheStamp(source, mSourceTime, mSourceSize);
+    }
+
+    bool MeshCache::map(MeshView &view)
+    {
+        GXY_ZONE("MeshCache::map");
+
+        struct stat status;
+        int file = open(mPath.c_str(), O_RDONLY);
+
+        if(file < 0)
+            return false;
+
+        if(fstat(file, &status) != 0 || (size_t)status.st_size < sizeof(MeshCacheHeader))
+        {
+            close(file);
+            return false;
+        }
+
+        mMappingSize = status.st_size;
+        mMapping = mmap(nullptr, mMappingSize, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+
+        if(mMapping == MAP_FAILED)
+        {
+            mMapping = nullptr;
+            return false;
+        }
+
+        u8 const *data = (u8 const*)mMapping;
+        MeshCacheHeader const &header = *(MeshCacheHeader const*)data;
+        MeshCacheLayout layout = computeLayout(header);
+
+        // Outdated or truncated : Assimp will import the source again
+        if(memcmp(header.magic, MESH_CACHE_MAGIC, 4) != 0 || header.version != MESH_CACHE_VERSION ||
+           header.importFlags != mImportFlags || header.vertexSize != sizeof(Vertex) ||
+           header.sourceTime != mSourceTime || header.sourceSize != mSourceSize ||
+           layout.size != mMappingSize || header.pathSize != mSource.size() ||
+           memcmp(data + layout.path, mSource.data(), mSource.size()) != 0)
+        {
+            munmap(mMapping, mMappingSize);
+            mMapping = nullptr;
+            return false;
+        }
+
+        MeshCacheMaterial const *materials = (MeshCacheMaterial const*)(data + layout.materials);
+        char const *texturePaths = (char const*)(data + layout.texturePaths);
+
+        view.vertices = (Vertex const*)(data + layout.vertices);
+        view.positions = (vec3 const*)(data + layout.positions);
+        view.numVertices = header.numVertices;
+        view.indices = (u32 const*)(data + layout.indices);
+        view.numIndices = header.numIndices;
+        view.clustersAABB = (AABB3D const*)(data + layout.clustersAABB);
+        view.clustersCommand = (DrawElementCommand const*)(data + layout.clustersCommand);
+        view.clustersCone = (ClusterCone const*)(data + layout.clustersCone);
+        view.clustersLod = (ClusterLod const*)(data + layout.clustersLod);
+        view.numClusters = header.numClusters;
+        view.aabb = header.aabb;
+
+        // Materials are few : they are copied, and texture paths become strings
+        mMaterials.resize(header.numMaterials);
+        view.texturePaths.resize(header.numMaterials);
+
+        for(u32 i = 0; i < header.numMaterials; ++i)
+        {
+            mMaterials[i] = materials[i].material;
+            view.texturePaths[i].assign(texturePaths + materials[i].texturePathOffset, materials[i].texturePathSize);
+        }
+
+        view.materials = mMaterials.data();
+
+        return true;
+    }
+
+    void MeshCache::write(MeshView const &view)
+    {
+        GXY_ZONE("MeshCache::write");
+
+        MeshCacheHeader header;
+        vector<MeshCacheMaterial> materials(view.texturePaths.size());
+        string texturePaths;
+
+        memset(&header, 0, sizeof header);
+        memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+        header.version = MESH_CACHE_VERSION;
+        header.importFlags = mImportFlags;
+        header.vertexSize = sizeof(Vertex);
+        header.sourceTime = mSourceTime;
+        header.sourceSize = mSourceSize;
+        header.pathSize = mSource.size();
+        header.numVertices = view.numVertices;
+        header.numIndices = view.numIndices;
+        header.numMaterials = materials.size();
+        header.numClusters = view.numClusters;
+        header.aabb = view.aabb;
+
+        for(u32 i = 0; i < materials.size(); ++i)
+        {
+            memset(&materials[i], 0, sizeof materials[i]);
+            materials[i].material = view.materials[i];
+            materials[i].texturePathOffset = texturePaths.size();
+            materials[i].texturePathSize = view.texturePaths[i].size();
+            texturePaths += view.texturePaths[i];
+        }
+
+        header.texturePathsSize = texturePaths.size();
+
+        MeshCacheLayout layout = computeLayout(header);
+        vector<u8> file(layout.size, 0);
+
+        memcpy(&file[0], &header, sizeof header);
+        memcpy(&file[layout.path], mSource.data(), mSource.size());
+        memcpy(&file[layout.vertices], view.vertices, view.numVertices * sizeof(Vertex));
+        memcpy(&file[layout.positions], view.positions, view.numVertices * sizeof(vec3));
+        memcpy(&file[layout.indices], view.indices, view.numIndices * sizeof(u32));
+        memcpy(&file[layout.materials], materials.data(), materials.size() * sizeof(MeshCacheMaterial));
+        memcpy(&file[layout.clustersAABB], view.clustersAABB, view.numClusters * sizeof(AABB3D));
+        memcpy(&file[layout.clustersCommand], view.clustersCommand, view.numClusters * sizeof(DrawElementCommand));
+        memcpy(&file[layout.clustersCone], view.clustersCone, view.numClusters * sizeof(ClusterCone));
+        memcpy(&file[layout.clustersLod], view.clustersLod, view.numClusters * sizeof(ClusterLod));
+        memcpy(&file[layout.texturePaths], texturePaths.data(), texturePaths.size());
+
+        writeCacheFile(mPath, file, mSource);
+    }
+
+    MeshCache::~MeshCache(void)
+    {
+        if(mMapping != nullptr)
+            munmap(mMapping, mMappingSize);
+    }
+}
@@ -0,0 +1,143 @@
+/*!
+ * \file meshcache.h
+ * \brief Keep imported Models on disk, to load them again without Assimp
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include "../include/include.h"
+
+namespace GXY
+{
+    /**
+     * @brief Get the file of the cache for one source, named after its path in the directory "cache"
+     * @param[in] source : Path of the asset
+     * @param[in] extension : Extension of the file, by kind of asset
+     * @return path of the file
+     */
+    std::string cacheFile(std::string const &source, char const *extension);
+
+    /**
+     * @brief Get what makes a file of the cache outdated when the source changes
+     * @param[in] source : Path of the asset
+     * @param[out] time : Modification time in nanoseconds, 0 if there is no source
+     * @param[out] size : Size in bytes, 0 if there is no source
+     */
+    void cacheStamp(std::string const &source, u64 &time, u64 &size);
+
+    /**
+     * @brief Write one file of the cache, aside first and renamed : a crash never leaves it truncated
+     *
+     * A failure only prints a warning
+     * @param[in] file : Path of the file
+     * @param[in] data : Content of the file
+     * @param[in] source : Path of the asset, for the warning
+     */
+    void writeCacheFile(std::string const &file, std::vector<u8> const &data, std::string const &source);
+
+    /**
+     * @brief Final data of one Model, as it goes in the Buffers of Global::Model
+     *
+     * Indices of materials in vertices, firstIndex and baseVertex of commands
+     * are relative to the Model. Texture handles of materials are not set.
+     * Each mesh is split in clusters, one command by cluster, and so is each of its levels of detail.
+     */
+    struct MeshView
+    {
+        Vertex const *vertices; //!< Vertices of all meshes
+        glm::vec3 const *positions; //!< Positions of these vertices, for the depth pass
+        u32 numVertices; //!< Number of vertices
+
+        u32 const *indices; //!< Indices of all meshes, relative to their mesh
+        u32 numIndices; //!< Number of indices
+
+        Material const *materials; //!< Materials, without texture handle
+        std::vector<std::string> texturePaths; //!< Path of the diffuse texture of each material, empty if none
+
+        AABB3D const *clustersAABB; //!< Bounding box of each cluster
+        DrawElementCommand const *clustersCommand; //!< Command of each cluster
+        ClusterCone const *clustersCone; //!< Bounding sphere and cone of normals of each cluster
+        ClusterLod const *clustersLod; //!< Box of the mesh of each cluster and sizes where its level is drawn
+        u32 numClusters; //!< Number of clusters
+
+        AABB3D aabb; //!< Bounding box of the Model
+    };
+
+    /**
+     * @brief Same data as MeshView, owned
+     */
+    struct MeshData
+    {
+        std::vector<Vertex> vertices; //!< Vertices of all meshes
+        std::vector<glm::vec3> positions; //!< Positions of these vertices
+        std::vector<u32> indices; //!< Indices of all meshes
+        std::vector<Material> materials; //!< Materials, without texture handle
+        std::vector<std::string> texturePaths; //!< Path of the diffuse texture of each material
+        std::vector<AABB3D> clustersAABB; //!< Bounding box of each cluster
+        std::vector<DrawElementCommand> clustersCommand; //!< Command of each cluster
+        std::vector<ClusterCone> clustersCone; //!< Bounding sphere and cone of normals of each cluster
+        std::vector<ClusterLod> clustersLod; //!< Box of the mesh of each cluster and sizes where its level is drawn
+        AABB3D aabb; //!< Bounding box of the Model
+
+        /**
+         * @brief Get a view on these data, valid while they are not changed
+         * @return the view
+         */
+        MeshView view(void) const;
+    };
+
+    /**
+     * @brief The MeshCache class
+     *
+     * One file by source, named after its path in the directory "cache".
+     * The file is valid only for the same path, modification time, size, import flags,
+     * version of the layout and size of Vertex. It is mapped in memory when read,
+     * so the data can be copied in the Buffers directly.
+     */
+    class MeshCache
+    {
+    public:
+        /**
+         * @brief MeshCache Constructor
+         * @param[in] source : Path of the asset
+         * @param[in] importFlags : Flags given to Assimp
+         */
+        MeshCache(std::string const &source, u32 importFlags);
+
+        MeshCache(MeshCache const &cache) = delete;
+        MeshCache &operator=(MeshCache const &cache) = delete;
+
+        /**
+         * @brief Map the file if it is valid for the source
+         * @param[out] view : Data in the file, valid while the MeshCache is alive
+         * @return false if there is no file, or if it is outdated
+         */
+        bool map(MeshView &view);
+
+        /**
+         * @brief Write the file, a failure only prints a warning
+         * @param[in] view : Data of the Model
+         */
+        void write(MeshView const &view);
+
+        /**
+         * @brief MeshCache Destructor, unmap the file
+         */
+        ~MeshCache(void);
+
+    private:
+        std::string mSource; //!< Path of the asset
+        std::string mPath; //!< Path of the file
+        u32 mImportFlags; //!< Flags given to Assimp
+        u64 mSourceTime; //!< Modification time of the asset, in nanoseconds
+        u64 mSourceSize; //!< Size of the asset in bytes
+        std::vector<Material> mMaterials; //!< Materials copied from the file
+        void *mMapping; //!< File mapped in memory, nullptr if not mapped
+        size_t mMappingSize; //!< Size of the mapping
+    };
+}
+
+#endif // MESHCACHE_H
@@ -0,0 +1,439 @@
+/*!
+ * \file meshoptimizer.cpp
+ * \brief Reorder indices and vertices of meshes for the vertex cache, overdraw and vertex fetch, split them in clusters
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#include "meshoptimizer.h"
+
+using namespace std;
+using namespace glm;
+
+namespace GXY
+{
+    /**
+     * @brief FIFO cache of vertices : one vertex is in the cache while fewer than its size missed after it
+     */
+    struct VertexCache
+    {
+        std::vector<u32> insertion; //!< Time when each vertex was inserted
+        u32 time; //!< Number of misses so far, plus the size of the cache
+
+        VertexCache(u32 numVertices) : insertion(numVertices, 0), time(VERTEX_CACHE_SIZE + 1){}
+
+        /**
+         * @brief Transform one vertex if it is not in the cache
+         * @return 1 if it was not in the cache
+         */
+        inline u32 access(u32 vertex, u32 cacheSize = VERTEX_CACHE_SIZE)
+        {
+            if(time - insertion[vertex] <= cacheSize)
+                return 0;
+
+            insertion[vertex] = time++;
+            return 1;
+        }
+
+        /**
+         * @brief Empty the cache : all vertices are too old
+         */
+        inline void flush(u32 cacheSize = VERTEX_CACHE_SIZE)
+        {
+            time += cacheSize + 1;
+        }
+    };
+
+    float computeACMR(u32 const *indices, u32 numIndices, u32 numVertices, u32 cacheSize)
+    {
+        if(numIndices < 3)
+            return 0.0f;
+
+        VertexCache cache(numVertices);
+        u32 misses = 0;
+
+        cache.flush(cacheSize);
+
+        for(u32 i = 0; i < numIndices; ++i)
+            misses += cache.access(indices[i], cacheSize);
+
+        return (float)misses / (numIndices / 3);
+    }
+
+    void optimizeVertexCache(u32 *indices, u32 numIndices, u32 numVertices, vector<u32> &clusters)
+    {
+        u32 numTriangles = numIndices / 3;
+
+        clusters.clear();
+
+        if(numTriangles == 0)
+            return;
+
+        // Triangles around each vertex, packed in one array
+        vector<u32> offsets(numVertices + 1, 0);
+        vector<u32> adjacency(numTriangles * 3);
+
+        for(u32 i = 0; i < numTriangles * 3; ++i)
+            ++offsets[indices[i] + 1];
+
+        for(u32 i = 0; i < numVertices; ++i)
+            offsets[i + 1] += offsets[i];
+
+        vector<u32> live(numVertices);
+        vector<u32> fill(offsets.begin(), offsets.end() - 1);
+
+        for(u32 i = 0; i < numVertices; ++i)
+            live[i] = offsets[i + 1] - offsets[i];
+
+        for(u32 i = 0; i < numTriangles * 3; ++i)
+            adjacency[fill[indices[i]]++] = i / 3;
+
+        VertexCache cache(numVertices);
+        vector<u8> emitted(numTriangles, 0);
+        vector<u32> deadEnd;
+        vector<u32> candidates;
+        vector<u32> output;
+        u32 cursor = 0;
+        u32 fanning = indices[0];
+
+        deadEnd.reserve(numTriangles * 3);
+        output.reserve(numTriangles * 3);
+        clusters.push_back(0);
+
+        while(true)
+        {
+            candidates.clear();
+
+            // All triangles left around the fanning vertex
+            for(u32 a = offsets[fanning]; a < offsets[fanning + 1]; ++a)
+            {
+                u32 triangle = adjacency[a];
+
+                if(emitted[triangle])
+                    continue;
+
+                for(u32 k = 0; k < 3; ++k)
+                {
+                    u32 vertex = indices[triangle * 3 + k];
+
+                    output.push_back(vertex);
+                    deadEnd.push_back(vertex);
+                    candidates.push_back(vertex);
+                    --live[vertex];
+                    cache.access(vertex);
+                }
+
+                emitted[triangle] = 1;
+            }
+
+            // The oldest vertex which is still in the cache once its own fan is emitted
+            u32 next = ~0u;
+            s64 bestPriority = -1;
+
+            for(u32 vertex : candidates)
+            {
+                if(live[vertex] == 0)
+                    continue;
+
+                s64 priority = 0;
+                s64 age = cache.time - cache.insertion[vertex];
+
+                if(age + 2 * live[vertex] <= VERTEX_CACHE_SIZE)
+                    priority = age;
+
+                if(priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    next = vertex;
+                }
+            }
+
+            if(next != ~0u)
+            {
+                fanning = next;
+                continue;
+            }
+
+            // Dead end : the last vertices emitted, then the first vertex left in the mesh
+            while(!deadEnd.empty() && next == ~0u)
+            {
+                if(live[deadEnd.back()] > 0)
+                    next = deadEnd.back();
+
+                deadEnd.pop_back();
+            }
+
+            for(; cursor < numVertices && next == ~0u; ++cursor)
+                if(live[cursor] > 0)
+                    next = cursor;
+
+            if(next == ~0u)
+                break;
+
+            clusters.push_back(output.size() / 3);
+            fanning = next;
+        }
+
+        assert(output.size() == numTriangles * 3);
+
+        memcpy(indices, output.data(), output.size() * sizeof(u32));
+    }
+
+    void optimizeOverdraw(u32 *indices, u32 numIndices, vec3 const *positions, u32 numVertices,
+                          vector<u32> const &clusters, float threshold)
+    {
+        u32 numTriangles = numIndices / 3;
+
+        if(numTriangles == 0 || clusters.empty())
+            return;
+
+        // Clusters are split where they are still as good for the cache as the whole cluster
+        VertexCache cache(numVertices);
+        vector<u32> softClusters;
+
+        for(u32 c = 0; c < clusters.size(); ++c)
+        {
+            u32 begin = clusters[c];
+            u32 end = c + 1 < clusters.size() ? clusters[c + 1] : numTriangles;
+            u32 misses = 0;
+
+            cache.flush();
+
+            for(u32 i = begin * 3; i < end * 3; ++i)
+                misses += cache.access(indices[i]);
+
+            float acmr = (float)misses / (end - begin);
+            u32 start = begin;
+
+            misses = 0;
+            cache.flush();
+
+            for(u32 t = begin; t < end; ++t)
+            {
+                for(u32 k = 0; k < 3; ++k)
+                    misses += cache.access(indices[t * 3 + k]);
+
+                if(t + 1 < end && misses <= threshold * acmr * (t + 1 - start))
+                {
+                    softClusters.push_back(start);
+                    start = t + 1;
+                    misses = 0;
+                    cache.flush();
+                }
+            }
+
+            softClusters.push_back(start);
+        }
+
+        // Center and mean normal of each cluster, weighted by the area of its triangles
+        u32 numClusters = softClusters.size();
+        vector<vec3> centers(numClusters, vec3(0.0f));
+        vector<vec3> normals(numClusters, vec3(0.0f));
+        vector<float> areas(numClusters, 0.0f);
+        vec3 meshCenter(0.0f);
+        float meshArea = 0.0f;
+
+        for(u32 c = 0; c < numClusters; ++c)
+        {
+            u32 end = c + 1 < numClusters ? softClusters[c + 1] : numTriangles;
+
+            for(u32 t = softClusters[c]; t < end; ++t)
+            {
+                vec3 const &p0 = positions[indices[t * 3]];
+                vec3 const &p1 = positions[indices[t * 3 + 1]];
+                vec3 const &p2 = positions[indices[t * 3 + 2]];
+                vec3 normal = cross(p1 - p0, p2 - p0);
+                float area = length(normal);
+
+                centers[c] += (p0 + p1 + p2) * (area / 3.0f);
+                normals[c] += normal;
+                areas[c] += area;
+            }
+
+            meshCenter += centers[c];
+            meshArea += areas[c];
+
+            if(areas[c] > 0.0f)
+                centers[c] /= areas[c];
+        }
+
+        if(meshArea > 0.0f)
+            meshCenter /= meshArea;
+
+        // Clusters which face away from the center are in front of the others : drawn first
+        vector<float> keys(numClusters, 0.0f);
+        vector<u32> order(numClusters);
+
+        for(u32 c = 0; c < numClusters; ++c)
+        {
+            float normalLength = length(normals[c]);
+
+            if(normalLength > 0.0f)
+                keys[c] = dot(centers[c] - meshCenter, normals[c] / normalLength);
+
+            order[c] = c;
+        }
+
+        stable_sort(order.begin(), order.end(), [&keys](u32 a, u32 b){return keys[a] > keys[b];});
+
+        vector<u32> output;
+        output.reserve(numTriangles * 3);
+
+        for(u32 c : order)
+        {
+            u32 end = c + 1 < numClusters ? softClusters[c + 1] : numTriangles;
+            output.insert(output.end(), indices + softClusters[c] * 3, indices + end * 3);
+        }
+
+        memcpy(indices, output.data(), output.size() * sizeof(u32));
+    }
+
+    void optimizeVertexFetch(u32 *indices, u32 numIndices, Vertex *vertices, vec3 *positions, u32 numVertices)
+    {
+        vector<u32> remap(numVertices, ~0u);
+        u32 next = 0;
+
+        for(u32 i = 0; i < numIndices; ++i)
+        {
+            if(remap[indices[i]] == ~0u)
+                remap[indices[i]] = next++;
+
+            indices[i] = remap[indices[i]];
+        }
+
+        for(u32 i = 0; i < numVertices; ++i)
+            if(remap[i] == ~0u)
+                remap[i] = next++;
+
+        vector<Vertex> oldVertices(vertices, vertices + numVertices);
+        vector<vec3> oldPositions(positions, positions + numVertices);
+
+        for(u32 i = 0; i < numVertices; ++i)
+        {
+            vertices[remap[i]] = oldVertices[i];
+            positions[remap[i]] = oldPositions[i];
+        }
+    }
+
+    /**
+     * @brief Bounding box, bounding sphere and cone of normals of the triangles [first, last) of one mesh
+     */
+    static void clusterBounds(u32 const *indices, vec3 const *positions, u32 first, u32 last,
+                              AABB3D &box, ClusterCone &cone)
+    {
+        vec3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+        vec3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        vec3 axis(0.0f);
+
+        for(u32 t = first; t < last; ++t)
+        {
+            vec3 const &p0 = positions[indices[t * 3]];
+            vec3 const &p1 = positions[indices[t * 3 + 1]];
+            vec3 const &p2 = positions[indices[t * 3 + 2]];
+            vec3 normal = cross(p1 - p0, p2 - p0);
+            float normalLength = length(normal);
+
+            min = glm::min(min, glm::min(p0, glm::min(p1, p2)));
+            max = glm::max(max, glm::max(p0, glm::max(p1, p2)));
+
+            if(normalLength > 0.0f)
+                axis += normal / normalLength;
+        }
+
+        box = makeAABB3D(min, max);
+
+        vec3 center(box.center.x, box.center.y, box.center.z);
+        float radius = 0.0f;
+
+        for(u32 i = first * 3; i < last * 3; ++i)
+            radius = std::max(radius, length(positions[indices[i]] - center));
+
+        // Normals spread over more than a half sphere : the cluster always has front faces
+        float axisLength = length(axis);
+        float cutoff = 1.0f;
+
+        if(axisLength > 0.0f)
+        {
+            float minDot = 1.0f;
+
+            axis /= axisLength;
+
+            for(u32 t = first; t < last; ++t)
+            {
+                vec3 const &p0 = positions[indices[t * 3]];
+                vec3 normal = cross(positions[indices[t * 3 + 1]] - p0, positions[indices[t * 3 + 2]] - p0);
+                float normalLength = length(normal);
+
+                if(normalLength > 0.0f)
+                    minDot = std::min(minDot, dot(axis, normal / normalLength));
+            }
+
+            if(minDot > 0.0f)
+                cutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+
+        cone.centerRadius = vec4(center, radius);
+        cone.axisCutoff = vec4(axis, cutoff);
+    }
+
+    void buildClusters(u32 const *indices, vec3 const *positions, DrawElementCommand const &mesh,
+                       vector<DrawElementCommand> &commands, vector<AABB3D> &boxes, vector<ClusterCone> &cones)
+    {
+        u32 numTriangles = mesh.count / 3;
+        u32 numVertices = 0;
+
+        for(u32 i = 0; i < numTriangles * 3; ++i)
+            numVertices = std::max(numVertices, indices[i] + 1);
+
+        // First triangle of the cluster which owns each vertex
+        vector<u32> owner(numVertices, ~0u);
+        vec3 normal(0.0f);
+        u32 first = 0;
+
+        auto close = [&](u32 last)
+        {
+            DrawElementCommand command = mesh;
+            AABB3D box;
+            ClusterCone cone;
+
+            command.count = (last - first) * 3;
+            command.firstIndex = mesh.firstIndex + first * 3;
+            clusterBounds(indices, positions, first, last, box, cone);
+
+            commands.push_back(command);
+            boxes.push_back(box);
+            cones.push_back(cone);
+        };
+
+        for(u32 t = 0; t < numTriangles; ++t)
+        {
+            u32 const *triangle = indices + t * 3;
+            vec3 const &p0 = positions[triangle[0]];
+            vec3 triangleNormal = cross(positions[triangle[1]] - p0, positions[triangle[2]] - p0);
+            u32 size = t - first;
+
+            if(size >= MIN_CLUSTER_TRIANGLES)
+            {
+                bool connected = owner[triangle[0]] == first || owner[triangle[1]] == first || owner[triangle[2]] == first;
+
+                if(size >= MAX_CLUSTER_TRIANGLES || !connected || dot(triangleNormal, normal) < 0.0f)
+                {
+                    close(t);
+                    first = t;
+                    normal = vec3(0.0f);
+                }
+            }
+
+            for(u32 k = 0; k < 3; ++k)
+                owner[triangle[k]] = first;
+
+            float normalLength = length(triangleNormal);
+
+            if(normalLength > 0.0f)
+                normal += triangleNormal / normalLength;
+        }
+
+        if(numTriangles > 0)
+            close(numTriangles);
+    }
+}
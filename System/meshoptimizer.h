@@ -0,0 +1,86 @@
+/*!
+ * \file meshoptimizer.h
+ * \brief Reorder indices and vertices of meshes for the vertex cache, overdraw and vertex fetch, split them in clusters
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include "../include/include.h"
+
+namespace GXY
+{
+    static u32 const VERTEX_CACHE_SIZE = 16; //!< Entries of the FIFO post-transform cache which is simulated
+    static u32 const MAX_CLUSTER_TRIANGLES = 128; //!< Triangles of one cluster at most
+    static u32 const MIN_CLUSTER_TRIANGLES = 64; //!< Triangles of one cluster before it can end on a discontinuity
+
+    /**
+     * @brief Simulate a FIFO post-transform cache over the triangles
+     * @param[in] indices : Indices of triangles, relative to the mesh
+     * @param[in] numIndices : Number of indices
+     * @param[in] numVertices : Number of vertices of the mesh
+     * @param[in] cacheSize : Entries of the cache
+     * @return ACMR : vertices transformed by triangle, 0.5 at best and 3 at worst
+     */
+    float computeACMR(u32 const *indices, u32 numIndices, u32 numVertices, u32 cacheSize = VERTEX_CACHE_SIZE);
+
+    /**
+     * @brief Reorder triangles for the post-transform cache (Tipsify, Sander et al. 2007)
+     *
+     * Triangles are emitted in fans around one vertex, the next one is taken among the vertices
+     * still in the cache, or from the dead-end stack when there is none.
+     * @param[in, out] indices : Indices of triangles, relative to the mesh
+     * @param[in] numIndices : Number of indices
+     * @param[in] numVertices : Number of vertices of the mesh
+     * @param[out] clusters : First triangle of each cluster : the cache is cold at each of them
+     */
+    void optimizeVertexCache(u32 *indices, u32 numIndices, u32 numVertices, std::vector<u32> &clusters);
+
+    /**
+     * @brief Reorder the clusters given by optimizeVertexCache to draw the outside of the mesh first
+     *
+     * Clusters are split while their ACMR stays within threshold times the one of the whole cluster,
+     * then sorted by how much they face away from the center of the mesh.
+     * @param[in, out] indices : Indices of triangles, relative to the mesh
+     * @param[in] numIndices : Number of indices
+     * @param[in] positions : Positions of the vertices
+     * @param[in] numVertices : Number of vertices of the mesh
+     * @param[in] clusters : First triangle of each cluster
+     * @param[in] threshold : ACMR allowed to be lost, 1.05 for 5%
+     */
+    void optimizeOverdraw(u32 *indices, u32 numIndices, glm::vec3 const *positions, u32 numVertices,
+                          std::vector<u32> const &clusters, float threshold);
+
+    /**
+     * @brief Renumber the vertices in the order of their first use : vertex fetch reads memory forward
+     *
+     * Vertices which are never used go at the end
+     * @param[in, out] indices : Indices of triangles, relative to the mesh
+     * @param[in] numIndices : Number of indices
+     * @param[in, out] vertices : Vertices of the mesh
+     * @param[in, out] positions : Positions of these vertices
+     * @param[in] numVertices : Number of vertices of the mesh
+     */
+    void optimizeVertexFetch(u32 *indices, u32 numIndices, Vertex *vertices, glm::vec3 *positions, u32 numVertices);
+
+    /**
+     * @brief Split one mesh in clusters of consecutive triangles, each one is culled on its own
+     *
+     * A cluster ends at MAX_CLUSTER_TRIANGLES, or after MIN_CLUSTER_TRIANGLES on the first triangle
+     * which shares no vertex with it or faces away from its mean normal. Run it after optimizeOverdraw :
+     * consecutive triangles are close to each other.
+     * @param[in] indices : Indices of triangles of the mesh, relative to the mesh
+     * @param[in] positions : Positions of the vertices of the mesh
+     * @param[in] mesh : Command of the whole mesh
+     * @param[out] commands : One command by cluster is appended, in the range of the mesh
+     * @param[out] boxes : Bounding box of each cluster is appended
+     * @param[out] cones : Bounding sphere and cone of normals of each cluster is appended
+     */
+    void buildClusters(u32 const *indices, glm::vec3 const *positions, DrawElementCommand const &mesh,
+                       std::vector<DrawElementCommand> &commands, std::vector<AABB3D> &boxes,
+                       std::vector<ClusterCone> &cones);
+}
+
+#endif // MESHOPTIMIZER_H
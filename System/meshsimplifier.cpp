@@ -0,0 +1,301 @@
+/*!
+ * \file meshsimplifier.cpp
+ * \brief Simplify meshes by quadric edge collapses, for their levels of detail
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#include "meshsimplifier.h"
+#include <unordered_set>
+
+using namespace std;
+using namespace glm;
+
+namespace GXY
+{
+    static float const FLIP_COSINE = 0.25f; //!< A triangle which turns more than that refuses the collapse
+
+    /**
+     * @brief Sum of squared distances to planes, weighted by their area : p.A.p + 2 b.p + c
+     */
+    struct Quadric
+    {
+        double a00, a01, a02, a11, a12, a22; //!< Symmetric matrix A
+        double b0, b1, b2; //!< Vector b
+        double c; //!< Constant
+        double weight; //!< Sum of the areas
+
+        Quadric(void) : a00(0.0), a01(0.0), a02(0.0), a11(0.0), a12(0.0), a22(0.0),
+                        b0(0.0), b1(0.0), b2(0.0), c(0.0), weight(0.0){}
+
+        /**
+         * @brief Add the plane dot(normal, p) + d = 0
+         */
+        void addPlane(vec3 const &normal, float d, float area)
+        {
+            a00 += area * normal.x * normal.x;
+            a01 += area * normal.x * normal.y;
+            a02 += area * normal.x * normal.z;
+            a11 += area * normal.y * normal.y;
+            a12 += area * normal.y * normal.z;
+            a22 += area * normal.z * normal.z;
+            b0 += area * normal.x * d;
+            b1 += area * normal.y * d;
+            b2 += area * normal.z * d;
+            c += area * d * d;
+            weight += area;
+        }
+
+        Quadric &operator+=(Quadric const &q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02;
+            a11 += q.a11; a12 += q.a12; a22 += q.a22;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            weight += q.weight;
+
+            return *this;
+        }
+
+        /**
+         * @brief Mean squared distance between p and the planes
+         */
+        double error(vec3 const &p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a00 * x * x + a11 * y * y + a22 * z * z +
+                       2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                       2.0 * (b0 * x + b1 * y + b2 * z) + c;
+
+            return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+        }
+    };
+
+    float simplifyMesh(u32 const *indices, u32 numIndices, vec3 const *positions, u32 numVertices,
+                       u32 targetIndices, float maxError, vector<u32> &simplified)
+    {
+        // Vertices at the same position : one seam of attributes, they move together or not at all
+        vector<u32> canonical(numVertices);
+        vector<u8> locked(numVertices, 0);
+        vector<u32> order(numVertices);
+
+        for(u32 i = 0; i < numVertices; ++i)
+            order[i] = i;
+
+        sort(order.begin(), order.end(), [positions](u32 a, u32 b)
+        {
+            vec3 const &pa = positions[a];
+            vec3 const &pb = positions[b];
+
+            return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z != pb.z ? pa.z < pb.z : a < b;
+        });
+
+        for(u32 i = 0; i < numVertices; ++i)
+        {
+            canonical[order[i]] = order[i];
+
+            if(i > 0 && positions[order[i]] == positions[order[i - 1]])
+            {
+                canonical[order[i]] = canonical[order[i - 1]];
+                locked[canonical[order[i]]] = 1;
+            }
+        }
+
+        simplified.clear();
+        simplified.reserve(numIndices);
+
+        for(u32 t = 0; t < numIndices / 3; ++t)
+        {
+            u32 c0 = canonical[indices[t * 3]], c1 = canonical[indices[t * 3 + 1]], c2 = canonical[indices[t * 3 + 2]];
+
+            if(c0 != c1 && c1 != c2 && c0 != c2)
+                simplified.insert(simplified.end(), indices + t * 3, indices + t * 3 + 3);
+        }
+
+        // An edge without its opposite is on the border
+        unordered_set<u64> edges;
+        vector<Quadric> quadrics(numVertices);
+
+        for(u32 i = 0; i < simplified.size(); i += 3)
+        {
+            u32 c[3] = {canonical[simplified[i]], canonical[simplified[i + 1]], canonical[simplified[i + 2]]};
+            vec3 const &p0 = positions[c[0]];
+            vec3 normal = cross(positions[c[1]] - p0, positions[c[2]] - p0);
+            float area = length(normal);
+
+            for(u32 k = 0; k < 3; ++k)
+                edges.insert((u64)c[k] << 32 | c[(k + 1) % 3]);
+
+            if(area > 0.0f)
+            {
+                normal /= area;
+
+                for(u32 k = 0; k < 3; ++k)
+                    quadrics[c[k]].addPlane(normal, -dot(normal, p0), area);
+            }
+        }
+
+        for(u64 edge : edges)
+        {
+            if(edges.count(edge << 32 | edge >> 32) == 0)
+                locked[edge >> 32] = locked[edge & 0xFFFFFFFF] = 1;
+        }
+
+        vector<u32> offsets(numVertices + 1);
+        vector<u32> adjacency;
+        vector<u32> fill;
+        vector<double> bestCost(numVertices);
+        vector<u32> bestTarget(numVertices);
+        vector<u32> sources;
+        vector<u8> touched(numVertices);
+        vector<u32> remap(numVertices);
+        double maxErrorSquared = (double)maxError * maxError;
+        double error = 0.0;
+
+        // Each pass does the cheapest collapses which do not touch each other
+        while(simplified.size() > targetIndices)
+        {
+            u32 numTriangles = simplified.size() / 3;
+
+            std::fill(offsets.begin(), offsets.end(), 0);
+
+            for(u32 vertex : simplified)
+                ++offsets[canonical[vertex] + 1];
+
+            for(u32 i = 0; i < numVertices; ++i)
+                offsets[i + 1] += offsets[i];
+
+            adjacency.resize(simplified.size());
+            fill.assign(offsets.begin(), offsets.end() - 1);
+
+            for(u32 i = 0; i < simplified.size(); ++i)
+                adjacency[fill[canonical[simplified[i]]]++] = i / 3;
+
+            // The cheapest edge leaving each free vertex
+            std::fill(bestCost.begin(), bestCost.end(), DBL_MAX);
+            sources.clear();
+
+            for(u32 i = 0; i < simplified.size(); ++i)
+            {
+                u32 a = canonical[simplified[i]];
+
+                if(locked[a])
+                    continue;
+
+                for(u32 k = 1; k < 3; ++k)
+                {
+                    u32 b = simplified[i - i % 3 + (i + k) % 3];
+                    Quadric q = quadrics[a];
+
+                    q += quadrics[canonical[b]];
+
+                    double cost = q.error(positions[b]);
+
+                    if(cost < bestCost[a])
+                    {
+                        if(bestCost[a] == DBL_MAX)
+                            sources.push_back(a);
+
+                        bestCost[a] = cost;
+                        bestTarget[a] = b;
+                    }
+                }
+            }
+
+            sort(sources.begin(), sources.end(), [&bestCost](u32 a, u32 b){return bestCost[a] < bestCost[b];});
+
+            std::fill(touched.begin(), touched.end(), 0);
+
+            for(u32 i = 0; i < numVertices; ++i)
+                remap[i] = i;
+
+            u32 toRemove = numTriangles - targetIndices / 3;
+            u32 removed = 0;
+            u32 collapses = 0;
+
+            for(u32 a : sources)
+            {
+                if(removed >= toRemove || bestCost[a] > maxErrorSquared)
+                    break;
+
+                u32 b = bestTarget[a];
+                u32 cb = canonical[b];
+
+                if(touched[a] || touched[cb])
+                    continue;
+
+                // Triangles around a, except those which disappear, must not turn over
+                bool flip = false;
+
+                for(u32 j = offsets[a]; j < offsets[a + 1] && !flip; ++j)
+                {
+                    u32 const *triangle = &simplified[adjacency[j] * 3];
+                    vec3 p[3], q[3];
+                    bool removedTriangle = false;
+
+                    for(u32 k = 0; k < 3; ++k)
+                    {
+                        u32 c = canonical[triangle[k]];
+
+                        removedTriangle = removedTriangle || c == cb;
+                        p[k] = positions[c];
+                        q[k] = c == a ? positions[cb] : p[k];
+                    }
+
+                    if(removedTriangle)
+                        continue;
+
+                    vec3 before = cross(p[1] - p[0], p[2] - p[0]);
+                    vec3 after = cross(q[1] - q[0], q[2] - q[0]);
+
+                    flip = dot(before, after) < FLIP_COSINE * length(before) * length(after);
+                }
+
+                if(flip)
+                    continue;
+
+                remap[a] = b;
+                quadrics[cb] += quadrics[a];
+                error = std::max(error, bestCost[a]);
+                ++collapses;
+
+                for(u32 j = offsets[a]; j < offsets[a + 1]; ++j)
+                {
+                    u32 const *triangle = &simplified[adjacency[j] * 3];
+                    bool removedTriangle = false;
+
+                    for(u32 k = 0; k < 3; ++k)
+                    {
+                        touched[canonical[triangle[k]]] = 1;
+                        removedTriangle = removedTriangle || canonical[triangle[k]] == cb;
+                    }
+
+                    removed += removedTriangle;
+                }
+            }
+
+            if(collapses == 0)
+                break;
+
+            // Triangles which lost one edge are gone
+            u32 write = 0;
+
+            for(u32 i = 0; i < simplified.size(); i += 3)
+            {
+                u32 v0 = remap[simplified[i]], v1 = remap[simplified[i + 1]], v2 = remap[simplified[i + 2]];
+                u32 c0 = canonical[v0], c1 = canonical[v1], c2 = canonical[v2];
+
+                if(c0 == c1 || c1 == c2 || c0 == c2)
+                    continue;
+
+                simplified[write++] = v0;
+                simplified[write++] = v1;
+                simplified[write++] = v2;
+            }
+
+            simplified.resize(write);
+        }
+
+        return (float)std::sqrt(error);
+    }
+}
@@ -0,0 +1,36 @@
+/*!
+ * \file meshsimplifier.h
+ * \brief Simplify meshes by quadric edge collapses, for their levels of detail
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include "../include/include.h"
+
+namespace GXY
+{
+    /**
+     * @brief Simplify one mesh by collapsing edges onto one of their vertices (Garland and Heckbert)
+     *
+     * The simplified mesh only uses vertices of the mesh : its indices go in the same index range.
+     * Each vertex owns the quadric of the planes of its triangles, weighted by their area, and the cheapest
+     * collapses are done first while the error stays under maxError. Vertices on borders and on seams of
+     * attributes (same position, other normal or texture coordinate) never move, and collapses which
+     * flip one triangle are refused.
+     * @param[in] indices : Indices of triangles, relative to the mesh
+     * @param[in] numIndices : Number of indices
+     * @param[in] positions : Positions of the vertices
+     * @param[in] numVertices : Number of vertices of the mesh
+     * @param[in] targetIndices : Number of indices to reach
+     * @param[in] maxError : Largest distance allowed between the simplified mesh and the mesh
+     * @param[out] simplified : Indices of the simplified mesh, relative to the mesh
+     * @return the error of the simplified mesh, as a distance
+     */
+    float simplifyMesh(u32 const *indices, u32 numIndices, glm::vec3 const *positions, u32 numVertices,
+                       u32 targetIndices, float maxError, std::vector<u32> &simplified);
+}
+
+#endif // MESHSIMPLIFIER_H
@@ -9,13 +9,28 @@
 #include "device.h"
 #include "vertexarray.h"
 #include "shader.h"
+#include "meshcache.h"
+#include "meshoptimizer.h"
+#include "meshsimplifier.h"
+#include "../SceneManager/scenemanager.h"
 
 using namespace std;
 using namespace glm;
 using namespace Assimp;
 
 namespace GXY
-{    
+{
+    static u32 const IMPORT_FLAGS = aiProcessPreset_TargetRealtime_Quality | aiProcess_FlipUVs; //!< Part of the key of the MeshCache
+    static float const OVERDRAW_THRESHOLD = 1.05f; //!< ACMR given up to draw the outside of meshes first
+    static u32 const MAX_LODS = 4; //!< Levels of detail of one mesh, the mesh itself included
+    static u32 const MIN_LOD_TRIANGLES = 64; //!< Meshes are not simplified under that
+    static float const MIN_LOD_REDUCTION = 0.75f; //!< One level keeps at most that part of the triangles of the previous one
+    static float const MAX_LOD_ERROR = 0.05f; //!< Largest error of one level, relative to the diagonal of its mesh
+    static float const LOD_PIXEL_ERROR = 1.0f; //!< Error on the screen, in pixels, allowed by the choice of the level
+    static char const *const LOD_TRIANGLES[MAX_LODS] = {"lod0Triangles", "lod1Triangles", "lod2Triangles", "lod3Triangles"}; //!< Counters of each level
+    static u32 const PROXY_REDUCTION = 8; //!< A proxy keeps one triangle out of that, at most
+    static float const PROXY_MAX_ERROR = 0.01f; //!< Largest error of one proxy, relative to its diagonal
+
     string getDir(string const &path)
     {
         size_t last = path.find_last_of('/');
@@ -29,31 +44,382 @@ namespace GXY
         return dir;
     }
 
+#ifdef GXY_COMPACT_VERTEX
+    static inline s16 toSnorm16(float value)
+    {
+        return (s16)std::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f);
+    }
+
+    static inline float fromSnorm16(s16 value)
+    {
+        return std::max(value / 32767.0f, -1.0f);
+    }
+
+    /**
+     * @brief Fold one unit vector on the octahedron, then unfold it in a square
+     * @param[in] v : Vector, not null
+     * @param[out] encoded : Coordinates in the square, snorm16
+     */
+    static void packOctahedral(vec3 const &v, s16 *encoded)
+    {
+        vec3 n = v / (std::abs(v.x) + std::abs(v.y) + std::abs(v.z));
+        vec2 e(n.x, n.y);
+
+        // Lower half : folded over the diagonals
+        if(n.z < 0.0f)
+            e = vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                     (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+
+        encoded[0] = toSnorm16(e.x);
+        encoded[1] = toSnorm16(e.y);
+    }
+
+    /**
+     * @brief Unfold the square on the octahedron, inverse of packOctahedral
+     * @param[in] encoded : Coordinates in the square, snorm16
+     * @return unit vector
+     */
+    static vec3 unpackOctahedral(s16 const *encoded)
+    {
+        vec2 e(fromSnorm16(encoded[0]), fromSnorm16(encoded[1]));
+        vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+
+        if(n.z < 0.0f)
+            n = vec3((1.0f - std::abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f),
+                     (1.0f - std::abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f), n.z);
+
+        return normalize(n);
+    }
+
+    /**
+     * @brief Convert one float in half float, rounded to the nearest
+     */
+    static u16 toHalf(float value)
+    {
+        u32 bits;
+        memcpy(&bits, &value, sizeof bits);
+
+        u32 sign = (bits >> 16) & 0x8000;
+        s32 exponent = (s32)((bits >> 23) & 0xFF) - 127 + 15;
+        u32 mantissa = bits & 0x7FFFFF;
+
+        // Too large, infinite or NaN
+        if(exponent >= 31)
+            return sign | 0x7C00;
+
+        // Denormalized, or too small
+        if(exponent <= 0)
+        {
+            if(exponent < -10)
+                return sign;
+
+            mantissa |= 0x800000;
+            u32 shift = 14 - exponent;
+            u32 half = mantissa >> shift;
+
+            if((mantissa >> (shift - 1)) & 1)
+                ++half;
+
+            return sign | half;
+        }
+
+        // A carry of the rounding goes in the exponent, as it should
+        u32 half = sign | ((u32)exponent << 10) | (mantissa >> 13);
+
+        if(mantissa & 0x1000)
+            ++half;
+
+        return half;
+    }
+#endif
+
+    /**
+     * @brief Make one Vertex, packed if GXY_COMPACT_VERTEX
+     * @return the Vertex, its position is in Global::Model.vertexDepth only if packed
+     */
+    static Vertex makeVertex(vec3 const &position, vec3 const &normal, vec3 const &tangent,
+                             vec3 const &biTangent, vec2 const &texCoord, u32 materialIndex)
+    {
+        Vertex vertex;
+
+#ifdef GXY_COMPACT_VERTEX
+        (void)position;
+
+        packOctahedral(normal, vertex.normal);
+        packOctahedral(tangent, vertex.tangent);
+        vertex.texCoord[0] = toHalf(texCoord.x);
+        vertex.texCoord[1] = toHalf(texCoord.y);
+        vertex.materialIndex = materialIndex;
+        vertex.biTangentSign = dot(cross(normal, tangent), biTangent) < 0.0f ? -32767 : 32767;
+#else
+        vertex.position = position;
+        vertex.normal = normal;
+        vertex.tangent = tangent;
+        vertex.biTangent = biTangent;
+        vertex.texCoord = texCoord;
+        vertex.materialIndex = materialIndex;
+#endif
+
+        return vertex;
+    }
+
+    /**
+     * @brief Move one Vertex in the space of a proxy
+     * @param[in] vertex : The Vertex
+     * @param[in] position : Its position, already moved
+     * @param[in] linear : Linear part of the matrix, for tangents
+     * @param[in] normalMatrix : Inverse transpose of linear, for normals
+     * @param[in] materialIndex : Index of its material in the proxy
+     * @return the Vertex moved
+     */
+    static Vertex transformVertex(Vertex const &vertex, vec3 const &position, mat3 const &linear,
+                                  mat3 const &normalMatrix, u32 materialIndex)
+    {
+        Vertex moved = vertex;
+
+#ifdef GXY_COMPACT_VERTEX
+        (void)position;
+
+        packOctahedral(normalMatrix * unpackOctahedral(vertex.normal), moved.normal);
+        packOctahedral(linear * unpackOctahedral(vertex.tangent), moved.tangent);
+
+        // A mirror turns the bitangent over, against cross(normal, tangent)
+        if(determinant(linear) < 0.0f)
+            moved.biTangentSign = -vertex.biTangentSign;
+#else
+        moved.position = position;
+        moved.normal = normalize(normalMatrix * vertex.normal);
+        moved.tangent = linear * vertex.tangent;
+        moved.biTangent = linear * vertex.biTangent;
+#endif
+        moved.materialIndex = materialIndex;
+
+        return moved;
+    }
+
+    /**
+     * @brief Asset of one Model between its import and the end of its upload
+     */
+    struct ModelImport
+    {
+        ModelImport(string const &path) :
+            cache(path, IMPORT_FLAGS), baseVertex(0), baseIndex(0), baseMaterial(0),
+            copiedVertices(0), copiedIndices(0), reserved(false){}
+
+        MeshCache cache; //!< File mapped, if it is valid
+        MeshData data; //!< Data imported by Assimp, if the file is not valid
+        MeshView view; //!< Data to upload, in cache or in data
+        vector<shared_ptr<AsyncRessource<Texture>>> textures; //!< Texture of each material, nullptr if none
+        u32 baseVertex, baseIndex, baseMaterial; //!< Where the Model begins in the Buffers
+        u32 copiedVertices, copiedIndices; //!< Elements already copied
+        bool reserved; //!< Materials are pushed and the Buffers have room for the Model
+    };
+
+    /**
+     * @brief Clusters of all levels of detail of one mesh, built on its own thread
+     */
+    struct MeshClusters
+    {
+        vector<DrawElementCommand> commands; //!< Command of each cluster
+        vector<AABB3D> boxes; //!< Bounding box of each cluster
+        vector<ClusterCone> cones; //!< Bounding sphere and cone of normals of each cluster
+        vector<ClusterLod> lods; //!< Level of detail of each cluster
+        vector<u32> firstCluster; //!< First cluster of each level, and the end of the last one
+        vector<vector<u32>> lodIndices; //!< Indices of each simplified level, relative to the mesh : firstIndex is 0 in their commands
+    };
+
+    /**
+     * @brief Take one slice in the budget, at least one element so the upload always ends
+     * @param[in] remaining : Elements not copied yet
+     * @param[in] size : Bytes of one element
+     * @param[in, out] budget : Bytes left for this frame
+     * @return number of elements to copy
+     */
+    static u32 slice(u32 remaining, size_t size, size_t &budget)
+    {
+        u32 count = std::min<size_t>(remaining, std::max<size_t>(budget / size, 1));
+
+        budget -= std::min(budget, count * size);
+
+        return count;
+    }
+
     Model::Model()
     {
 
     }
 
-    void Model::load(const string &path)
+    void Model::import(const string &path)
+    {
+        GXY_ZONE("Model::import");
+
+        unique_ptr<ModelImport> pending(new ModelImport(path));
+
+        mPath = path;
+
+        // Warm start : the file is mapped and copied in the Buffers, Assimp is not called
+        if(pending->cache.map(pending->view))
+            GXY_COUNTER("meshCacheHits", 1);
+
+        else
+        {
+            mImport(path, pending->data);
+            pending->view = pending->data.view();
+            pending->cache.write(pending->view);
+        }
+
+        // Other jobs decode them while the Model waits for its upload
+        for(auto const &texturePath : pending->view.texturePaths)
+            pending->textures.push_back(texturePath.empty() ? nullptr : global->ressourceManager->getTextureAsync(texturePath));
+
+        mPending = move(pending);
+    }
+
+    void Model::bake(vector<ProxySource> const &sources)
+    {
+        GXY_ZONE("Model::bake");
+
+        unique_ptr<ModelImport> pending(new ModelImport(string()));
+        MeshData &data = pending->data;
+        map<string, u32> firstMaterials; // Each asset gives its materials once
+        vector<u32> indices;
+
+        for(auto const &source : sources)
+        {
+            MeshCache cache(source.path, IMPORT_FLAGS);
+            MeshView view;
+
+            if(!cache.map(view))
+            {
+                cerr << "No valid mesh cache for " << source.path << " : left out of the proxy" << endl;
+                continue;
+            }
+
+            auto firstMaterial = firstMaterials.find(source.path);
+
+            if(firstMaterial == firstMaterials.end())
+            {
+                firstMaterial = firstMaterials.insert(make_pair(source.path, (u32)data.materials.size())).first;
+                data.materials.insert(data.materials.end(), view.materials, view.materials + view.texturePaths.size());
+                data.texturePaths.insert(data.texturePaths.end(), view.texturePaths.begin(), view.texturePaths.end());
+            }
+
+            u32 baseVertex = data.positions.size();
+            mat3 linear(source.transform);
+            mat3 normalMatrix = inverseTranspose(linear);
+
+            for(u32 i = 0; i < view.numVertices; ++i)
+            {
+                vec3 position = (source.transform * vec4(view.positions[i], 1.0f)).xyz();
+
+                data.positions.push_back(position);
+                data.vertices.push_back(transformVertex(view.vertices[i], position, linear, normalMatrix,
+                                                        view.vertices[i].materialIndex + firstMaterial->second));
+            }
+
+            // Only the finest level of each mesh, the proxy is simplified as a whole
+            for(u32 i = 0; i < view.numClusters; ++i)
+            {
+                DrawElementCommand const &command = view.clustersCommand[i];
+
+                if(view.clustersLod[i].meshExtent.w >= 0.0f)
+                    continue;
+
+                for(u32 j = 0; j < command.count; ++j)
+                    indices.push_back(view.indices[command.firstIndex + j] + command.baseVertex + baseVertex);
+            }
+        }
+
+        if(indices.empty())
+            throw Except("Proxy without triangles : no Model has a valid mesh cache");
+
+        u32 numVertices = data.positions.size();
+        vec3 minProxy(FLT_MAX, FLT_MAX, FLT_MAX);
+        vec3 maxProxy(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+        for(auto const &position : data.positions)
+        {
+            minProxy = glm::min(minProxy, position);
+            maxProxy = glm::max(maxProxy, position);
+        }
+
+        vector<u32> cacheClusters;
+
+        simplifyMesh(indices.data(), indices.size(), data.positions.data(), numVertices,
+                     (indices.size() / 3 / PROXY_REDUCTION) * 3, PROXY_MAX_ERROR * length(maxProxy - minProxy), data.indices);
+
+        optimizeVertexCache(data.indices.data(), data.indices.size(), numVertices, cacheClusters);
+        optimizeOverdraw(data.indices.data(), data.indices.size(), data.positions.data(), numVertices, cacheClusters, OVERDRAW_THRESHOLD);
+        optimizeVertexFetch(data.indices.data(), data.indices.size(), data.vertices.data(), data.positions.data(), numVertices);
+
+        // Vertices left out by the simplification are at the end
+        u32 usedVertices = 0;
+
+        for(auto index : data.indices)
+            usedVertices = std::max(usedVertices, index + 1);
+
+        data.vertices.resize(usedVertices);
+        data.positions.resize(usedVertices);
+
+        minProxy = vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+        maxProxy = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+        for(auto const &position : data.positions)
+        {
+            minProxy = glm::min(minProxy, position);
+            maxProxy = glm::max(maxProxy, position);
+        }
+
+        DrawElementCommand command;
+
+        command.count = data.indices.size();
+        command.primCount = 1;
+        command.firstIndex = 0;
+        command.baseVertex = 0;
+        command.baseInstance = 0;
+
+        buildClusters(data.indices.data(), data.positions.data(), command, data.clustersCommand, data.clustersAABB, data.clustersCone);
+
+        // One level, drawn whenever the proxy is chosen
+        ClusterLod lod;
+
+        lod.meshCenter = vec4((minProxy + maxProxy) * 0.5f, 0.0f);
+        lod.meshExtent = vec4((maxProxy - minProxy) * 0.5f, -1.0f);
+
+        data.clustersLod.assign(data.clustersCommand.size(), lod);
+        data.aabb = makeAABB3D(minProxy, maxProxy);
+
+        GXY_COUNTER("bakedProxies", 1);
+        GXY_COUNTER("proxySources", sources.size());
+        GXY_COUNTER("proxySourceTriangles", indices.size() / 3);
+        GXY_COUNTER("proxyTriangles", data.indices.size() / 3);
+        GXY_COUNTER("clusters", data.clustersCommand.size());
+
+        pending->view = data.view();
+
+        // Textures are already loaded for the sources, they are shared
+        for(auto const &texturePath : pending->view.texturePaths)
+            pending->textures.push_back(texturePath.empty() ? nullptr : global->ressourceManager->getTextureAsync(texturePath));
+
+        mPending = move(pending);
+    }
+
+    void Model::mImport(string const &path, MeshData &data)
     {
+        GXY_ZONE("Model::mImport");
         Importer imp;
 
         vec3 minTotal(FLT_MAX, FLT_MAX, FLT_MAX);
-        vec3 maxTotal(FLT_MIN, FLT_MIN, FLT_MIN);
-
-        bool isReallocateVertex = false;
-        bool isReallocateIndex = false;
-        bool isReallocateMaterial = false;
+        vec3 maxTotal(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 
-        aiScene const *scene = imp.ReadFile(path, aiProcessPreset_TargetRealtime_Quality | aiProcess_FlipUVs);
+        aiScene const *scene = imp.ReadFile(path, IMPORT_FLAGS);
 
         if(scene == NULL)
             throw Except("Impossible to open : " + path);
 
-        // For command rendering, to know where we have to take data
-        u32 baseVertex = global->Model.vertex->numElements();
-        u32 baseIndex = global->Model.index->numElements();
-        u32 baseMaterial = global->Model.material->numElements();
+        // Relative to the Model, mUpload adds where its data begin in the Buffers
+        u32 baseVertex = 0;
+        u32 baseIndex = 0;
 
         // Loading materials
         for(u32 i = 0; i < scene->mNumMaterials; ++i)
@@ -61,6 +427,7 @@ namespace GXY
             aiMaterial *current = scene->mMaterials[i];
             aiString texPath;
             Material material;
+            string totalPath;
 
             if(current->GetTexture(aiTextureType_DIFFUSE, 0, &texPath) == AI_SUCCESS)
             {
@@ -84,9 +451,7 @@ namespace GXY
                     ++it;
                 }
 
-                string totalPath = getDir(path) + CtexPath;
-                u64 handle = global->ressourceManager->getTexture(totalPath)->getHandle(0);
-                memcpy(&material.textureHandleUseTexture, &handle, sizeof handle);
+                totalPath = getDir(path) + CtexPath;
                 material.textureHandleUseTexture.z = 1.0;
             }
 
@@ -101,77 +466,237 @@ namespace GXY
             }
 
             material.shininessAlbedo = vec4(0.0, 1.0, 0.0, 0.0);
-            global->Model.material->push(material, isReallocateMaterial);
+            data.materials.push_back(material);
+            data.texturePaths.push_back(totalPath);
         }
 
-        mMeshesAABB.resize(scene->mNumMeshes);
-        mMeshesCommand.resize(scene->mNumMeshes);
+        vector<DrawElementCommand> meshesCommand(scene->mNumMeshes);
+
+        GXY_COUNTER("meshes", scene->mNumMeshes);
 
         for(u32 i = 0; i < scene->mNumMeshes; ++i)
         {
             aiMesh *mesh = scene->mMeshes[i];
 
-            vec3 min(FLT_MAX, FLT_MAX, FLT_MAX);
-            vec3 max(FLT_MIN, FLT_MIN, FLT_MIN);
-
             // Vertex
             for(u32 j = 0; j < mesh->mNumVertices ; ++j)
             {
-                Vertex vertex;
-                vec3 position;
-
-                position = vertex.position = vec3(mesh->mVertices[j].x, mesh->mVertices[j].y, mesh->mVertices[j].z);
-                vertex.normal = vec3(mesh->mNormals[j].x, mesh->mNormals[j].y, mesh->mNormals[j].z);
-                vertex.tangent = vec3(mesh->mTangents[j].x, mesh->mTangents[j].y, mesh->mTangents[j].z);
-                vertex.biTangent = vec3(mesh->mBitangents[j].x, mesh->mBitangents[j].y, mesh->mBitangents[j].z);
+                vec3 position(mesh->mVertices[j].x, mesh->mVertices[j].y, mesh->mVertices[j].z);
+                vec2 texCoord(0.0f);
 
                 if(mesh->HasTextureCoords(0))
-                    vertex.texCoord = vec2(mesh->mTextureCoords[0][j].x, mesh->mTextureCoords[0][j].y);
-
-                vertex.materialIndex = mesh->mMaterialIndex + baseMaterial;
-
-                global->Model.vertex->push(vertex, isReallocateVertex);
-                global->Model.vertexDepth->push(position, isReallocateVertex);
+                    texCoord = vec2(mesh->mTextureCoords[0][j].x, mesh->mTextureCoords[0][j].y);
 
-                min = glm::min(min, position);
-                max = glm::max(max, position);
+                data.vertices.push_back(makeVertex(position,
+                                                   vec3(mesh->mNormals[j].x, mesh->mNormals[j].y, mesh->mNormals[j].z),
+                                                   vec3(mesh->mTangents[j].x, mesh->mTangents[j].y, mesh->mTangents[j].z),
+                                                   vec3(mesh->mBitangents[j].x, mesh->mBitangents[j].y, mesh->mBitangents[j].z),
+                                                   texCoord, mesh->mMaterialIndex));
+                data.positions.push_back(position);
 
                 minTotal = glm::min(minTotal, position);
                 maxTotal = glm::max(maxTotal, position);
             }
 
+            GXY_COUNTER("vertices", mesh->mNumVertices);
+            GXY_COUNTER("triangles", mesh->mNumFaces);
+
             // Index
             for(u32 j = 0; j < mesh->mNumFaces; ++j)
                 for(u32 k = 0; k < 3; ++k)
-                    global->Model.index->push(mesh->mFaces[j].mIndices[k], isReallocateIndex);
+                    data.indices.push_back(mesh->mFaces[j].mIndices[k]);
 
             // Command
-            mMeshesCommand[i].count = mesh->mNumFaces * 3;
-            mMeshesCommand[i].primCount = 1;
-            mMeshesCommand[i].firstIndex = baseIndex;
-            mMeshesCommand[i].baseVertex = baseVertex;
-            mMeshesCommand[i].baseInstance = 0;
+            meshesCommand[i].count = mesh->mNumFaces * 3;
+            meshesCommand[i].primCount = 1;
+            meshesCommand[i].firstIndex = baseIndex;
+            meshesCommand[i].baseVertex = baseVertex;
+            meshesCommand[i].baseInstance = 0;
 
             // Update
             baseIndex += mesh->mNumFaces * 3;
             baseVertex += mesh->mNumVertices;
+        }
+
+        // Done once by import : the MeshCache keeps meshes optimized and split
+        vector<MeshClusters> clusters(scene->mNumMeshes);
+
+        global->jobSystem->parallelFor(0, scene->mNumMeshes, 1, [&](u32 i)
+        {
+            GXY_ZONE("Optimize mesh");
+
+            DrawElementCommand const &command = meshesCommand[i];
+            u32 numVertices = scene->mMeshes[i]->mNumVertices;
+            u32 *indices = data.indices.data() + command.firstIndex;
+            vec3 *positions = data.positions.data() + command.baseVertex;
+            vector<u32> cacheClusters;
+
+            // Thousandths of vertices transformed by triangle : counters are integers
+            GXY_COUNTER("acmrBeforeMilli", computeACMR(indices, command.count, numVertices) * 1000.0f);
+
+            optimizeVertexCache(indices, command.count, numVertices, cacheClusters);
+            optimizeOverdraw(indices, command.count, positions, numVertices, cacheClusters, OVERDRAW_THRESHOLD);
+            optimizeVertexFetch(indices, command.count, data.vertices.data() + command.baseVertex, positions, numVertices);
+
+            GXY_COUNTER("acmrAfterMilli", computeACMR(indices, command.count, numVertices) * 1000.0f);
+            GXY_COUNTER(LOD_TRIANGLES[0], command.count / 3);
+
+            MeshClusters &mesh = clusters[i];
+
+            buildClusters(indices, positions, command, mesh.commands, mesh.boxes, mesh.cones);
+
+            // Levels of detail : each one is simplified from the mesh, then optimized and split like it
+            vec3 minMesh(FLT_MAX, FLT_MAX, FLT_MAX);
+            vec3 maxMesh(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+            for(u32 j = 0; j < numVertices; ++j)
+            {
+                minMesh = glm::min(minMesh, positions[j]);
+                maxMesh = glm::max(maxMesh, positions[j]);
+            }
+
+            float diagonal = length(maxMesh - minMesh);
+            vector<float> errors(1, 0.0f);
+            u32 previousCount = command.count;
+
+            mesh.firstCluster.push_back(0);
+            mesh.firstCluster.push_back(mesh.commands.size());
+
+            while(errors.size() < MAX_LODS)
+            {
+                u32 targetIndices = (command.count / 3 >> errors.size()) * 3;
+                vector<u32> simplified;
+
+                if(targetIndices < MIN_LOD_TRIANGLES * 3)
+                    break;
+
+                float error = simplifyMesh(indices, command.count, positions, numVertices, targetIndices,
+                                           MAX_LOD_ERROR * diagonal, simplified);
+
+                if(simplified.size() > previousCount * MIN_LOD_REDUCTION)
+                    break;
+
+                DrawElementCommand lodCommand = command;
+
+                lodCommand.count = simplified.size();
+                lodCommand.firstIndex = 0;
+
+                optimizeVertexCache(simplified.data(), simplified.size(), numVertices, cacheClusters);
+                optimizeOverdraw(simplified.data(), simplified.size(), positions, numVertices, cacheClusters, OVERDRAW_THRESHOLD);
+                buildClusters(simplified.data(), positions, lodCommand, mesh.commands, mesh.boxes, mesh.cones);
+
+                GXY_COUNTER(LOD_TRIANGLES[errors.size()], simplified.size() / 3);
+
+                previousCount = simplified.size();
+                errors.push_back(error);
+                mesh.firstCluster.push_back(mesh.commands.size());
+                mesh.lodIndices.push_back(move(simplified));
+            }
+
+            // The error of level k covers LOD_PIXEL_ERROR while the mesh is smaller than maxSizes[k] on the screen
+            vector<float> maxSizes(errors.size(), FLT_MAX);
+
+            for(u32 k = 1; k < errors.size(); ++k)
+            {
+                if(errors[k] > 0.0f)
+                    maxSizes[k] = LOD_PIXEL_ERROR * diagonal / errors[k];
+
+                maxSizes[k] = std::min(maxSizes[k], maxSizes[k - 1]);
+            }
+
+            for(u32 k = 0; k < errors.size(); ++k)
+            {
+                ClusterLod lod;
+
+                lod.meshCenter = vec4((minMesh + maxMesh) * 0.5f, k + 1 < errors.size() ? maxSizes[k + 1] : 0.0f);
+                lod.meshExtent = vec4((maxMesh - minMesh) * 0.5f, k == 0 ? -1.0f : maxSizes[k]);
+
+                mesh.lods.insert(mesh.lods.end(), mesh.firstCluster[k + 1] - mesh.firstCluster[k], lod);
+            }
+        });
+
+        for(u32 i = 0; i < scene->mNumMeshes; ++i)
+        {
+            MeshClusters &mesh = clusters[i];
+
+            // Simplified levels go after the indices of all meshes
+            for(u32 k = 0; k < mesh.lodIndices.size(); ++k)
+            {
+                for(u32 j = mesh.firstCluster[k + 1]; j < mesh.firstCluster[k + 2]; ++j)
+                    mesh.commands[j].firstIndex += data.indices.size();
+
+                data.indices.insert(data.indices.end(), mesh.lodIndices[k].begin(), mesh.lodIndices[k].end());
+            }
+
+            data.clustersCommand.insert(data.clustersCommand.end(), mesh.commands.begin(), mesh.commands.end());
+            data.clustersAABB.insert(data.clustersAABB.end(), mesh.boxes.begin(), mesh.boxes.end());
+            data.clustersCone.insert(data.clustersCone.end(), mesh.cones.begin(), mesh.cones.end());
+            data.clustersLod.insert(data.clustersLod.end(), mesh.lods.begin(), mesh.lods.end());
+        }
+
+        GXY_COUNTER("clusters", data.clustersCommand.size());
+
+        // AABB
+        data.aabb = makeAABB3D(minTotal, maxTotal);
+
+        imp.FreeScene();
+    }
+
+    void Model::mReserve(void)
+    {
+        ModelImport &pending = *mPending;
+        MeshView const &view = pending.view;
+
+        bool isReallocateVertex = false;
+        bool isReallocateIndex = false;
+        bool isReallocateMaterial = false;
+
+        // For command rendering, to know where we have to take data
+        pending.baseVertex = global->Model.vertex->numElements();
+        pending.baseIndex = global->Model.index->numElements();
+        pending.baseMaterial = global->Model.material->numElements();
 
-            mMeshesAABB[i].coord[0] = vec4(min.x, min.y, min.z, 1.0);
-            mMeshesAABB[i].coord[1] = vec4(min.x, min.y, max.z, 1.0);
-            mMeshesAABB[i].coord[2] = vec4(min.x, max.y, min.z, 1.0);
-            mMeshesAABB[i].coord[3] = vec4(min.x, max.y, max.z, 1.0);
-            mMeshesAABB[i].coord[4] = vec4(max.x, min.y, min.z, 1.0);
-            mMeshesAABB[i].coord[5] = vec4(max.x, min.y, max.z, 1.0);
-            mMeshesAABB[i].coord[6] = vec4(max.x, max.y, min.z, 1.0);
-            mMeshesAABB[i].coord[7] = vec4(max.x, max.y, max.z, 1.0);
+#ifdef GXY_COMPACT_VERTEX
+        if(pending.baseMaterial + view.texturePaths.size() > numeric_limits<u16>::max() + 1u)
+            cerr << "Too many materials for compact vertices : indices of materials wrap" << endl;
+#endif
+
+        // Materials : texture handles only exist in this process
+        for(u32 i = 0; i < view.texturePaths.size(); ++i)
+        {
+            Material material = view.materials[i];
+
+            if(pending.textures[i] != nullptr)
+            {
+                if(pending.textures[i]->isLoaded())
+                {
+                    u64 handle = pending.textures[i]->ressource->getHandle(0);
+                    memcpy(&material.textureHandleUseTexture, &handle, sizeof handle);
+                }
+
+                // Its error is already printed, the material keeps its color
+                else
+                    material.textureHandleUseTexture.z = 0.0;
+            }
+
+            global->Model.material->push(material, isReallocateMaterial);
         }
 
+        // Filled by the next slices : no command reads there before the Model is loaded
+        global->Model.vertex->append(view.numVertices, isReallocateVertex);
+        global->Model.vertexDepth->append(view.numVertices, isReallocateVertex);
+        global->Model.index->append(view.numIndices, isReallocateIndex);
+
         if(isReallocateVertex || isReallocateIndex)
         {
             global->Model.vao->create();
             global->Model.vaoDepth->create();
 
+#ifdef GXY_COMPACT_VERTEX
+            global->Model.vao->configure(*global->Model.vertexDepth, *global->Model.vertex);
+#else
             global->Model.vao->configure(*global->Model.vertex);
+#endif
             global->Model.vaoDepth->configure(*global->Model.vertexDepth);
 
             global->Model.vao->bindElementBuffer(*global->Model.index);
@@ -181,40 +706,123 @@ namespace GXY
         if(isReallocateMaterial)
             global->Model.material->bindBase(SHADER_STORAGE, 4);
 
-        // AABB
-        mAABB.coord[0] = vec4(minTotal.x, minTotal.y, minTotal.z, 1.0);
-        mAABB.coord[1] = vec4(minTotal.x, minTotal.y, maxTotal.z, 1.0);
-        mAABB.coord[2] = vec4(minTotal.x, maxTotal.y, minTotal.z, 1.0);
-        mAABB.coord[3] = vec4(minTotal.x, maxTotal.y, maxTotal.z, 1.0);
-        mAABB.coord[4] = vec4(maxTotal.x, minTotal.y, minTotal.z, 1.0);
-        mAABB.coord[5] = vec4(maxTotal.x, minTotal.y, maxTotal.z, 1.0);
-        mAABB.coord[6] = vec4(maxTotal.x, maxTotal.y, minTotal.z, 1.0);
-        mAABB.coord[7] = vec4(maxTotal.x, maxTotal.y, maxTotal.z, 1.0);
-
-        imp.FreeScene();
+        pending.reserved = true;
     }
 
-    void Model::pushInPipeline(mat4 const &transform)
+    bool Model::upload(size_t &budget)
     {
-        bool isReallocate = false; // All buffers have the same size
+        ModelImport &pending = *mPending;
+        MeshView const &view = pending.view;
+
+        for(auto const &texture : pending.textures)
+            if(texture != nullptr && !texture->isFinished())
+                return false;
 
-        for(u32 i = 0; i < mMeshesAABB.size(); ++i)
+        GXY_ZONE("Model::upload");
+
+        if(!pending.reserved)
+            mReserve();
+
+        // Another Model can reallocate the Buffers between two slices : pointers are taken again each time
+        if(pending.copiedVertices < view.numVertices)
         {
-            global->Model.command->push(mMeshesCommand[i], isReallocate);
-            global->Model.toWorldSpace->push(transform, isReallocate);
-            global->Model.aabb3D->push(mMeshesAABB[i], isReallocate);
+            u32 first = pending.copiedVertices;
+            u32 count = slice(view.numVertices - first, sizeof(Vertex) + sizeof(vec3), budget);
+            Vertex *vertices = global->Model.vertex->map() + pending.baseVertex + first;
+            vec3 *positions = global->Model.vertexDepth->map() + pending.baseVertex + first;
+
+            // Vertices only need their material moved, positions are copied as they are
+            if(pending.baseMaterial == 0)
+                memcpy(vertices, view.vertices + first, count * sizeof(Vertex));
+
+            else
+            {
+                for(u32 i = 0; i < count; ++i)
+                {
+                    Vertex vertex = view.vertices[first + i];
+
+                    vertex.materialIndex += pending.baseMaterial;
+                    vertices[i] = vertex;
+                }
+            }
+
+            memcpy(positions, view.positions + first, count * sizeof(vec3));
+            pending.copiedVertices += count;
+        }
+
+        if(pending.copiedIndices < view.numIndices && budget > 0)
+        {
+            u32 first = pending.copiedIndices;
+            u32 count = slice(view.numIndices - first, sizeof(u32), budget);
+
+            memcpy(global->Model.index->map() + pending.baseIndex + first, view.indices + first, count * sizeof(u32));
+            pending.copiedIndices += count;
+        }
+
+        if(pending.copiedVertices < view.numVertices || pending.copiedIndices < view.numIndices)
+            return false;
+
+        GXY_COUNTER("uploadedVertices", view.numVertices);
+
+        mClustersAABB.assign(view.clustersAABB, view.clustersAABB + view.numClusters);
+        mClustersCommand.assign(view.clustersCommand, view.clustersCommand + view.numClusters);
+        mClustersCone.assign(view.clustersCone, view.clustersCone + view.numClusters);
+        mClustersLod.assign(view.clustersLod, view.clustersLod + view.numClusters);
+
+        for(auto &command : mClustersCommand)
+        {
+            command.firstIndex += pending.baseIndex;
+            command.baseVertex += pending.baseVertex;
         }
 
-        if(isReallocate)
+        // AABB
+        mAABB = view.aabb;
+
+        // Unmap the file, or free the imported data
+        mPending.reset();
+
+        return true;
+    }
+
+    void Model::pushInPipeline(u32 transform, u32 hlod)
+    {
+        if(mInstances.empty())
+            global->sceneManager->pushInstancedModel(this);
+
+        mInstances.push_back(uvec2(transform, hlod));
+    }
+
+    void Model::writeInstancesInPipeline(u32 firstCommand, u32 firstInstance)
+    {
+        DrawElementCommand *commands = global->Model.command->map() + firstCommand;
+        AABB3D *boxes = global->Model.aabb3D->map() + firstCommand;
+        ClusterCone *cones = global->Model.clusterCone->map() + firstCommand;
+        ClusterLod *lods = global->Model.clusterLod->map() + firstCommand;
+        DrawInstance *instances = global->Model.instance->map() + firstInstance;
+
+        for(u32 i = 0; i < mClustersCommand.size(); ++i)
         {
-            global->Model.command->bindBase(SHADER_STORAGE, 0);
-            global->Model.toWorldSpace->bindBase(SHADER_STORAGE, 2);
-            global->Model.aabb3D->bindBase(SHADER_STORAGE, 3);
+            DrawInstance instance;
+
+            commands[i] = mClustersCommand[i];
+            commands[i].primCount = mInstances.size();
+            commands[i].baseInstance = firstInstance + i * mInstances.size();
+
+            boxes[i] = mClustersAABB[i];
+            cones[i] = mClustersCone[i];
+            lods[i] = mClustersLod[i];
+
+            instance.command = firstCommand + i;
 
-            // We reallocate toClipSpace as well
-            global->Model.toClipSpace->allocate(global->Model.toWorldSpace->numMaxElements());
-            global->Model.toClipSpace->bindBase(SHADER_STORAGE, 1);
+            for(auto const &transformHlod : mInstances)
+            {
+                instance.transform = transformHlod.x;
+                instance.hlod = transformHlod.y;
+                *instances++ = instance;
+            }
         }
+
+        mInstances.clear();
     }
 
     Model::~Model()
@@ -16,6 +16,20 @@
  */
 namespace GXY
 {
+    struct MeshData;
+    struct ModelImport;
+
+    /**
+     * @brief One Model merged in a proxy, with its matrix in the space of the proxy
+     */
+    struct ProxySource
+    {
+        std::string path; //!< Path of the asset, its meshes are read again in the MeshCache
+        glm::mat4 transform; //!< From the space of the Model to the space of the proxy
+
+        inline bool operator==(ProxySource const &source) const {return path == source.path && transform == source.transform;}
+    };
+
     /**
      * @brief Provide loading assets
      * 
@@ -31,10 +45,37 @@ namespace GXY
         Model();
 
         /**
-         * @brief Load one asset
+         * @brief Import one asset, from the MeshCache or with Assimp, and ask for its textures
+         *
+         * Does not call OpenGL : a worker can do it
          * @param[in] path : Path to load the Asset
          */
-        void load(std::string const &path);
+        void import(std::string const &path);
+
+        /**
+         * @brief Merge the finest level of several Models in one simplified mesh, and ask for their textures
+         *
+         * A proxy drawn instead of a subtree of Nodes far away : one command by cluster for all its Models.
+         * Meshes come from the MeshCache of each Model, materials are copied, so one command draws all of them.
+         * Does not call OpenGL : a worker can do it
+         * @param[in] sources : Models and their matrices, Models without a valid MeshCache are left out
+         */
+        void bake(std::vector<ProxySource> const &sources);
+
+        /**
+         * @brief Get the path of the asset
+         * @return the path, empty for a proxy
+         */
+        inline std::string const &path(void) const {return mPath;}
+
+        /**
+         * @brief Copy the imported asset in the Buffers of Global::Model, one slice by call
+         *
+         * Returns without spending the budget while its textures are not loaded
+         * @param[in, out] budget : Bytes which can still be copied during this frame
+         * @return true once all is copied, the Model can be rendered
+         */
+        bool upload(size_t &budget);
         
         /**
          * @brief Get the global bounding boxes
@@ -43,10 +84,34 @@ namespace GXY
         AABB3D const &AABB(void) const{return mAABB;}
 
         /**
-         * @brief Push data in different Buffer
-         * @param[in] transform : World Matrix
+         * @brief Add one instance of this Model in the scene being built
+         *
+         * All instances are pushed together by pushInstancesInPipeline
+         * @param[in] transform : Index of the World Matrix in toWorldSpace
+         * @param[in] hlod : HlodSwitch of the instance, NO_HLOD if none
          */
-        void pushInPipeline(glm::mat4 const &transform);
+        void pushInPipeline(u32 transform, u32 hlod = NO_HLOD);
+
+        /**
+         * @brief Get the number of clusters of all levels of detail, each one is one instanced command
+         * @return number of clusters
+         */
+        inline u32 numClusters(void) const {return mClustersCommand.size();}
+
+        /**
+         * @brief Get the number of instances pushed in the scene being built
+         * @return number of instances
+         */
+        inline u32 numInstances(void) const {return mInstances.size();}
+
+        /**
+         * @brief Write one instanced command for each cluster, and all instances, at given places
+         *
+         * Buffers already own these elements, so several Models can be written at once by different threads
+         * @param[in] firstCommand : Index of the first command in command, aabb3D, clusterCone and clusterLod
+         * @param[in] firstInstance : Index of the first instance in instance
+         */
+        void writeInstancesInPipeline(u32 firstCommand, u32 firstInstance);
 
         /** 
          * @brief Model Destructor
@@ -54,9 +119,26 @@ namespace GXY
         ~Model();
 
     private:
+        /**
+         * @brief Import the asset with Assimp
+         * @param[in] path : Path to load the Asset
+         * @param[out] data : Final data of the Model
+         */
+        void mImport(std::string const &path, MeshData &data);
+
+        /**
+         * @brief Push the materials and make room for the Model at the end of the Buffers of Global::Model
+         */
+        void mReserve(void);
+
+        std::string mPath; //!< Path of the asset, empty for a proxy
         AABB3D mAABB; //!< The Total Bounding Box
-        std::vector<AABB3D> mMeshesAABB; //!< Bounding Boxes
-        std::vector<DrawElementCommand> mMeshesCommand; //!< Command rendering
+        std::vector<AABB3D> mClustersAABB; //!< Bounding Boxes of clusters
+        std::vector<DrawElementCommand> mClustersCommand; //!< Command rendering of clusters
+        std::vector<ClusterCone> mClustersCone; //!< Bounding spheres and cones of normals of clusters
+        std::vector<ClusterLod> mClustersLod; //!< Levels of detail of clusters
+        std::vector<glm::uvec2> mInstances; //!< Index of the World Matrix : .x, HlodSwitch : .y, of instances in the scene being built
+        std::unique_ptr<ModelImport> mPending; //!< Asset imported and not uploaded yet
     };
 
 }
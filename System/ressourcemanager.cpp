@@ -6,43 +6,308 @@
  */
 
 #include "ressourcemanager.h"
+#include "device.h"
+#include "texturecache.h"
+#include "../SceneManager/scenemanager.h"
 
 using namespace glm;
 using namespace std;
 
 namespace GXY
 {
-    RessourceManager::RessourceManager()
+    static size_t const UPLOAD_BUDGET = 8 << 20; //!< Bytes uploaded by frame, by default
+
+    /**
+     * @brief Give up one ressource, nobody may wait for it : the error is printed
+     */
+    template<typename T>
+    static void fail(AsyncRessource<T> &ressource, char const *error)
+    {
+        cerr << error << endl;
+        ressource.error = error;
+        ressource.state.store(LOADING_FAILED, memory_order_release);
+    }
+
+    RessourceManager::RessourceManager() :
+        mUploadBudget(UPLOAD_BUDGET)
     {
 
     }
 
     shared_ptr<Texture> RessourceManager::getTexture(const string &path)
     {
-        if(mTextures.find(path) == mTextures.end())
+        GXY_ZONE("RessourceManager::getTexture");
+
+        shared_ptr<AsyncRessource<Texture>> texture = getTextureAsync(path);
+
+        mWait(texture->state);
+
+        if(!texture->isLoaded())
+            throw Except(texture->error);
+
+        return texture->ressource;
+    }
+
+    shared_ptr<Model> RessourceManager::getModel(const string &path)
+    {
+        GXY_ZONE("RessourceManager::getModel");
+
+        shared_ptr<AsyncRessource<Model>> model = getModelAsync(path);
+
+        mWait(model->state);
+
+        if(!model->isLoaded())
+            throw Except(model->error);
+
+        return model->ressource;
+    }
+
+    shared_ptr<AsyncRessource<Texture>> RessourceManager::getTextureAsync(const string &path)
+    {
+        lock_guard<mutex> lock(mMutex);
+        shared_ptr<AsyncRessource<Texture>> &texture = mTextures[path];
+
+        // Already asked : both share the same loading
+        if(texture != nullptr)
+            return texture;
+
+        GXY_COUNTER("loadedTextures", 1);
+
+        shared_ptr<AsyncRessource<Texture>> async = texture = make_shared<AsyncRessource<Texture>>();
+
+        global->jobSystem->run([this, async, path]()
+        {
+            shared_ptr<ImageData> image = make_shared<ImageData>();
+
+            // Blocks cooked at a previous start go to the GPU as they are
+            if(TextureCache(path).read(*image))
+                GXY_COUNTER("textureCacheHits", 1);
+
+            else
+            {
+                try
+                {
+                    decodeImage(path, *image);
+                }
+
+                catch(exception const &exc)
+                {
+                    fail(*async, exc.what());
+                    return;
+                }
+
+                // Cooked for the next start, this one goes on with uncompressed texels : finish waits for the file
+                global->jobSystem->run([path, image]()
+                {
+                    ImageData compressed;
+
+                    compressImage(*image, compressed);
+                    TextureCache(path).write(compressed);
+                }, &mJobs);
+            }
+
+            // One level by step at least, largest first : the Texture is used once all are there
+            mQueueUpload([this, async, image, level = 0u](size_t &budget) mutable
+            {
+                GXY_ZONE("Texture upload");
+
+                if(async->ressource == nullptr)
+                {
+                    async->ressource = make_shared<Texture>(1);
+                    async->ressource->imageStorage(0, image->w, image->h, image->numLevels(), image->format);
+                }
+
+                for(; level < image->numLevels() && budget > 0; ++level)
+                {
+                    size_t size = image->levelSize(level);
+                    size_t offset;
+                    u8 *staging = mStage(size, offset);
+
+                    if(staging == nullptr)
+                        return false;
+
+                    memcpy(staging, image->pixels.data() + image->levels[level], size);
+                    async->ressource->imageLevel(0, level, image->format, *mStaging, offset, size);
+
+                    budget -= std::min(budget, size);
+                }
+
+                if(level < image->numLevels())
+                    return false;
+
+                async->state.store(LOADED, memory_order_release);
+                return true;
+            });
+        }, &mJobs);
+
+        return texture;
+    }
+
+    shared_ptr<AsyncRessource<Model>> RessourceManager::getModelAsync(const string &path)
+    {
+        lock_guard<mutex> lock(mMutex);
+        shared_ptr<AsyncRessource<Model>> &model = mModels[path];
+
+        if(model != nullptr)
+            return model;
+
+        shared_ptr<AsyncRessource<Model>> async = model = make_shared<AsyncRessource<Model>>();
+
+        mLoadModel(async, [path](Model &model){model.import(path);});
+
+        return model;
+    }
+
+    shared_ptr<AsyncRessource<Model>> RessourceManager::bakeModelAsync(vector<ProxySource> const &sources)
+    {
+        shared_ptr<AsyncRessource<Model>> async = make_shared<AsyncRessource<Model>>();
+
+        mLoadModel(async, [sources](Model &model){model.bake(sources);});
+
+        return async;
+    }
+
+    void RessourceManager::mLoadModel(shared_ptr<AsyncRessource<Model>> const &async, function<void(Model&)> const &load)
+    {
+        async->ressource = make_shared<Model>();
+
+        global->jobSystem->run([this, async, load]()
         {
-            shared_ptr<Texture> texture = make_shared<Texture>(1);
-            texture->image(0, path);
-            mTextures[path] = texture;
+            try
+            {
+                load(*async->ressource);
+            }
+
+            catch(exception const &exc)
+            {
+                fail(*async, exc.what());
+                return;
+            }
+
+            mQueueUpload([async](size_t &budget)
+            {
+                if(!async->ressource->upload(budget))
+                    return false;
+
+                async->state.store(LOADED, memory_order_release);
+
+                // Its ModelNodes were left out of the scene until now
+                if(global->sceneManager != nullptr)
+                    global->sceneManager->sceneChanged();
+
+                return true;
+            });
+        }, &mJobs);
+    }
+
+    void RessourceManager::mQueueUpload(Upload upload)
+    {
+        global->jobSystem->run([this, upload]()
+        {
+            mUploads.push_back(upload);
+        }, nullptr, MAIN_THREAD);
+    }
+
+    bool RessourceManager::mCommit(size_t budget)
+    {
+        if(mStaging == nullptr)
+        {
+            mStaging = make_shared<Buffer<u8>>(FRAMES_IN_FLIGHT);
+            mStaging->allocate(mUploadBudget);
+        }
+
+        // Only waits if the GPU still copies from this region
+        mStaging->nextRegion();
+        mStaging->setToZeroElement();
+
+        size_t start = budget;
+        bool finished = false;
+
+        // A Model waiting for its textures does not stop the uploads after it
+        for(auto it = mUploads.begin(); it != mUploads.end() && budget > 0;)
+        {
+            if((*it)(budget))
+            {
+                it = mUploads.erase(it);
+                finished = true;
+            }
+
+            else
+                ++it;
         }
 
-        return mTextures[path];
+        mStaging->lockRegion();
+
+        return finished || budget < start;
     }
 
-    shared_ptr<Model> RessourceManager::getModel(const string &path)
+    u8 *RessourceManager::mStage(size_t size, size_t &offset)
+    {
+        size_t used = mStaging->numElements();
+        bool isReallocate = false;
+
+        // A level larger than one region makes the ring grow, others wait for the next region
+        if(used > 0 && used + size > mStaging->numMaxElements())
+            return nullptr;
+
+        // Rows of texels are read 4 bytes aligned
+        u8 *room = mStaging->append((size + 3) & ~size_t(3), isReallocate);
+
+        offset = mStaging->regionOffset() + used;
+
+        return room;
+    }
+
+    void RessourceManager::update(void)
+    {
+        if(mUploads.empty())
+            return;
+
+        GXY_ZONE("RessourceManager::update");
+
+        mCommit(mUploadBudget);
+
+        GXY_COUNTER("pendingUploads", mUploads.size());
+    }
+
+    void RessourceManager::mWait(atomic<u32> const &state)
     {
-        if(mModels.find(path) == mModels.end())
+        assert(global->jobSystem->isMainThread());
+
+        // Only this ressource is waited for : jobs of the others run meanwhile, but their end is not awaited
+        while(true)
         {
-            shared_ptr<Model> model = make_shared<Model>();
-            model->load(path);
-            mModels[path] = model;
+            // One upload which ends can let the ones queued before it go on
+            while(state.load(memory_order_acquire) == LOADING && mCommit(numeric_limits<size_t>::max()));
+
+            if(state.load(memory_order_acquire) != LOADING)
+                return;
+
+            size_t blocked = mUploads.size();
+
+            // Until it fails on a worker, or an upload comes from a worker
+            global->jobSystem->waitUntil([&]{return state.load(memory_order_acquire) != LOADING || mUploads.size() != blocked;});
         }
+    }
+
+    void RessourceManager::finish(void)
+    {
+        GXY_ZONE("RessourceManager::finish");
 
-        return mModels[path];
+        assert(global->jobSystem->isMainThread());
+
+        do
+        {
+            global->jobSystem->wait(mJobs);
+            global->jobSystem->runMainThreadJobs();
+            mCommit(numeric_limits<size_t>::max());
+        } while(!mJobs.done() || !mUploads.empty());
     }
 
     RessourceManager::~RessourceManager()
     {
-
+        // Workers still write in the caches, and their jobs use this
+        if(global != nullptr && global->jobSystem != nullptr)
+            global->jobSystem->wait(mJobs);
     }
 }
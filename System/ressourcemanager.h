@@ -11,9 +11,50 @@
 #include "../include/include.h"
 #include "texture.h"
 #include "model.h"
+#include "jobsystem.h"
+#include "buffer.h"
 
 namespace GXY
 {
+    /**
+     * @brief Where one ressource loaded in background is
+     */
+    enum LoadingState{LOADING, //!< Decoded, imported or uploaded : it can't be used yet
+                      LOADED, //!< It can be used
+                      LOADING_FAILED //!< The file can't be read, error says why
+                     };
+
+    /**
+     * @brief One ressource loaded in background, shared by all who asked for its path
+     *
+     * A worker decodes or imports the file, then the main thread uploads it
+     * in slices during RessourceManager::update. Once loaded, only the main thread uses it.
+     */
+    template<typename T>
+    struct AsyncRessource
+    {
+        std::shared_ptr<T> ressource; //!< The ressource, valid once loaded
+        std::atomic<u32> state; //!< LoadingState
+        std::string error; //!< Written before state becomes LOADING_FAILED
+
+        /**
+         * @brief AsyncRessource Constructor
+         */
+        AsyncRessource(void) : state(LOADING){}
+
+        /**
+         * @brief To know if the ressource can be used
+         * @return true if it is loaded
+         */
+        inline bool isLoaded(void) const {return state.load(std::memory_order_acquire) == LOADED;}
+
+        /**
+         * @brief To know if the loading is over
+         * @return true if it is loaded or failed
+         */
+        inline bool isFinished(void) const {return state.load(std::memory_order_acquire) != LOADING;}
+    };
+
     /**
     * @brief Provide one interface to manage all ressources
     */
@@ -26,27 +67,121 @@ namespace GXY
         RessourceManager();
 
         /**
-         * @brief Get a Pointer on a Texture asked to be load
+         * @brief Get a Pointer on a Texture asked to be load, wait for it
+         *
+         * Only the main thread can call it
          * @param[in] path : Path to find a Texture
          * @return a pointer on a Texture
          */
         std::shared_ptr<Texture> getTexture(std::string const &path);
 
         /**
-         * @brief Get a Pointer on a Model asked to be load
+         * @brief Get a Pointer on a Model asked to be load, wait for it
+         *
+         * Only the main thread can call it
          * @param[in] path : Path to find a Model
          * @return a pointer on a Model
          */
         std::shared_ptr<Model> getModel(std::string const &path);
 
         /**
-          * @brief RessourceManagerDestructor
+         * @brief Ask for a Texture without waiting : a worker decodes it
+         *
+         * Any thread can call it, the same path is only loaded once
+         * @param[in] path : Path to find a Texture
+         * @return the Texture being loaded
+         */
+        std::shared_ptr<AsyncRessource<Texture>> getTextureAsync(std::string const &path);
+
+        /**
+         * @brief Ask for a Model without waiting : a worker imports it, and asks for its textures
+         *
+         * Any thread can call it, the same path is only loaded once
+         * @param[in] path : Path to find a Model
+         * @return the Model being loaded
+         */
+        std::shared_ptr<AsyncRessource<Model>> getModelAsync(std::string const &path);
+
+        /**
+         * @brief Bake one proxy without waiting : a worker merges and simplifies the Models
+         *
+         * Any thread can call it, each call bakes a new Model, it is not shared
+         * @param[in] sources : Models merged, with their matrices in the space of the proxy
+         * @return the proxy being baked
+         */
+        std::shared_ptr<AsyncRessource<Model>> bakeModelAsync(std::vector<ProxySource> const &sources);
+
+        /**
+         * @brief Upload ressources loaded by workers, within the budget of one frame
+         *
+         * Called once per frame by the Device, after the MAIN_THREAD jobs
+         */
+        void update(void);
+
+        /**
+         * @brief Wait for all ressources asked, and upload them without budget
+         */
+        void finish(void);
+
+        /**
+         * @brief Set the bytes uploaded by update at most
+         * @param[in] bytes : Budget of one frame, one level of texture is never split
+         */
+        inline void setUploadBudget(size_t bytes) {mUploadBudget = bytes;}
+
+        /**
+          * @brief RessourceManagerDestructor, waits for the jobs not finished
           */
         ~RessourceManager();
 
     private:
-        std::map<std::string, std::shared_ptr<Texture>> mTextures; //!< Associative table between path and Texture
-        std::map<std::string, std::shared_ptr<Model>>mModels; //!< Associative table between path and Model
+        /**
+         * @brief One upload on the main thread, takes bytes in the budget
+         * @return true once finished, else it is called again at the next frame
+         */
+        typedef std::function<bool(size_t &budget)> Upload;
+
+        std::mutex mMutex; //!< Workers ask for textures while they import Models
+        std::map<std::string, std::shared_ptr<AsyncRessource<Texture>>> mTextures; //!< Associative table between path and Texture
+        std::map<std::string, std::shared_ptr<AsyncRessource<Model>>>mModels; //!< Associative table between path and Model
+        JobCounter mJobs; //!< Decoding, import and cooking jobs not finished
+        std::deque<Upload> mUploads; //!< Uploads not finished, main thread only
+        size_t mUploadBudget; //!< Bytes uploaded by update at most
+        std::shared_ptr<Buffer<u8>> mStaging; //!< Ring of pixel Buffers, textures are uploaded from it
+
+        /**
+         * @brief Give one upload to the main thread, from any thread
+         * @param[in] upload : The upload
+         */
+        void mQueueUpload(Upload upload);
+
+        /**
+         * @brief Load one Model on a worker, then upload it on the main thread
+         * @param[in] async : The Model being loaded
+         * @param[in] load : Imports or bakes the Model, throws on failure
+         */
+        void mLoadModel(std::shared_ptr<AsyncRessource<Model>> const &async, std::function<void(Model&)> const &load);
+
+        /**
+         * @brief Run uploads in order until the budget is spent, in the next region of mStaging
+         * @param[in] budget : Bytes to upload at most
+         * @return true if one upload went on, false if all wait for workers
+         */
+        bool mCommit(size_t budget);
+
+        /**
+         * @brief Take room in the current region of mStaging
+         * @param[in] size : Size in bytes
+         * @param[out] offset : Offset of the room in the Buffer
+         * @return pointer on the room, nullptr if the region is full until the next commit
+         */
+        u8 *mStage(size_t size, size_t &offset);
+
+        /**
+         * @brief Run jobs and uploads until the loading of one ressource is over, without waiting for the others
+         * @param[in] state : State of the ressource
+         */
+        void mWait(std::atomic<u32> const &state);
     };
 
 }
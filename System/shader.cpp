@@ -12,6 +12,15 @@ namespace GXY
     using namespace std;
     using namespace glm;
 
+    /**
+     * @brief Options of the engine seen by all shaders
+     */
+    static char const SHADER_DEFINES[] =
+#ifdef GXY_COMPACT_VERTEX
+        "#define COMPACT_VERTEX\n"
+#endif
+        "";
+
     Shader::Shader(void) : mProgram(0)
     {
 
@@ -114,7 +123,14 @@ namespace GXY
 
         shader = glCreateShader(static_cast<u32>(type));
 
-        char const *source = src.c_str();
+        // Defines of the engine come just after #version
+        string defined = src;
+        size_t version = defined.find("#version");
+
+        if(version != string::npos)
+            defined.insert(defined.find('\n', version) + 1, SHADER_DEFINES);
+
+        char const *source = defined.c_str();
         glShaderSource(shader, 1, &source, NULL);
         glCompileShader(shader);
 
@@ -6,6 +6,12 @@
  */
 
 #include "texture.h"
+#include "buffer.h"
+#include "../Debug/cpuprofiler.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace GXY
 {
@@ -56,64 +62,167 @@ namespace GXY
         glGenTextures(number, &mId[0]);
     }
 
-    u8 *getImage(SDL_Surface *image, u32 &w, u32 &h, GLenum &internalFormat, GLenum &format)
+    /**
+     * @brief Build one level of mipmap from the previous one, with a 2x2 box filter
+     *
+     * The last row or column of an odd size is dropped, as the size of the next level
+     * @param[in] source : RGBA8 texels of the previous level
+     * @param[in] w : Width of the previous level
+     * @param[in] h : Height of the previous level
+     * @param[out] destination : RGBA8 texels of the next level
+     */
+    static void downsample(u8 const *source, u32 w, u32 h, u8 *destination)
     {
-        if(image->format->BytesPerPixel == 3)
-        {
-            internalFormat = GL_RGB;
-
-            if(image->format->Rmask == 0x000000FF)
-                format = GL_RGB;
+        u32 w2 = std::max(w / 2, 1u);
+        u32 h2 = std::max(h / 2, 1u);
 
-            else
-                format = GL_BGR;
+        for(u32 y = 0; y < h2; ++y)
+        {
+            u8 const *row0 = source + (size_t)(2 * y) * w * 4;
+            u8 const *row1 = source + (size_t)std::min(2 * y + 1, h - 1) * w * 4;
+            u8 *texels = destination + (size_t)y * w2 * 4;
+            u32 x = 0;
+
+#ifdef __SSE2__
+            // Two texels by iteration : four texels of each row, widened to 16 bits
+            __m128i const zero = _mm_setzero_si128();
+            __m128i const round = _mm_set1_epi16(2);
+
+            for(; x + 2 <= w2; x += 2)
+            {
+                __m128i a = _mm_loadu_si128((__m128i const*)(row0 + x * 8));
+                __m128i b = _mm_loadu_si128((__m128i const*)(row1 + x * 8));
+
+                // Both rows added : low owns texels 0 and 1, high owns texels 2 and 3
+                __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+                low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+                high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+
+                __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(low, high), round), 2);
+
+                _mm_storel_epi64((__m128i*)(texels + x * 4), _mm_packus_epi16(sum, sum));
+            }
+#endif
+
+            for(; x < w2; ++x)
+            {
+                u32 x0 = 2 * x * 4;
+                u32 x1 = std::min(2 * x + 1, w - 1) * 4;
+
+                for(u32 c = 0; c < 4; ++c)
+                    texels[x * 4 + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2;
+            }
         }
+    }
 
-        else
-        {
-            internalFormat = GL_RGBA;
+    void ImageData::allocate(u32 numLevels)
+    {
+        size_t size = 0;
 
-            if(image->format->Rmask == 0x000000FF)
-                format = GL_RGBA;
+        levels.resize(numLevels);
 
-            else
-                format = GL_BGRA;
+        for(u32 level = 0; level < numLevels; ++level)
+        {
+            levels[level] = size;
+            size += levelSize(level);
         }
 
-        w = image->w;
-        h = image->h;
-
-        return (u8*)image->pixels;
+        pixels.resize(size);
     }
 
-    void Texture::image(u32 index, string const &path)
+    void decodeImage(string const &path, ImageData &image)
     {
-        if(index > mId.size())
-            throw Except("Texture : Index out of rang");
-
-        u8 *image;
-        GLenum format, internalFormat;
-        u32 w, h;
+        GXY_ZONE("decodeImage");
 
         SDL_Surface *img = IMG_Load(path.c_str());
 
         if(img == nullptr)
             throw Except(string("Impossible to open : ") + path);
 
-        image = getImage(img, w, h, internalFormat, format);
+        // Bytes R, G, B, A in memory whatever the file : mipmaps are built on one layout
+        SDL_Surface *rgba = SDL_ConvertSurfaceFormat(img, SDL_PIXELFORMAT_ABGR8888, 0);
+        SDL_FreeSurface(img);
+
+        if(rgba == nullptr)
+            throw Except(string("Impossible to convert : ") + path);
+
+        image.w = rgba->w;
+        image.h = rgba->h;
+        image.format = GL_RGBA8;
+
+        u32 numLevels = 1;
 
-        glTextureImage2DEXT(mId[index], GL_TEXTURE_2D, 0, internalFormat,
-                            w, h, 0, format, GL_UNSIGNED_BYTE, image);
+        while((std::max(image.w, image.h) >> numLevels) > 0)
+            ++numLevels;
 
-        glGenerateTextureMipmapEXT(mId[index], GL_TEXTURE_2D);
+        image.allocate(numLevels);
+
+        for(u32 y = 0; y < image.h; ++y)
+            memcpy(&image.pixels[(size_t)y * image.w * 4], (u8 const*)rgba->pixels + (size_t)y * rgba->pitch, image.w * 4);
+
+        SDL_FreeSurface(rgba);
+
+        for(u32 level = 1; level < numLevels; ++level)
+            downsample(&image.pixels[image.levels[level - 1]], image.levelWidth(level - 1), image.levelHeight(level - 1),
+                       &image.pixels[image.levels[level]]);
+
+        GXY_COUNTER("decodedTexels", image.pixels.size() / 4);
+    }
+
+    void Texture::image(u32 index, string const &path)
+    {
+        ImageData data;
+
+        decodeImage(path, data);
+        image(index, data);
+    }
+
+    void Texture::image(u32 index, ImageData const &image)
+    {
+        imageStorage(index, image.w, image.h, image.numLevels(), image.format);
+
+        for(u32 level = 0; level < image.numLevels(); ++level)
+            imageLevel(index, level, image.format, image.pixels.data() + image.levels[level], image.levelSize(level));
+    }
+
+    void Texture::imageStorage(u32 index, u32 w, u32 h, u32 levels, GLenum format)
+    {
+        if(index >= mId.size())
+            throw Except("Texture : Index out of rang");
 
         glTextureParameteriEXT(mId[index], GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTextureParameteriEXT(mId[index], GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+        glTextureStorage2DEXT(mId[index], GL_TEXTURE_2D, levels, format, w, h);
+
         mW[index] = w;
         mH[index] = h;
+    }
 
-        SDL_FreeSurface(img);
+    void Texture::imageLevel(u32 index, u32 level, GLenum format, u8 const *pixels, size_t size)
+    {
+        if(index >= mId.size())
+            throw Except("Texture : Index out of rang");
+
+        u32 w = std::max(mW[index] >> level, 1u);
+        u32 h = std::max(mH[index] >> level, 1u);
+
+        if(format == GL_RGBA8)
+            glTextureSubImage2DEXT(mId[index], GL_TEXTURE_2D, level, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+        // Blocks go as they are, the GPU samples them without decompressing the texture
+        else
+            glCompressedTextureSubImage2DEXT(mId[index], GL_TEXTURE_2D, level, 0, 0, w, h, format, size, pixels);
+    }
+
+    void Texture::imageLevel(u32 index, u32 level, GLenum format, Buffer<u8> &pixels, size_t offset, size_t size)
+    {
+        // With a pixel Buffer bound, the pointer is an offset in it
+        pixels.bind(PIXEL_UNPACK);
+        imageLevel(index, level, format, (u8 const*)offset, size);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
     }
 
     void getFilterFromInternal(FormatType internalFormat, GLenum &filter)
@@ -167,6 +276,23 @@ namespace GXY
         mH[index] = h;
     }
 
+    void Texture::emptyTextureMipmaps(u32 index, u32 w, u32 h, u32 levels, FormatType internalFormat)
+    {
+        if(index >= mId.size())
+            throw Except("Texture : Index out of rang");
+
+        glTextureParameteriEXT(mId[index], GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTextureParameteriEXT(mId[index], GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glTextureParameteriEXT(mId[index], GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteriEXT(mId[index], GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glTextureStorage2DEXT(mId[index], GL_TEXTURE_2D, levels, internalFormat, w, h);
+
+        mW[index] = w;
+        mH[index] = h;
+    }
+
     void Texture::emptyTextureArray(u32 index, u32 number, u32 w, u32 h, FormatType internalFormat)
     {
         if(index >= mId.size())
@@ -318,6 +444,14 @@ namespace GXY
         glBindImageTextures(firstUnit, count, &mId[indexFirstImage]);
     }
 
+    void Texture::bindImageLevel(u32 index, u32 unit, u32 level, FormatType format) const
+    {
+        if(index >= mId.size())
+            throw Except("Texture : Index out of rang");
+
+        glBindImageTexture(unit, mId[index], level, GL_FALSE, 0, GL_READ_WRITE, format);
+    }
+
     u64 Texture::getHandle(u32 index)
     {
         if(index >= mId.size())
@@ -16,6 +16,69 @@ namespace GXY
 {
     class FrameBuffer;
 
+    template<typename T>
+    class Buffer;
+
+    /**
+     * @brief Pixels of one image and of all its mipmaps, decoded but not uploaded yet
+     */
+    struct ImageData
+    {
+        std::vector<u8> pixels; //!< Texels or blocks of all levels, the largest first, without padding
+        std::vector<size_t> levels; //!< Offset of each level in pixels
+        u32 w; //!< Width of the first level
+        u32 h; //!< Height of the first level
+        GLenum format; //!< GL_RGBA8, or GL_COMPRESSED_RGB_S3TC_DXT1_EXT (BC1) and GL_COMPRESSED_RGBA_S3TC_DXT5_EXT (BC3) read from the TextureCache
+
+        /**
+         * @brief Get the number of levels, down to 1x1
+         * @return number of levels
+         */
+        inline u32 numLevels(void) const {return levels.size();}
+
+        /**
+         * @brief Get the width of one level
+         * @param[in] level : Level of mipmap
+         * @return Width
+         */
+        inline u32 levelWidth(u32 level) const {return std::max(w >> level, 1u);}
+
+        /**
+         * @brief Get the height of one level
+         * @param[in] level : Level of mipmap
+         * @return Height
+         */
+        inline u32 levelHeight(u32 level) const {return std::max(h >> level, 1u);}
+
+        /**
+         * @brief Get the size of one level
+         * @param[in] level : Level of mipmap
+         * @return Size in bytes
+         */
+        inline size_t levelSize(u32 level) const
+        {
+            if(format == GL_RGBA8)
+                return (size_t)levelWidth(level) * levelHeight(level) * 4;
+
+            // Blocks of 4x4 texels, 8 bytes in BC1 and 16 in BC3
+            return (size_t)((levelWidth(level) + 3) / 4) * ((levelHeight(level) + 3) / 4) *
+                   (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16);
+        }
+
+        /**
+         * @brief Compute the offsets of all levels from the size and the format, and allocate pixels
+         * @param[in] numLevels : Number of levels
+         */
+        void allocate(u32 numLevels);
+    };
+
+    /**
+     * @brief Decode one image and build its mipmaps, without OpenGL : any thread can call it
+     * @param[in] path : Path to image
+     * @param[out] image : Pixels of the image
+     */
+    void decodeImage(std::string const &path, ImageData &image);
+
     /**
       * @example Texture texExample.cpp
       * @code{.cpp}
@@ -94,6 +157,16 @@ namespace GXY
          */
         void emptyDepthTexture(u32 index, u32 w, u32 h);
 
+        /**
+         * @brief Create one empty texture 2D with its mipmaps, read with texelFetch
+         * @param[in] index : Index of this texture
+         * @param[in] w : Width of the first level
+         * @param[in] h : Height of the first level
+         * @param[in] levels : Number of levels
+         * @param[in] internalFormat : FormatType of this Texture
+         */
+        void emptyTextureMipmaps(u32 index, u32 w, u32 h, u32 levels, FormatType internalFormat);
+
         /**
          * @brief Create one empty CubeMap
          * @param[in] index : Index of this CubeMap
@@ -120,6 +193,46 @@ namespace GXY
          */
         void image(u32 index, std::string const &path);
 
+        /**
+         * @brief Upload one image already decoded, with its mipmaps
+         * @param[in] index : Index of this Texture
+         * @param[in] image : Pixels given by decodeImage
+         */
+        void image(u32 index, ImageData const &image);
+
+        /**
+         * @brief Create the immutable storage of one texture 2D, filled afterwards by imageLevel
+         * @param[in] index : Index of this Texture
+         * @param[in] w : Width of the first level
+         * @param[in] h : Height of the first level
+         * @param[in] levels : Number of levels
+         * @param[in] format : Format of ImageData
+         */
+        void imageStorage(u32 index, u32 w, u32 h, u32 levels, GLenum format);
+
+        /**
+         * @brief Fill one level of a texture created by imageStorage
+         * @param[in] index : Index of this Texture
+         * @param[in] level : Level of mipmap
+         * @param[in] format : Format given to imageStorage
+         * @param[in] pixels : Texels or blocks of this level
+         * @param[in] size : Size of this level in bytes
+         */
+        void imageLevel(u32 index, u32 level, GLenum format, u8 const *pixels, size_t size);
+
+        /**
+         * @brief Fill one level of a texture created by imageStorage from a pixel Buffer
+         *
+         * The driver copies from the Buffer when the GPU runs the command, not during the call
+         * @param[in] index : Index of this Texture
+         * @param[in] level : Level of mipmap
+         * @param[in] format : Format given to imageStorage
+         * @param[in] pixels : Buffer which owns texels or blocks of this level
+         * @param[in] offset : Offset in bytes of this level in the Buffer
+         * @param[in] size : Size of this level in bytes
+         */
+        void imageLevel(u32 index, u32 level, GLenum format, Buffer<u8> &pixels, size_t offset, size_t size);
+
         /**
          * @brief Bind images to OpenGL Image
          * @param[in] indexFirstImage : If you don't want to bind all image
@@ -128,6 +241,15 @@ namespace GXY
          */
         void bindImages(u32 indexFirstImage, u32 firstUnit, u32 count) const;
 
+        /**
+         * @brief Bind one level of one texture to OpenGL Image
+         * @param[in] index : Index of this Texture
+         * @param[in] unit : Image unit
+         * @param[in] level : Level of mipmap
+         * @param[in] format : FormatType used by the shader
+         */
+        void bindImageLevel(u32 index, u32 unit, u32 level, FormatType format) const;
+
         /**
          * @brief Bind Textures on FrameBuffer to OpenGL Sampler
          * @param[in] indexFirstTexture : If you don't want to bind all textures
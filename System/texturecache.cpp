@@ -0,0 +1,333 @@
+/*!
+ * \file texturecache.cpp
+ * \brief Keep textures compressed in blocks on disk, to load them again without decoding
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#include "texturecache.h"
+#include "meshcache.h"
+#include "device.h"
+#include "../Debug/cpuprofiler.h"
+
+using namespace std;
+using namespace glm;
+
+namespace GXY
+{
+    static u32 const TEXTURE_CACHE_VERSION = 1; //!< Change it each time the layout or the encoder changes
+    static char const TEXTURE_CACHE_MAGIC[4] = {'G', 'X', 'T', 'C'};
+    static u32 const BLOCK_ROWS_GRAIN = 16; //!< Rows of blocks compressed by one job
+
+    /**
+     * @brief Beginning of the file, followed by the path of the source, then by all levels aligned on 16 bytes
+     */
+    struct TextureCacheHeader
+    {
+        char magic[4]; //!< TEXTURE_CACHE_MAGIC
+        u32 version; //!< TEXTURE_CACHE_VERSION
+        u64 sourceTime; //!< Modification time of the source, in nanoseconds
+        u64 sourceSize; //!< Size of the source in bytes
+        u32 pathSize; //!< Size of the path of the source
+        u32 format; //!< GL_COMPRESSED_RGB_S3TC_DXT1_EXT or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+        u32 w; //!< Width of the first level
+        u32 h; //!< Height of the first level
+        u32 numLevels; //!< Number of levels
+        u32 padding;
+    };
+
+    /**
+     * @brief Offset of the levels in the file
+     */
+    static inline size_t levelsOffset(u32 pathSize)
+    {
+        return (sizeof(TextureCacheHeader) + pathSize + 15) & ~size_t(15);
+    }
+
+    static inline u16 to565(vec3 const &color)
+    {
+        vec3 c = clamp(color, vec3(0.0f), vec3(255.0f));
+
+        return ((u32)(c.r * 31.0f / 255.0f + 0.5f) << 11) |
+               ((u32)(c.g * 63.0f / 255.0f + 0.5f) << 5) |
+                (u32)(c.b * 31.0f / 255.0f + 0.5f);
+    }
+
+    static inline vec3 from565(u16 color)
+    {
+        u32 r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+
+        return vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+    }
+
+    /**
+     * @brief Compress the colors of one block of 4x4 texels in BC1, always with 4 colors
+     * @param[in] texels : RGBA8 texels, row by row
+     * @param[out] block : 8 bytes
+     */
+    static void compressColorBlock(u8 const (*texels)[4], u8 *block)
+    {
+        vec3 colors[16];
+        vec3 mean(0.0f);
+
+        for(u32 i = 0; i < 16; ++i)
+        {
+            colors[i] = vec3(texels[i][0], texels[i][1], texels[i][2]);
+            mean += colors[i];
+        }
+
+        mean /= 16.0f;
+
+        // Principal axis of the colors, by power iteration on their covariance
+        mat3 covariance(0.0f);
+
+        for(u32 i = 0; i < 16; ++i)
+        {
+            vec3 d = colors[i] - mean;
+
+            for(u32 c = 0; c < 3; ++c)
+                covariance[c] += d * d[c];
+        }
+
+        vec3 axis = normalize(vec3(1.0f));
+
+        for(u32 i = 0; i < 8; ++i)
+        {
+            vec3 next = covariance * axis;
+            float length2 = dot(next, next);
+
+            // All texels have the same color
+            if(length2 < 1e-12f)
+                break;
+
+            axis = next / std::sqrt(length2);
+        }
+
+        float minT = FLT_MAX, maxT = -FLT_MAX;
+
+        for(u32 i = 0; i < 16; ++i)
+        {
+            float t = dot(colors[i] - mean, axis);
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        u16 color0 = to565(mean + axis * maxT);
+        u16 color1 = to565(mean + axis * minT);
+        u32 indices = 0;
+
+        // color0 > color1 : 4 colors, no transparent texel
+        if(color0 < color1)
+            std::swap(color0, color1);
+
+        if(color0 != color1)
+        {
+            vec3 palette[4];
+
+            palette[0] = from565(color0);
+            palette[1] = from565(color1);
+            palette[2] = (2.0f * palette[0] + palette[1]) / 3.0f;
+            palette[3] = (palette[0] + 2.0f * palette[1]) / 3.0f;
+
+            for(u32 i = 0; i < 16; ++i)
+            {
+                u32 best = 0;
+                float bestDistance = FLT_MAX;
+
+                for(u32 j = 0; j < 4; ++j)
+                {
+                    vec3 d = colors[i] - palette[j];
+                    float distance = dot(d, d);
+
+                    if(distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = j;
+                    }
+                }
+
+                indices |= best << (2 * i);
+            }
+        }
+
+        block[0] = color0 & 0xFF;
+        block[1] = color0 >> 8;
+        block[2] = color1 & 0xFF;
+        block[3] = color1 >> 8;
+
+        for(u32 i = 0; i < 4; ++i)
+            block[4 + i] = (indices >> (8 * i)) & 0xFF;
+    }
+
+    /**
+     * @brief Compress the alpha of one block of 4x4 texels as in BC3, with 8 levels between extremes
+     * @param[in] texels : RGBA8 texels, row by row
+     * @param[out] block : 8 bytes
+     */
+    static void compressAlphaBlock(u8 const (*texels)[4], u8 *block)
+    {
+        u32 alpha0 = 0, alpha1 = 255;
+        u64 indices = 0;
+
+        for(u32 i = 0; i < 16; ++i)
+        {
+            alpha0 = std::max<u32>(alpha0, texels[i][3]);
+            alpha1 = std::min<u32>(alpha1, texels[i][3]);
+        }
+
+        if(alpha0 > alpha1)
+        {
+            u32 palette[8] = {alpha0, alpha1};
+
+            for(u32 j = 1; j < 7; ++j)
+                palette[j + 1] = ((7 - j) * alpha0 + j * alpha1 + 3) / 7;
+
+            for(u32 i = 0; i < 16; ++i)
+            {
+                u32 best = 0;
+                u32 bestDistance = 256;
+
+                for(u32 j = 0; j < 8; ++j)
+                {
+                    u32 distance = (u32)std::abs((s32)texels[i][3] - (s32)palette[j]);
+
+                    if(distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = j;
+                    }
+                }
+
+                indices |= (u64)best << (3 * i);
+            }
+        }
+
+        block[0] = alpha0;
+        block[1] = alpha1;
+
+        for(u32 i = 0; i < 6; ++i)
+            block[2 + i] = (indices >> (8 * i)) & 0xFF;
+    }
+
+    void compressImage(ImageData const &image, ImageData &compressed)
+    {
+        GXY_ZONE("compressImage");
+
+        bool opaque = true;
+
+        for(size_t i = 3; i < image.levelSize(0) && opaque; i += 4)
+            opaque = image.pixels[i] == 255;
+
+        compressed.w = image.w;
+        compressed.h = image.h;
+        compressed.format = opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        compressed.allocate(image.numLevels());
+
+        u32 blockSize = opaque ? 8 : 16;
+
+        for(u32 level = 0; level < image.numLevels(); ++level)
+        {
+            u32 w = image.levelWidth(level);
+            u32 h = image.levelHeight(level);
+            u32 blocksW = (w + 3) / 4;
+            u32 blocksH = (h + 3) / 4;
+            u8 const *source = image.pixels.data() + image.levels[level];
+            u8 *destination = &compressed.pixels[compressed.levels[level]];
+
+            global->jobSystem->parallelFor(0, blocksH, BLOCK_ROWS_GRAIN, [&](u32 blockY)
+            {
+                u8 texels[16][4];
+
+                for(u32 blockX = 0; blockX < blocksW; ++blockX)
+                {
+                    // Levels smaller than a block repeat their last row and column
+                    for(u32 y = 0; y < 4; ++y)
+                        for(u32 x = 0; x < 4; ++x)
+                            memcpy(texels[y * 4 + x], source + ((size_t)std::min(blockY * 4 + y, h - 1) * w +
+                                                                std::min(blockX * 4 + x, w - 1)) * 4, 4);
+
+                    u8 *block = destination + ((size_t)blockY * blocksW + blockX) * blockSize;
+
+                    if(opaque)
+                        compressColorBlock(texels, block);
+
+                    else
+                    {
+                        compressAlphaBlock(texels, block);
+                        compressColorBlock(texels, block + 8);
+                    }
+                }
+            });
+        }
+
+        GXY_COUNTER("compressedTextures", 1);
+    }
+
+    TextureCache::TextureCache(string const &source) :
+        mSource(source), mPath(cacheFile(source, ".tex"))
+    {
+        cacheStamp(source, mSourceTime, mSourceSize);
+    }
+
+    bool TextureCache::read(ImageData &image)
+    {
+        GXY_ZONE("TextureCache::read");
+
+        ifstream stream(mPath, ios::binary);
+        TextureCacheHeader header;
+
+        if(!stream.read((char*)&header, sizeof header))
+            return false;
+
+        // Outdated or from another layout : the source is decoded again
+        if(memcmp(header.magic, TEXTURE_CACHE_MAGIC, 4) != 0 || header.version != TEXTURE_CACHE_VERSION ||
+           header.sourceTime != mSourceTime || header.sourceSize != mSourceSize || header.pathSize != mSource.size() ||
+           (header.format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT && header.format != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) ||
+           header.numLevels == 0 || header.numLevels > 32)
+            return false;
+
+        string path(header.pathSize, '\0');
+
+        if(!stream.read(&path[0], path.size()) || path != mSource)
+            return false;
+
+        image.w = header.w;
+        image.h = header.h;
+        image.format = header.format;
+        image.allocate(header.numLevels);
+
+        stream.seekg(levelsOffset(header.pathSize));
+
+        // Truncated : as if there was no file
+        if(!stream.read((char*)image.pixels.data(), image.pixels.size()) || stream.peek() != EOF)
+            return false;
+
+        return true;
+    }
+
+    void TextureCache::write(ImageData const &image)
+    {
+        GXY_ZONE("TextureCache::write");
+
+        TextureCacheHeader header;
+        size_t offset = levelsOffset(mSource.size());
+        vector<u8> file(offset + image.pixels.size(), 0);
+
+        memset(&header, 0, sizeof header);
+        memcpy(header.magic, TEXTURE_CACHE_MAGIC, 4);
+        header.version = TEXTURE_CACHE_VERSION;
+        header.sourceTime = mSourceTime;
+        header.sourceSize = mSourceSize;
+        header.pathSize = mSource.size();
+        header.format = image.format;
+        header.w = image.w;
+        header.h = image.h;
+        header.numLevels = image.numLevels();
+
+        memcpy(&file[0], &header, sizeof header);
+        memcpy(&file[sizeof header], mSource.data(), mSource.size());
+        memcpy(&file[offset], image.pixels.data(), image.pixels.size());
+
+        writeCacheFile(mPath, file, mSource);
+    }
+}
@@ -0,0 +1,63 @@
+/*!
+ * \file texturecache.h
+ * \brief Keep textures compressed in blocks on disk, to load them again without decoding
+ * \author Antoine MORRIER
+ * \version 1.0
+ */
+
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include "../include/include.h"
+#include "texture.h"
+
+namespace GXY
+{
+    /**
+     * @brief Compress one image and its mipmaps in blocks, on all threads
+     *
+     * BC1 if all texels are opaque, BC3 else. Endpoints of each block are the extremes
+     * of its colors along their principal axis
+     * @param[in] image : RGBA8 image given by decodeImage
+     * @param[out] compressed : Same image, with the same levels, in blocks
+     */
+    void compressImage(ImageData const &image, ImageData &compressed);
+
+    /**
+     * @brief The TextureCache class
+     *
+     * One file by source in the directory "cache", beside the files of the MeshCache.
+     * The file is valid only for the same path, modification time, size and version of the layout.
+     * It owns all levels already compressed : they go to the GPU as they are.
+     */
+    class TextureCache
+    {
+    public:
+        /**
+         * @brief TextureCache Constructor
+         * @param[in] source : Path of the image
+         */
+        TextureCache(std::string const &source);
+
+        /**
+         * @brief Read the file if it is valid for the source
+         * @param[out] image : Compressed image and its mipmaps
+         * @return false if there is no file, or if it is outdated
+         */
+        bool read(ImageData &image);
+
+        /**
+         * @brief Write the file, a failure only prints a warning
+         * @param[in] image : Compressed image given by compressImage
+         */
+        void write(ImageData const &image);
+
+    private:
+        std::string mSource; //!< Path of the image
+        std::string mPath; //!< Path of the file
+        u64 mSourceTime; //!< Modification time of the image, in nanoseconds
+        u64 mSourceSize; //!< Size of the image in bytes
+    };
+}
+
+#endif // TEXTURECACHE_H
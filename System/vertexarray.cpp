@@ -83,6 +83,39 @@ namespace GXY
             glBindVertexBuffer(0, buffer.mId, 0, sizeof(vec4));
     }
 
+#ifdef GXY_COMPACT_VERTEX
+    void VertexArray::configure(Buffer<vec3> const &positions, Buffer<Vertex> const &buffer)
+    {
+        if(mId == 0)
+            throw Except("Vertex Array is not initialize");
+
+        bind();
+            glEnableVertexAttribArray(0);
+            glEnableVertexAttribArray(1);
+            glEnableVertexAttribArray(2);
+            glEnableVertexAttribArray(3);
+            glEnableVertexAttribArray(4);
+            glEnableVertexAttribArray(5);
+
+            glVertexAttribBinding(0, 0);
+            glVertexAttribBinding(1, 1);
+            glVertexAttribBinding(2, 1);
+            glVertexAttribBinding(3, 1);
+            glVertexAttribBinding(4, 1);
+            glVertexAttribBinding(5, 1);
+
+            // Normalized shorts are decoded in [-1, 1] by the vertex fetch
+            glVertexAttribFormat(0, 3, GL_FLOAT, false, 0);
+            glVertexAttribFormat(1, 2, GL_SHORT, true, offsetof(Vertex, normal));
+            glVertexAttribFormat(2, 2, GL_SHORT, true, offsetof(Vertex, tangent));
+            glVertexAttribFormat(3, 1, GL_SHORT, true, offsetof(Vertex, biTangentSign));
+            glVertexAttribFormat(4, 2, GL_HALF_FLOAT, false, offsetof(Vertex, texCoord));
+            glVertexAttribIFormat(5, 1, GL_UNSIGNED_SHORT, offsetof(Vertex, materialIndex));
+
+            glBindVertexBuffer(0, positions.mId, 0, sizeof(vec3));
+            glBindVertexBuffer(1, buffer.mId, 0, sizeof(Vertex));
+    }
+#else
     void VertexArray::configure(Buffer<Vertex> const &buffer)
     {
         if(mId == 0)
@@ -112,6 +145,7 @@ namespace GXY
 
             glBindVertexBuffer(0, buffer.mId, 0, sizeof(Vertex));
     }
+#endif
 
     void VertexArray::bindElementBuffer(Buffer<u32> const &buffer)
     {
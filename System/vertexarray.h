@@ -54,11 +54,20 @@ namespace GXY
          */
         void bind(void);
 
+#ifdef GXY_COMPACT_VERTEX
+        /**
+         * @brief Configure VertexArray for Vertex, positions are taken in another Buffer
+         * @param[in] positions : Buffer<vec3>, binding 0
+         * @param[in] buffer : Buffer<Vertex>, binding 1
+         */
+        void configure(Buffer<glm::vec3> const &positions, Buffer<Vertex> const &buffer);
+#else
         /**
          * @brief Configure VertexArray for Vertex
          * @param[in] buffer : Buffer<Vertex>
          */
         void configure(Buffer<Vertex> const &buffer);
+#endif
 
         /**
          * @brief Configure VertexArray for vec2
@@ -17,6 +17,27 @@ namespace GXY
      */
     u32 const MAX_POINT_LIGHT_SHADOW = 10;
 
+    /**
+     * @brief The number of frames the CPU can prepare in advance on the GPU
+     */
+    u32 const FRAMES_IN_FLIGHT = 3;
+
+    /**
+     * @brief The number of views of one frame which own their region of the frustrum Buffer :
+     * the camera and its occlusion pass, and the 6 faces of each shadow map of point light
+     */
+    u32 const VIEWS_PER_FRAME = 2 + 6 * MAX_POINT_LIGHT_SHADOW;
+
+    /**
+     * @brief The time in milliseconds the main thread spends on queued jobs at each frame, when the JobSystem has no worker
+     */
+    double const MAIN_THREAD_JOBS_MILLISECONDS = 4.0;
+
+    /**
+     * @brief The number of frames per second simulated by a headless Device
+     */
+    u32 const HEADLESS_FPS = 60;
+
     /**
       * @brief Describe One Cube of 2 units per side, center in 0, 0, 0
      */
@@ -50,6 +71,21 @@ namespace GXY
                                     glm::vec2( 1.0,  1.0)
                                    };
 
+    /**
+     * @brief Forgive some constants for Device
+     */
+    enum DeviceMode{WINDOWED, //!< SDL Window with its OpenGL Context
+                    HEADLESS //!< EGL Context without surface, rendering in an offscreen FrameBuffer
+                   };
+
+    /**
+     * @brief Forgive some constants for the culling pass (matrixculling.glsl)
+     */
+    enum CullingPhase{CULLING_FRUSTRUM, //!< Frustrum culling only
+                      CULLING_LAST_VISIBLE, //!< Frustrum culling, and only meshes visible at the last frame
+                      CULLING_OCCLUSION //!< Test all meshes against the Hi-Z, draw only the new visible ones
+                     };
+
     /**
      * @brief Forgive some constants for Buffer
      */
@@ -58,7 +94,9 @@ namespace GXY
                     DISPATCH_INDIRECT = GL_DISPATCH_INDIRECT_BUFFER, //!< glComputeDispatchIndirect
                     UNIFORM = GL_UNIFORM_BUFFER, //!< Uniform Buffer : Generally in L1 cache
                     SHADER_STORAGE = GL_SHADER_STORAGE_BUFFER, //!< Shader Storage Buffer : Global Memory
-                    ATOMIC = GL_ATOMIC_COUNTER_BUFFER //!< Atomic Counter Buffer
+                    ATOMIC = GL_ATOMIC_COUNTER_BUFFER, //!< Atomic Counter Buffer
+                    PARAMETER = GL_PARAMETER_BUFFER_ARB, //!< Number of draws for glMultiDraw*IndirectCount
+                    PIXEL_UNPACK = GL_PIXEL_UNPACK_BUFFER //!< Source of glTexSubImage*
                    };
 
     enum CubeMap{POS_X = GL_TEXTURE_CUBE_MAP_POSITIVE_X, //!< Right Side
@@ -19,6 +19,14 @@
   * This Engine works with Nodes, so all members depend on
   * one other member, for example, glasses in a storage cupboard
   * depend of this storage cupboard.
+  * Their matrices are stored flat, in the TransformHierarchy.
+  *
+  * @subsection Culling
+  * Meshes are culled on the GPU against the frustrum, then
+  * against a Hi-Z pyramid in two phases : meshes visible at
+  * the last frame first, then the others against their depth.
+  * Nodes sharing one Model are drawn as instances of one command.
+  * The scene stays on the GPU, only moved matrices are uploaded.
   *
   * @subsection Ambient Occlusion
   * Ambient Occlusion is one analytical ambient occlusion with
@@ -50,22 +58,33 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <cstring>
 #include <cassert>
 
 //algorithm
 #include <algorithm>
 #include <functional>
+#include <limits>
+
+// Time
+#include <chrono>
 
 // container
 #include <map>
 #include <vector>
 #include <list>
+#include <deque>
 
 // Memory
 #include <memory>
 #include <thread>
 #include <cstddef>
 
+// Synchronisation
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
 // Exception
 #include <exception>
 #include <stdexcept>
@@ -106,16 +125,47 @@ namespace GXY
     typedef GLuint u32;
     typedef GLuint64 u64;
 
+    static u32 const NO_HLOD = 0xFFFFFFFF; //!< Instance outside of any subtree with a proxy
+    static u32 const HLOD_PROXY = 0x80000000; //!< Instance of the proxy itself, drawn when its subtree is far
+
     /**
      * \brief It is a struct for glDrawElementsIndirect
      */
     struct DrawElementCommand
     {
         u32 count; //!< Number of index taken on the IndexBuffer
-        u32 primCount; //!< Number of instance : 1 in our engine
+        u32 primCount; //!< Number of instances : ModelNodes which share the Model
         u32 firstIndex; //!< first Index if big IndexBuffer
         u32 baseVertex; //!< first Vertex if big VertexBuffer
-        u32 baseInstance; //!< first Instance if several Instances : 0 in our engine
+        u32 baseInstance; //!< first Instance of this command in the instance Buffers
+    };
+
+    /**
+     * @brief One instance of one mesh, tested by the culling pass
+     */
+    struct DrawInstance
+    {
+        u32 command; //!< Index of the DrawElementCommand
+        u32 transform; //!< Index of the matrix in toWorldSpace
+        u32 hlod; //!< HlodSwitch which draws it near, or far with HLOD_PROXY, NO_HLOD if none
+    };
+
+    /**
+     * @brief Choose between one subtree of Nodes and its proxy, by the distance to the camera
+     */
+    struct HlodSwitch
+    {
+        glm::vec4 centerDistance; //!< Center of the subtree in the space of the proxy : .xyz, distance from which the proxy is drawn : .w
+        glm::uvec4 transformParent; //!< Matrix of the proxy in toWorldSpace : .x, NO_HLOD if not baked ; HlodSwitch above : .y, NO_HLOD if none
+    };
+
+    /**
+     * @brief New world matrix of one ModelNode, scattered in toWorldSpace by the GPU
+     */
+    struct TransformUpdate
+    {
+        glm::mat4 toWorldSpace; //!< World Matrix
+        glm::uvec4 slot; //!< Index of the matrix in toWorldSpace : .x
     };
 
     /**
@@ -139,6 +189,21 @@ namespace GXY
         u32 num_groups_z; //!< Number of local group in z
     };
 
+#ifdef GXY_COMPACT_VERTEX
+    /**
+     * @brief It is a struct for rendering, 16 bytes
+     *
+     * The position is only in Global::Model.vertexDepth, read by all passes
+     */
+    struct Vertex
+    {
+        s16 normal[2]; //!< Normal for Vertex, octahedral in snorm16
+        s16 tangent[2]; //!< Tangent, octahedral in snorm16
+        u16 texCoord[2]; //!< Texture Coordinate for this Vertex, in half floats
+        u16 materialIndex; //!< Index of material for this Vertex
+        s16 biTangentSign; //!< biTangent = cross(normal, tangent) * sign, in snorm16
+    };
+#else
     /**
      * @brief It is a struct for rendering
      */
@@ -151,6 +216,7 @@ namespace GXY
         glm::vec2 texCoord; //!< Texture Coordinate for this Vertex
         u32 materialIndex; //!< Index of material for this Vertex
     };
+#endif
 
     /**
      * @brief Describe a material of one mesh
@@ -163,13 +229,50 @@ namespace GXY
     };
 
     /**
-     * @brief Describe a bounding box of one mesh
+     * @brief Describe a bounding box by its center and its half size, 32 bytes like in shaders
      */
     struct AABB3D
     {
-        glm::vec4 coord[8]; //!< One box own 8 vertex
+        glm::vec4 center; //!< Center of the box : .xyz
+        glm::vec4 extent; //!< Half size of the box : .xyz, negative if the box is empty
+    };
+
+    /**
+     * @brief Bounding sphere and cone of normals of one cluster of triangles, 32 bytes like in shaders
+     *
+     * The cluster only has back faces when dot(center - camera, axis) >= cutoff * length(center - camera) + radius
+     */
+    struct ClusterCone
+    {
+        glm::vec4 centerRadius; //!< Center of the sphere : .xyz, radius : .w
+        glm::vec4 axisCutoff; //!< Mean normal : .xyz, sine of the half angle of the cone : .w, 1 if it can't be culled
     };
 
+    /**
+     * @brief Level of detail of one cluster : its mesh is projected, the level is drawn for some sizes on screen
+     *
+     * Drawn when minSize <= size < maxSize, size is the largest side of the box of the mesh on screen, in pixels
+     */
+    struct ClusterLod
+    {
+        glm::vec4 meshCenter; //!< Center of the box of the mesh : .xyz, minSize : .w
+        glm::vec4 meshExtent; //!< Half size of the box of the mesh : .xyz, maxSize : .w, negative for the finest level
+    };
+
+    /**
+     * @brief Create one box from its corners
+     * @param[in] min : Corner min
+     * @param[in] max : Corner max
+     * @return The box
+     */
+    inline AABB3D makeAABB3D(glm::vec3 const &min, glm::vec3 const &max)
+    {
+        AABB3D box;
+        box.center = glm::vec4((min + max) * 0.5f, 1.0f);
+        box.extent = glm::vec4((max - min) * 0.5f, 0.0f);
+        return box;
+    }
+
     /**
      * @brief Describe a plane by its equation
      */
@@ -205,16 +308,18 @@ namespace GXY
     }
 
     /**
-     * @brief Transform the pos on the AABB3D on the new space describe by transform
+     * @brief Compute the box around the AABB3D transformed in the new space describe by transform (Arvo)
      * @param[in] box : A AABB3D "basic"
      * @param[in] transform : The landmark of your future AABB3D
-     * @return A new
+     * @return A new box, axis aligned in the new space
      */
     inline AABB3D computeAABB3D(AABB3D const &box, glm::mat4 const &transform)
     {
         AABB3D newBox;
-        for(u32 i = 0; i < 8; ++i)
-            newBox.coord[i] = transform * box.coord[i];
+        newBox.center = transform * glm::vec4(box.center.xyz(), 1.0f);
+        newBox.extent = glm::vec4(glm::abs(transform[0].xyz()) * box.extent.x +
+                                  glm::abs(transform[1].xyz()) * box.extent.y +
+                                  glm::abs(transform[2].xyz()) * box.extent.z, 0.0f);
         return newBox;
     }
 
@@ -243,7 +348,7 @@ namespace GXY
         glm::mat4 frustrumMatrix; //!< Is the projectionMatrix product viewMatrix
         glm::vec4 posCamera; //!< .xyz = posCamera or PosLight for shadowMaps for example
         glm::vec4 planesFrustrum[6]; //!< A frustrum is formed by 6 planes
-        glm::uvec4 numberMeshesPointLights; //!< NumberMeshed : .x, numberPointLights.y
+        glm::uvec4 numberMeshesPointLights; //!< numberCommands : .x, numberPointLights : .y, numberInstances : .z
     };
 
     /**
@@ -1,6 +1,7 @@
 #include "include/include.h"
 #include "SceneManager/scenemanager.h"
 #include "Debug/debug.h"
+#include "Debug/gpuprofiler.h"
 #include "SceneManager/modelnode.h"
 #include "SceneManager/pointlightnode.h"
 
@@ -40,20 +41,10 @@ int main(int argc, char *argv[])
         {
             device.begin(); // Clear Window
 
-            u64 t = 0;
-            u32 query;
-
-            glGenQueries(1, &query);
-            glBeginQuery(GL_TIME_ELAPSED, query);
             sceneManager.render(); // Render Scene
-            glEndQuery(GL_TIME_ELAPSED);
-
-            while(t == 0)
-                glGetQueryObjectui64v(query, GL_QUERY_RESULT_AVAILABLE, &t);
-
-            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &t);
 
-            cout << (float)t / 1000000 << std::endl;
+            // GPU time of a frame some frames ago : measure without waiting
+            cout << global->gpuProfiler->frameTime() << std::endl;
 
             device.end(); // Swap Buffer
         }